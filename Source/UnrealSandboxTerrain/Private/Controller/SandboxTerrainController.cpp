@@ -144,7 +144,7 @@ void ASandboxTerrainController::BeginPlay() {
 		ScreenSize *= LodRatio;
 	}
 
-	ThreadPool = new TThreadPool(5);
+	ThreadPool = new TThreadPool(ThreadPoolSize);
 	Conveyor = new TConveyour();
 
 	TArray<UTerrainGeneratorComponent*> GeneratorComponents;
@@ -219,7 +219,7 @@ void ASandboxTerrainController::ShutdownThreads() {
 
 	UE_LOG(LogVt, Warning, TEXT("Conveyor -> %d threads. Waiting for finish..."), Conveyor->size());
 	while (true) {
-		std::function<void()> Function;
+		TTask Function;
 		if (Conveyor->pop(Function)) {
 			Function();
 		} else {
@@ -257,31 +257,20 @@ void ASandboxTerrainController::Tick(float DeltaTime) {
 
 	LoadConsoleVars();
 
-	int R = 0;
-	double ConvTime = 0;
-	while (ConvTime < ConveyorMaxTime) {
-		std::function<void()> Function;
-		if (Conveyor->pop(Function)) {
-			double Start = FPlatformTime::Seconds();
-			Function();
-			double End = FPlatformTime::Seconds();
-
-#if TRACE_CONVEYOR == 1 
-			UE_LOG(LogVt, Warning, TEXT("task = %f ms"), (End - Start) * 1000);
-#endif
-
-			ConvTime += (End - Start);
-			R++;
-		} else {
-			break;
-		}
-	}
-
 #if TRACE_CONVEYOR == 1 
+	const double ConvStart = FPlatformTime::Seconds();
+	const int R = Conveyor->execute(ConveyorMaxTime);
 	if (R > 0) {
-		UE_LOG(LogVt, Warning, TEXT("ConvTime = %f ms"), ConvTime * 1000);
+		UE_LOG(LogVt, Warning, TEXT("ConvTime = %f ms"), (FPlatformTime::Seconds() - ConvStart) * 1000);
 		UE_LOG(LogVt, Warning, TEXT("R = %d"), R);
+
+		for (int C = 0; C < CONVEYOR_TASK_CLASS_NUM; C++) {
+			const TConveyorStat Stat = Conveyor->getStat((TConveyorTaskClass)C);
+			UE_LOG(LogVt, Warning, TEXT("class %d: size = %d, cost = %f ms, latency = %f ms, max latency = %f ms"), C, Stat.size, Stat.cost * 1000, Stat.latency * 1000, Stat.max_latency * 1000);
+		}
 	}
+#else
+	Conveyor->execute(ConveyorMaxTime);
 #endif
 
 }
@@ -346,9 +335,10 @@ void ASandboxTerrainController::PerformCheckArea() {
 				TTerrainAreaLoadParams Params(ActiveAreaSize, ActiveAreaDepth);
                 HandlerPtr->SetParams(TEXT("player_streaming"), this, Params);
                                
+                // zones near player are already loaded, streaming goes to area border
                 AddAsyncTask([=]() {
                     HandlerPtr->LoadArea(PlayerLocation);
-                });
+                }, TTaskPriority::FAR_STREAMING);
 
 				bPerformSoftUnload = true;
             }
@@ -551,7 +541,7 @@ void ASandboxTerrainController::BeginPlayServer() {
 }
 
 void ASandboxTerrainController::BeginNewWorld() {
-
+	MapInfo.FormatVersion = bCompactMeshData ? USBT_MAP_FORMAT_VERSION : USBT_MAP_FORMAT_CODEC;
 }
 
 void ASandboxTerrainController::BeginServerTerrainLoad() {
@@ -583,7 +573,7 @@ void ASandboxTerrainController::BeginServerTerrainLoad() {
 						if (bSaveAfterInitialLoad) {
 							SaveMapAsync();
 						}
-					});
+					}, TConveyorTaskClass::GENERAL);
 
 					AsyncTask(ENamedThreads::GameThread, [&] {
 						StartPostLoadTimers();
@@ -591,7 +581,7 @@ void ASandboxTerrainController::BeginServerTerrainLoad() {
 					});
 				});
 			}
-        });
+        }, TTaskPriority::NEAR_STREAMING);
 	} else {
 		OnFinishInitialLoad();
 	}
@@ -636,7 +626,7 @@ void ASandboxTerrainController::BeginClientTerrainLoad(const TVoxelIndex& ZoneIn
 #endif
 				AddTaskToConveyor([=, this] {
 					OnFinishInitialLoad();
-				});
+				}, TConveyorTaskClass::GENERAL);
 
 				AsyncTask(ENamedThreads::GameThread, [&] {
 					StartPostLoadTimers();
@@ -647,7 +637,7 @@ void ASandboxTerrainController::BeginClientTerrainLoad(const TVoxelIndex& ZoneIn
 			});
 		}
 
-	});
+	}, TTaskPriority::NEAR_STREAMING);
 }
 
 void ASandboxTerrainController::OnStartBackgroundSaveTerrain() {
@@ -678,7 +668,7 @@ void ASandboxTerrainController::SaveMapAsync() {
 		AsyncTask(ENamedThreads::GameThread, [=, this]() { OnFinishBackgroundSaveTerrain(); });
 
 		UE_LOG(LogVt, Log, TEXT("Finish save terrain async"));
-	});
+	}, TTaskPriority::SAVE);
 }
 
 void ASandboxTerrainController::AutoSaveByTimer() {
@@ -724,6 +714,29 @@ void ASandboxTerrainController::SpawnZone(const TVoxelIndex& Index) {
 	TMeshDataPtr MeshDataPtr = nullptr;
 	TInstanceMeshTypeMap& ZoneInstanceObjectMap = *TerrainData->GetOrCreateInstanceObjectMap(Index);
 	LoadMeshAndObjectDataByIndex(Index, MeshDataPtr, ZoneInstanceObjectMap);
+	if (MeshDataPtr && MeshDataPtr->bCollisionOnly && !IsCollisionOnlyMeshing() && VdInfoPtr->DataState != TVoxelDataState::GENERATED) {
+		// map is saved by dedicated server: render mesh is generated from voxel data and saved again.
+		// stored voxel data is loaded only for meshing, zone stays READY_TO_LOAD
+		std::unique_ptr<TVoxelData> TmpVd;
+		TVoxelData* Vd = VdInfoPtr->Vd;
+		if (VdInfoPtr->DataState == TVoxelDataState::READY_TO_LOAD) {
+			TmpVd.reset(LoadVoxelDataByIndex(Index));
+			Vd = TmpVd.get();
+		}
+
+		TMeshDataPtr RenderMeshDataPtr = Vd ? GenerateMesh(Vd) : nullptr;
+		if (RenderMeshDataPtr) {
+			if (Zone) {
+				ExecGameThreadZoneApplyMesh(Index, Zone, RenderMeshDataPtr);
+			} else {
+				ExecGameThreadAddZoneAndApplyMesh(Index, RenderMeshDataPtr, false, true);
+			}
+
+			VdInfoPtr->SetSpawnFinished();
+			return;
+		}
+	}
+
 	if (MeshDataPtr && VdInfoPtr->DataState != TVoxelDataState::GENERATED) {
 		if (Zone) {
 			ExecGameThreadZoneApplyMesh(Index, Zone, MeshDataPtr);
@@ -838,7 +851,7 @@ void ASandboxTerrainController::ExecGameThreadMoMeshZoneSpawn(const TArray<TVoxe
 			OnFinishLoadZone(Index);
 		};
 
-		AddTaskToConveyor(Function);
+		AddTaskToConveyor(Function, TConveyorTaskClass::NO_MESH_ZONE);
 	}
 }
 
@@ -853,7 +866,7 @@ void ASandboxTerrainController::PostBatchGenerateZone(const TArray<TSpawnZonePar
 		}
 
 		if (VoxelDataInfoPtr->Vd && VoxelDataInfoPtr->Vd->getDensityFillState() == TVoxelDataFillState::MIXED) {
-			TMeshDataPtr MeshDataPtr = GenerateMesh(VoxelDataInfoPtr->Vd);
+			TMeshDataPtr MeshDataPtr = GenerateMesh(VoxelDataInfoPtr->Vd, P.LodMask);
 			VoxelDataInfoPtr->CleanUngenerated(); //TODO refactor
 			TerrainData->PutMeshDataToCache(P.Index, MeshDataPtr);
 			ExecGameThreadAddZoneAndApplyMesh(P.Index, MeshDataPtr, true);
@@ -1038,9 +1051,9 @@ void ASandboxTerrainController::InvokeSafe(std::function<void()> Function) {
     }
 }
 
-void ASandboxTerrainController::AddTaskToConveyor(std::function<void()> Function) {
+void ASandboxTerrainController::AddTaskToConveyor(std::function<void()> Function, TConveyorTaskClass TaskClass) {
 	if (bEnableConveyor) {
-		Conveyor->push(Function);
+		Conveyor->push(std::move(Function), TaskClass);
 	} else {
 		if (IsInGameThread()) {
 			Function();
@@ -1068,7 +1081,7 @@ void ASandboxTerrainController::ExecGameThreadZoneApplyMesh(const TVoxelIndex& I
 		}
 	};
 
-	AddTaskToConveyor(Function);
+	AddTaskToConveyor(Function, TConveyorTaskClass::APPLY_MESH);
 }
 
 void ASandboxTerrainController::ExecGameThreadAddZoneAndApplyMesh(const TVoxelIndex& Index, TMeshDataPtr MeshDataPtr, const bool bIsNewGenerated, const bool bIsChanged) {
@@ -1102,11 +1115,11 @@ void ASandboxTerrainController::ExecGameThreadAddZoneAndApplyMesh(const TVoxelIn
 		} 
 	};
 
-	AddTaskToConveyor(Function);
+	AddTaskToConveyor(Function, TConveyorTaskClass::ADD_ZONE);
 }
 
-void ASandboxTerrainController::AddAsyncTask(std::function<void()> Function) {
-	ThreadPool->addTask(Function);
+void ASandboxTerrainController::AddAsyncTask(std::function<void()> Function, TTaskPriority Priority) {
+	ThreadPool->addTask(std::move(Function), Priority);
 }
 
 //======================================================================================================================================================================
@@ -1217,7 +1230,17 @@ float ASandboxTerrainController::NormalizedPerlinNoise(const FVector& Pos, const
 // generate mesh
 //======================================================================================================================================================================
 
-std::shared_ptr<TMeshData> ASandboxTerrainController::GenerateMesh(TVoxelData* Vd) {
+// dedicated server doesn't render terrain: zone mesh is LOD 0 collision only
+bool ASandboxTerrainController::IsCollisionOnlyMeshing() const {
+	return GetNetMode() == NM_DedicatedServer;
+}
+
+// server keeps edit history to send clients changed voxels only
+bool ASandboxTerrainController::IsZoneDeltaLogEnabled() const {
+	return GetNetMode() == NM_DedicatedServer || GetNetMode() == NM_ListenServer;
+}
+
+std::shared_ptr<TMeshData> ASandboxTerrainController::GenerateMesh(TVoxelData* Vd, uint32 LodMask) {
 	double Start = FPlatformTime::Seconds();
 
 	if (!Vd) {
@@ -1231,14 +1254,22 @@ std::shared_ptr<TMeshData> ASandboxTerrainController::GenerateMesh(TVoxelData* V
 
 	TVoxelDataParam Vdp;
 
-	if (USBT_ENABLE_LOD) {
+	if (IsCollisionOnlyMeshing()) {
+		Vdp.bCollisionOnly = true;
+	} else if (USBT_ENABLE_LOD) {
+		LodMask &= USBT_LOD_MASK_ALL;
 		Vdp.bGenerateLOD = true;
-		Vdp.collisionLOD = 0;
+		Vdp.lodMask = LodMask;
+		// zone without LOD 0 collides with its most detailed LOD
+		Vdp.collisionLOD = (LodMask != 0) ? FMath::CountTrailingZeros(LodMask) : 0;
 	} else {
 		Vdp.bGenerateLOD = false;
 		Vdp.collisionLOD = 0;
 	}
 
+	// mesh can stay in memory until zone is saved, keep one vertex pool per LOD
+	Vdp.bShareVertexes = !Vdp.bCollisionOnly;
+
 	TMeshDataPtr MeshDataPtr = sandboxVoxelGenerateMesh(*Vd, Vdp);
 	MeshDataPtr->BaseMaterialId = Vd->getBaseMatId();
 
@@ -1250,6 +1281,131 @@ std::shared_ptr<TMeshData> ASandboxTerrainController::GenerateMesh(TVoxelData* V
 	return MeshDataPtr;
 }
 
+// Mesh after terrain edit. If base mesh is generated from voxel data state before edit, only cells of dirty region are extracted again
+std::shared_ptr<TMeshData> ASandboxTerrainController::GenerateEditMesh(TVoxelData* Vd, TMeshDataPtr BaseMeshDataPtr) {
+	if (!Vd) {
+		return nullptr;
+	}
+
+	if (Vd->getDensityFillState() == TVoxelDataFillState::ZERO || Vd->getDensityFillState() == TVoxelDataFillState::FULL) {
+		return nullptr;
+	}
+
+	TVoxelDataParam Vdp;
+	Vdp.bGenerateLOD = USBT_ENABLE_LOD;
+	Vdp.collisionLOD = 0;
+	Vdp.bKeepCellInfo = true;
+	Vdp.bCollisionOnly = IsCollisionOnlyMeshing();
+	Vdp.threadPool = ThreadPool; // player is waiting for edited zone
+
+	TMeshDataPtr MeshDataPtr = nullptr;
+	if (BaseMeshDataPtr) {
+		TVoxelIndex Lower, Upper;
+		Vd->getDirtyRegion(Lower, Upper);
+		MeshDataPtr = sandboxVoxelGenerateMeshRegion(*Vd, Vdp, *BaseMeshDataPtr, Lower, Upper);
+	}
+
+	if (!MeshDataPtr) {
+		MeshDataPtr = sandboxVoxelGenerateMesh(*Vd, Vdp);
+	}
+
+	MeshDataPtr->BaseMaterialId = Vd->getBaseMatId();
+	MeshDataPtr->TimeStamp = FPlatformTime::Seconds();
+	MeshDataPtr->SourceRevision = Vd->getRevision();
+	return MeshDataPtr;
+}
+
+// LodGenerationRange LODs around LOD which scene proxy selects at zone distance from viewer (see ComputeLodIndexByScreenSize).
+// Dedicated server meshes LOD 0 collision only, see IsCollisionOnlyMeshing.
+// Listen server always has LOD 0: its physics is authoritative for remote players, whose zones host doesn't render
+uint32 ASandboxTerrainController::ClcZoneLodMask(const TVoxelIndex& ZoneIndex, const TVoxelIndex& ViewerIndex) const {
+	if (!USBT_ENABLE_LOD || LodGenerationRange <= 0 || LodGenerationRange >= LOD_ARRAY_SIZE || IsCollisionOnlyMeshing()) {
+		return USBT_LOD_MASK_ALL;
+	}
+
+	const int32 Distance = FMath::Max3(FMath::Abs(ZoneIndex.X - ViewerIndex.X), FMath::Abs(ZoneIndex.Y - ViewerIndex.Y), FMath::Abs(ZoneIndex.Z - ViewerIndex.Z));
+
+	// screen size of zone bounding sphere (radius is half of zone diagonal) with 90 degrees FOV
+	const float ScreenSize = 0.866f / FMath::Max(Distance, 1);
+
+	int32 Lod = 0;
+	for (int32 LodIdx = 0; LodIdx < LOD_ARRAY_SIZE; LodIdx++) {
+		if (ScreenSize < LodScreenSizeArray[LodIdx]) {
+			Lod = LodIdx;
+		}
+	}
+
+	// one more detailed LOD for closer camera and neighbor zones
+	const int32 MinLod = FMath::Clamp(Lod - 1, 0, LOD_ARRAY_SIZE - LodGenerationRange);
+	const uint32 LodMask = ((1u << LodGenerationRange) - 1) << MinLod;
+	return (GetNetMode() == NM_ListenServer) ? (LodMask | 1u) : LodMask;
+}
+
+void ASandboxTerrainController::RequestZoneLod(const TVoxelIndex& ZoneIndex, int32 LodIndex) {
+	if (bIsGameShutdown || LodIndex < 0 || LodIndex >= LOD_ARRAY_SIZE) {
+		return;
+	}
+
+	AddAsyncTask([=, this]() {
+		if (!bIsGameShutdown) {
+			GenerateZoneLod(ZoneIndex, 1u << LodIndex);
+		}
+	}, TTaskPriority::NEAR_STREAMING);
+}
+
+// Extract LODs of LodMask which zone mesh doesn't have and apply extended mesh
+void ASandboxTerrainController::GenerateZoneLod(const TVoxelIndex& ZoneIndex, uint32 LodMask) {
+	TVoxelDataInfoPtr VdInfoPtr = TerrainData->GetVoxelDataInfo(ZoneIndex);
+	TVdInfoLockGuard Lock(VdInfoPtr);
+
+	UTerrainZoneComponent* Zone = VdInfoPtr->GetZone();
+	if (!Zone) {
+		return;
+	}
+
+	// mesh is in cache until zone is saved
+	TMeshDataPtr BaseMeshDataPtr = VdInfoPtr->GetMeshDataCache();
+	if (!BaseMeshDataPtr) {
+		TInstanceMeshTypeMap InstanceObjectMap;
+		LoadMeshAndObjectDataByIndex(ZoneIndex, BaseMeshDataPtr, InstanceObjectMap);
+	}
+
+	if (!BaseMeshDataPtr || BaseMeshDataPtr->bCollisionOnly || (BaseMeshDataPtr->LodMask & LodMask) == LodMask) {
+		return;
+	}
+
+	// stored voxel data is loaded only for extraction, zone stays READY_TO_LOAD
+	std::unique_ptr<TVoxelData> TmpVd;
+	TVoxelData* Vd = nullptr;
+	if (VdInfoPtr->DataState == TVoxelDataState::READY_TO_LOAD) {
+		TmpVd.reset(LoadVoxelDataByIndex(ZoneIndex));
+		Vd = TmpVd.get();
+	} else if (VdInfoPtr->DataState == TVoxelDataState::LOADED || VdInfoPtr->DataState == TVoxelDataState::GENERATED) {
+		Vd = VdInfoPtr->Vd;
+	}
+
+	if (!Vd || Vd->getDensityFillState() != TVoxelDataFillState::MIXED) {
+		return;
+	}
+
+	const uint32 NewLodMask = BaseMeshDataPtr->LodMask | LodMask;
+
+	TVoxelDataParam Vdp;
+	Vdp.bGenerateLOD = true;
+	Vdp.collisionLOD = FMath::CountTrailingZeros(NewLodMask); // collision moves to new LOD if it is more detailed
+	Vdp.bShareVertexes = true;
+
+	TMeshDataPtr MeshDataPtr = sandboxVoxelGenerateMeshLod(*Vd, Vdp, *BaseMeshDataPtr, LodMask);
+	MeshDataPtr->TimeStamp = FPlatformTime::Seconds();
+
+	// extended mesh is saved, so extraction is not repeated after reload
+	TerrainData->PutMeshDataToCache(ZoneIndex, MeshDataPtr);
+	VdInfoPtr->SetNeedTerrainSave();
+	TerrainData->AddSaveIndex(ZoneIndex);
+
+	ExecGameThreadZoneApplyMesh(ZoneIndex, Zone, MeshDataPtr);
+}
+
 FSandboxFoliage ASandboxTerrainController::GetFoliageById(uint32 FoliageId) const {
 	return FoliageMap[FoliageId];
 }
@@ -1262,6 +1418,11 @@ void ASandboxTerrainController::MarkZoneNeedsToSaveObjects(const TVoxelIndex& Zo
 	VdInfoPtr->SetChanged();
 	VdInfoPtr->SetNeedObjectsSave();
 	TerrainData->AddSaveIndex(ZoneIndex);
+	TerrainData->InvalidateZonePayload(ZoneIndex);
+
+	if (IsZoneDeltaLogEnabled()) {
+		TerrainData->MarkZoneObjectsChanged(ZoneIndex, TerrainData->GetZoneVStamp(ZoneIndex).VStamp);
+	}
 }
 
 const FTerrainInstancedMeshType* ASandboxTerrainController::GetInstancedMeshType(uint32 MeshTypeId, uint32 MeshVariantId) const {
@@ -1283,7 +1444,16 @@ float ASandboxTerrainController::GetGroundLevel(const FVector& Pos) {
 }
 
 FTerrainDebugInfo ASandboxTerrainController::GetMemstat() {
-	return FTerrainDebugInfo{ vd::tools::memory::getVdCount(), md_counter.load(), cd_counter.load(), (int)Conveyor->size(), ThreadPool->size(), TerrainData->SyncMapSize(), zone_counter.load()};
+	FTerrainDebugInfo Info{ vd::tools::memory::getVdCount(), md_counter.load(), cd_counter.load(), (int)Conveyor->size(), ThreadPool->size(), TerrainData->SyncMapSize(), zone_counter.load()};
+
+	for (int C = 0; C < CONVEYOR_TASK_CLASS_NUM; C++) {
+		const TConveyorStat Stat = Conveyor->getStat((TConveyorTaskClass)C);
+		Info.ConveyorClassSize.Add(Stat.size);
+		Info.ConveyorClassLatency.Add((float)(Stat.latency * 1000));
+		Info.ConveyorClassMaxLatency.Add((float)(Stat.max_latency * 1000));
+	}
+
+	return Info;
 }
 
 void ASandboxTerrainController::UE51MaterialIssueWorkaround() {
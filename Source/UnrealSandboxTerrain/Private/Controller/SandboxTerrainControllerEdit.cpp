@@ -3,6 +3,7 @@
 #include "Core/VoxelDataInfo.hpp"
 #include "TerrainZoneComponent.h"
 #include "Core/TerrainData.hpp"
+#include "Core/ThreadPool.hpp"
 #include "TerrainServerComponent.h"
 #include "Engine/OverlapResult.h"
 
@@ -35,6 +36,13 @@ struct TZoneEditHandler {
 		return 0;
 	}
 
+	// only voxels of axis aligned box Origin +- BoundExtend are visited, substance cache is updated for changed cells only
+	void ForEachWithCache(TVoxelData* Vd, const FVector& BoundExtend, std::function<void(int, int, int)> Function) {
+		TVoxelIndex Lower, Upper;
+		Vd->clcVoxelBox(FBox(Origin - BoundExtend, Origin + BoundExtend), Lower, Upper);
+		Vd->forEachInBoxWithCache(Lower, Upper, Function, USBT_ENABLE_LOD);
+	}
+
 	float Extend;
 };
 
@@ -57,7 +65,7 @@ void ASandboxTerrainController::DigCylinder(const FVector& Origin, const float R
 			bool bIsRotator = !Rotator.IsZero();
 			Rotator = Rotator.GetInverse();
 
-			Vd->forEachWithCache([&](int X, int Y, int Z) {
+			ForEachWithCache(Vd, FVector(std::sqrt((Extend + 20) * (Extend + 20) + Length * Length)), [&](int X, int Y, int Z) {
 				FVector V = TZoneEditHandler::GetVoxelRelativePos(Vd, Origin, X, Y, Z);
 				if (bIsRotator) {
 					V = Rotator.RotateVector(V);
@@ -80,7 +88,7 @@ void ASandboxTerrainController::DigCylinder(const FVector& Origin, const float R
 
 					changed = true;
 				}
-			}, USBT_ENABLE_LOD);
+			});
 
 			return changed;
 		}
@@ -114,7 +122,7 @@ void ASandboxTerrainController::DigTerrainRoundHole(const FVector& Origin, float
 		bool operator()(TVoxelData* Vd) {
 			changed = false;
 
-			Vd->forEachWithCache([&](int X, int Y, int Z) {
+			ForEachWithCache(Vd, FVector(Extend + 20), [&](int X, int Y, int Z) {
 				float OldDensity = Vd->getDensity(X, Y, Z);
 				FVector V = TZoneEditHandler::GetVoxelRelativePos(Vd, Origin, X, Y, Z);
 				float R = std::sqrt(V.X * V.X + V.Y * V.Y + V.Z * V.Z);
@@ -134,7 +142,7 @@ void ASandboxTerrainController::DigTerrainRoundHole(const FVector& Origin, float
 
 					changed = true;
 				}
-			}, USBT_ENABLE_LOD);
+			});
 
 			return changed;
 		}
@@ -175,8 +183,9 @@ void ASandboxTerrainController::DigTerrainCubeHoleComplex(const FVector& Origin,
 
 			static const float E = 50;
 			FBox Box2 = Box.ExpandBy(E);
+			const FVector Corner(FMath::Max(-Box2.Min.X, Box2.Max.X), FMath::Max(-Box2.Min.Y, Box2.Max.Y), FMath::Max(-Box2.Min.Z, Box2.Max.Z));
 
-			vd->forEachWithCache([&](int x, int y, int z) {
+			ForEachWithCache(vd, FVector(Corner.Size()), [&](int x, int y, int z) {
 				FVector L = vd->voxelIndexToVector(x, y, z) + vd->getOrigin();
 				FVector P = L - Origin;
 
@@ -230,7 +239,7 @@ void ASandboxTerrainController::DigTerrainCubeHoleComplex(const FVector& Origin,
 
 					changed = true;
 				}
-			}, USBT_ENABLE_LOD);
+			});
 
 			return changed;
 		}
@@ -268,7 +277,7 @@ void ASandboxTerrainController::DigTerrainCubeHole(const FVector& Origin, float
 
 			bool bIsRotator = !Rotator.IsZero();
 			FBox Box(FVector(-(Extend + 20)), FVector(Extend + 20));
-			vd->forEachWithCache([&](int x, int y, int z) {
+			ForEachWithCache(vd, FVector((Extend + 20) * UE_SQRT_3), [&](int x, int y, int z) {
 				FVector V = vd->voxelIndexToVector(x, y, z) + vd->getOrigin() - Origin;
 				if (bIsRotator) {
 					V = Rotator.RotateVector(V);
@@ -296,7 +305,7 @@ void ASandboxTerrainController::DigTerrainCubeHole(const FVector& Origin, float
 
 					changed = true;
 				}
-			}, USBT_ENABLE_LOD);
+			});
 
 			return changed;
 		}
@@ -321,7 +330,7 @@ void ASandboxTerrainController::FillTerrainCube(const FVector& Origin, float Ext
 		bool operator()(TVoxelData* vd) {
 			changed = false;
 
-			vd->forEachWithCache([&](int x, int y, int z) {
+			ForEachWithCache(vd, FVector(Extend + 20), [&](int x, int y, int z) {
 				FVector o = vd->voxelIndexToVector(x, y, z);
 				o += vd->getOrigin();
 				o -= Origin;
@@ -334,7 +343,7 @@ void ASandboxTerrainController::FillTerrainCube(const FVector& Origin, float Ext
 				if (o.X < radiusMargin && o.X > -radiusMargin && o.Y < radiusMargin && o.Y > -radiusMargin && o.Z < radiusMargin && o.Z > -radiusMargin) {
 					vd->setMaterial(x, y, z, newMaterialId);
 				}
-			}, USBT_ENABLE_LOD);
+			});
 
 			return changed;
 		}
@@ -357,7 +366,7 @@ void ASandboxTerrainController::FillTerrainRound(const FVector& Origin, float Ex
 		bool operator()(TVoxelData* vd) {
 			changed = false;
 
-			vd->forEachWithCache([&](int x, int y, int z) {
+			ForEachWithCache(vd, FVector(Extend / 4 + 100), [&](int x, int y, int z) {
 				const float Density = vd->getDensity(x, y, z);
 				FVector O = vd->voxelIndexToVector(x, y, z);
 				O += vd->getOrigin();
@@ -378,7 +387,7 @@ void ASandboxTerrainController::FillTerrainRound(const FVector& Origin, float Ex
 					}
 				}
 
-			}, USBT_ENABLE_LOD);
+			});
 
 			return changed;
 		}
@@ -450,7 +459,11 @@ void ASandboxTerrainController::RemoveInstanceAtMesh(TVoxelIndex ZoneIndex, uint
 	if (InstMesh) {
 		InstMesh->RemoveInstance(ItemIndex);
 		MarkZoneNeedsToSaveObjects(ZoneIndex);
-		TerrainData->IncreaseVStamp(ZoneIndex);
+		const int32 VStamp = TerrainData->IncreaseVStamp(ZoneIndex);
+
+		if (IsZoneDeltaLogEnabled()) {
+			TerrainData->AddZoneDelta(ZoneIndex, VStamp, nullptr);
+		}
 	}
 }
 
@@ -458,7 +471,7 @@ template<class H>
 void ASandboxTerrainController::PerformTerrainChange(H Handler) {
 	AddAsyncTask([=, this] {
 		EditTerrain(Handler);
-	});
+	}, TTaskPriority::PLAYER_EDIT);
 
 	TArray<struct FOverlapResult> Result;
 	FCollisionQueryParams CollisionQueryParams = FCollisionQueryParams::DefaultQueryParam;
@@ -548,6 +561,15 @@ void ASandboxTerrainController::PerformEachZoneInstanceMesh(const FVector& Origi
 					}
 					
 					Function(InstancedMesh, AccurateInstances);
+
+					// caller removes found instances
+					if (AccurateInstances.Num() > 0) {
+						TerrainData->InvalidateZonePayload(ZoneIndex);
+
+						if (IsZoneDeltaLogEnabled()) {
+							TerrainData->MarkZoneObjectsChanged(ZoneIndex, TerrainData->GetZoneVStamp(ZoneIndex).VStamp);
+						}
+					}
 				}
 			}
 		}
@@ -584,11 +606,21 @@ void ASandboxTerrainController::PerformEachZone(const FVector& Origin, const flo
 
 template<class H>
 void ASandboxTerrainController::PerformZoneEditHandler(const TVoxelIndex& ZoneIndex, TVoxelDataInfoPtr VdInfoPtr, H Handler, std::function<void(TMeshDataPtr)> OnComplete) {
-	bool bIsChanged = Handler(VdInfoPtr->Vd);
+	TVoxelData* Vd = VdInfoPtr->Vd;
+
+	// previous edit mesh is valid base only if voxel data is not changed after it
+	TMeshDataPtr BaseMeshDataPtr = TerrainData->GetEditMesh(ZoneIndex);
+	if (BaseMeshDataPtr && BaseMeshDataPtr->SourceRevision != Vd->getRevision()) {
+		BaseMeshDataPtr = nullptr;
+	}
+
+	Vd->resetDirtyRegion();
+	bool bIsChanged = Handler(Vd);
 	//if (bIsChanged) {
 		VdInfoPtr->SetChanged();
-		VdInfoPtr->Vd->setCacheToValid();
-		TMeshDataPtr MeshDataPtr = GenerateMesh(VdInfoPtr->Vd);
+		Vd->setCacheToValid();
+		TMeshDataPtr MeshDataPtr = GenerateEditMesh(Vd, BaseMeshDataPtr);
+		TerrainData->SetEditMesh(ZoneIndex, MeshDataPtr);
 		VdInfoPtr->ResetLastMeshRegenerationTime();
 
 		if (MeshDataPtr) {
@@ -667,8 +699,9 @@ void ASandboxTerrainController::EditTerrain(const H& ZoneHandler) {
 		}
 
 		if (VoxelDataInfo->DataState == TVoxelDataState::LOADED || VoxelDataInfo->DataState == TVoxelDataState::GENERATED) {
+			int32 VStamp = 0;
 			if (GetNetMode() != NM_Client) {
-				TerrainData->IncreaseVStamp(ZoneIndex);
+				VStamp = TerrainData->IncreaseVStamp(ZoneIndex);
 			}
 
 			if (Zone == nullptr) {
@@ -680,6 +713,12 @@ void ASandboxTerrainController::EditTerrain(const H& ZoneHandler) {
 					ExecGameThreadZoneApplyMesh(ZoneIndex, Zone, MeshDataPtr);
 				});
 			}
+
+			if (IsZoneDeltaLogEnabled()) {
+				TVoxelIndex Lower, Upper;
+				TDataPtr RegionData = VoxelDataInfo->Vd->getDirtyRegion(Lower, Upper) ? VoxelDataInfo->Vd->serializeRegion(Lower, Upper) : nullptr;
+				TerrainData->AddZoneDelta(ZoneIndex, VStamp, RegionData);
+			}
 		}
 
 		VoxelDataInfo->Unlock();
@@ -3,12 +3,14 @@
 #include "VoxelMeshData.h"
 #include "Serialization/ArchiveLoadCompressedProxy.h"
 #include "Serialization/ArchiveSaveCompressedProxy.h"
+#include "Misc/Compression.h"
 #include "TerrainZoneComponent.h"
 #include "Json.h"
 #include "JsonObjectConverter.h"
 #include "Core/VoxelDataInfo.hpp"
 #include "Core/TerrainData.hpp"
 #include "UnrealSandboxData.h"
+#include "Core/MeshDataSerialization.h"
 
 #include <bitset>
 
@@ -17,41 +19,7 @@
 // mesh data de/serealization
 //======================================================================================================================================================================
 
-void SerializeMeshContainer(const TMeshContainer& MeshContainer, usbt::TFastUnsafeSerializer& Serializer) {
-	// save regular materials
-	int32 LodSectionRegularMatNum = MeshContainer.MaterialSectionMap.Num();
-	Serializer << LodSectionRegularMatNum;
-	for (auto& Elem : MeshContainer.MaterialSectionMap) {
-		unsigned short MatId = Elem.Key;
-		const TMeshMaterialSection& MaterialSection = Elem.Value;
-
-		Serializer << MatId;
-
-		const FProcMeshSection& Mesh = MaterialSection.MaterialMesh;
-		Mesh.SerializeMesh(Serializer);
-	}
-
-	// save transition materials
-	int32 LodSectionTransitionMatNum = MeshContainer.MaterialTransitionSectionMap.Num();
-	Serializer << LodSectionTransitionMatNum;
-	for (auto& Elem : MeshContainer.MaterialTransitionSectionMap) {
-		unsigned short MatId = Elem.Key;
-		const TMeshMaterialTransitionSection& TransitionMaterialSection = Elem.Value;
-
-		Serializer << MatId;
-
-		int MatSetSize = TransitionMaterialSection.MaterialIdSet.size();
-		Serializer << MatSetSize;
-
-		for (unsigned short MatSetElement : TransitionMaterialSection.MaterialIdSet) {
-			Serializer << MatSetElement;
-		}
-
-		const FProcMeshSection& Mesh = TransitionMaterialSection.MaterialMesh;
-		Mesh.SerializeMesh(Serializer);
-	}
-}
-
+// legacy format (0): zlib archive proxy
 TDataPtr Compress(TDataPtr CompressedDataPtr) {
 	TDataPtr Result = std::make_shared<TData>();
 	TArray<uint8> BinaryArray;
@@ -71,135 +39,163 @@ TDataPtr Compress(TDataPtr CompressedDataPtr) {
 }
 
 TDataPtr SerializeMeshData(TMeshDataPtr MeshDataPtr) {
-	usbt::TFastUnsafeSerializer Serializer;
-
-	int32 LodArraySize = MeshDataPtr->MeshSectionLodArray.Num();
-	Serializer << LodArraySize;
-
-	for (int32 LodIdx = 0; LodIdx < LodArraySize; LodIdx++) {
-		const TMeshLodSection& LodSection = MeshDataPtr->MeshSectionLodArray[LodIdx];
-		Serializer << LodIdx;
+	TDataPtr Result = Compress(SerializeMeshDataRaw(*MeshDataPtr));
+	return Result;
+}
 
-		// save whole mesh
-		LodSection.WholeMesh.SerializeMesh(Serializer);
+TDataPtr LoadDataFromKvFile(int32 FileId, const TVoxelIndex& Index, TFileItmType ItemType) {
 
-		SerializeMeshContainer(LodSection.RegularMeshContainer, Serializer);
+	//UE_LOG(LogVt, Log, TEXT("LoadDataFromKvFile -> %d %d %d %d"), Index.X, Index.Y, Index.Z, ItemType);
 
-		if (LodIdx > 0) {
-			for (auto i = 0; i < 6; i++) {
-				SerializeMeshContainer(LodSection.TransitionPatchArray[i], Serializer);
-			}
-		}
+	TFileItmKey Key{ Index, ItemType };
+	TDataPtr DataPtr = FKvdb::LoadData(FileId, Key);
+	if (DataPtr == nullptr || DataPtr->size() == 0) {
+		return nullptr;
 	}
-
-	TDataPtr Result = Compress(Serializer.data());
-	return Result;
+	return DataPtr;
 }
 
-void DeserializeMeshContainerFast(TMeshContainer& MeshContainer, usbt::TFastUnsafeDeserializer& Deserializer) {
-	// regular materials
-	int32 LodSectionRegularMatNum;
-	Deserializer >> LodSectionRegularMatNum;
-
-	for (int RMatIdx = 0; RMatIdx < LodSectionRegularMatNum; RMatIdx++) {
-		unsigned short MatId;
-		Deserializer >> MatId;
+// uncompressed size from stored header is rejected above this limit before buffer is allocated.
+// zone voxel data multiplied by factor, zone mesh with all LODs is far below it
+static constexpr uint64 ZoneVoxelDim = (1 << (LOD_ARRAY_SIZE - 1)) + 1;
+static constexpr uint32 CodecMaxRawSize = ZoneVoxelDim * ZoneVoxelDim * ZoneVoxelDim * (sizeof(TDensityVal) + sizeof(TMaterialId)) * 64;
 
-		TMeshMaterialSection& MatSection = MeshContainer.MaterialSectionMap.FindOrAdd(MatId);
-		MatSection.MaterialId = MatId;
+// Data is view of compressed data, for example part of loaded kv file item
+TDataPtr Decompress(const uint8* Data, size_t Size) {
+	TDataPtr Result = std::make_shared<TData>();
+	TArray<uint8> BinaryArray;
+	BinaryArray.SetNum(Size);
+	FMemory::Memcpy(BinaryArray.GetData(), Data, Size);
 
-		MatSection.MaterialMesh.DeserializeMeshFast(Deserializer);
+	FArchiveLoadCompressedProxy Decompressor = FArchiveLoadCompressedProxy(BinaryArray, NAME_Zlib);
+	if (Decompressor.GetError()) {
+		//UE_LOG(LogVt, Log, TEXT("FArchiveLoadCompressedProxy -> ERROR : File was not compressed"));
+		return Result;
 	}
 
-	// transition materials
-	int32 LodSectionTransitionMatNum;
-	Deserializer >> LodSectionTransitionMatNum;
-
-	for (int TMatIdx = 0; TMatIdx < LodSectionTransitionMatNum; TMatIdx++) {
-		unsigned short MatId;
-		Deserializer >> MatId;
+	// compressed stream is serialized TArray<uint8>: element count, then bytes. unpack bytes directly to result
+	int32 DecompressedSize = 0;
+	Decompressor << DecompressedSize;
+	if (DecompressedSize <= 0 || (uint32)DecompressedSize > CodecMaxRawSize) {
+		return Result;
+	}
 
-		int MatSetSize;
-		Deserializer >> MatSetSize;
+	Result->resize(DecompressedSize);
+	Decompressor.Serialize(Result->data(), DecompressedSize);
+	Decompressor.FlushCache();
 
-		std::set<unsigned short> MatSet;
-		for (int MatSetIdx = 0; MatSetIdx < MatSetSize; MatSetIdx++) {
-			unsigned short MatSetElement;
-			Deserializer >> MatSetElement;
+	//UE_LOG(LogVt, Log, TEXT("DecompressedData -> %d bytes ==> %d bytes"), DecompressedSize, Size);
+	return Result;
+}
 
-			MatSet.insert(MatSetElement);
-		}
+TDataPtr Decompress(TDataPtr CompressedDataPtr) {
+	return Decompress(CompressedDataPtr->data(), CompressedDataPtr->size());
+}
 
-		TMeshMaterialTransitionSection& MatTransSection = MeshContainer.MaterialTransitionSectionMap.FindOrAdd(MatId);
-		MatTransSection.MaterialId = MatId;
-		MatTransSection.MaterialIdSet = MatSet;
+// format 1: codec byte, uncompressed size, data
+#define USBT_CODEC_HEADER_SIZE (sizeof(uint8) + sizeof(uint32))
 
-		MatTransSection.MaterialMesh.DeserializeMeshFast(Deserializer);
+static FName GetCodecFormatName(ESandboxTerrainDataCodec Codec) {
+	switch (Codec) {
+		case ESandboxTerrainDataCodec::Zlib: return NAME_Zlib;
+		case ESandboxTerrainDataCodec::LZ4: return NAME_LZ4;
+		case ESandboxTerrainDataCodec::Oodle: return NAME_Oodle;
+		default: return NAME_None;
 	}
 }
 
-TMeshDataPtr DeserializeMeshDataFast(const std::vector<uint8>& Data, uint32 CollisionMeshSectionLodIndex) {
-	TMeshDataPtr MeshDataPtr(new TMeshData);
-	usbt::TFastUnsafeDeserializer Deserializer(Data.data());
+static TDataPtr StoreUncompressed(const TData& Data) {
+	TDataPtr Result = std::make_shared<TData>(USBT_CODEC_HEADER_SIZE + Data.size());
+	const uint32 RawSize = Data.size();
+	(*Result)[0] = (uint8)ESandboxTerrainDataCodec::None;
+	FMemory::Memcpy(Result->data() + sizeof(uint8), &RawSize, sizeof(uint32));
+	FMemory::Memcpy(Result->data() + USBT_CODEC_HEADER_SIZE, Data.data(), Data.size());
+	return Result;
+}
 
-	int32 LodArraySize;
-	Deserializer >> LodArraySize;
+// stored uncompressed if codec fails or does not reduce size
+TDataPtr CompressWithCodec(const TData& Data, ESandboxTerrainDataCodec Codec) {
+	const FName FormatName = GetCodecFormatName(Codec);
+	if (FormatName == NAME_None || Data.size() == 0) {
+		return StoreUncompressed(Data);
+	}
 
-	for (int LodIdx = 0; LodIdx < LodArraySize; LodIdx++) {
-		int32 LodIndex;
-		Deserializer >> LodIndex;
+	const int32 RawSize = Data.size();
+	int32 CompressedSize = FCompression::CompressMemoryBound(FormatName, RawSize);
 
-		// whole mesh
-		MeshDataPtr.get()->MeshSectionLodArray[LodIndex].WholeMesh.DeserializeMeshFast(Deserializer);
-		DeserializeMeshContainerFast(MeshDataPtr.get()->MeshSectionLodArray[LodIndex].RegularMeshContainer, Deserializer);
+	TDataPtr Result = std::make_shared<TData>(USBT_CODEC_HEADER_SIZE + CompressedSize);
+	if (!FCompression::CompressMemory(FormatName, Result->data() + USBT_CODEC_HEADER_SIZE, CompressedSize, Data.data(), RawSize) || CompressedSize >= RawSize) {
+		return StoreUncompressed(Data);
+	}
 
-		if (LodIdx > 0) {
-			for (auto i = 0; i < 6; i++) {
-				DeserializeMeshContainerFast(MeshDataPtr.get()->MeshSectionLodArray[LodIndex].TransitionPatchArray[i], Deserializer);
-			}
-		}
+	(*Result)[0] = (uint8)Codec;
+	FMemory::Memcpy(Result->data() + sizeof(uint8), &RawSize, sizeof(uint32));
+	Result->resize(USBT_CODEC_HEADER_SIZE + CompressedSize);
+	return Result;
+}
+
+// data stored without compression can be read in place. returns nullptr if data is compressed or broken
+const uint8* GetUncompressedPayload(const uint8* Data, size_t Size) {
+	if (Size < USBT_CODEC_HEADER_SIZE || (ESandboxTerrainDataCodec)Data[0] != ESandboxTerrainDataCodec::None) {
+		return nullptr;
 	}
 
-	MeshDataPtr.get()->CollisionMeshPtr = &MeshDataPtr.get()->MeshSectionLodArray[CollisionMeshSectionLodIndex].WholeMesh;
-	return MeshDataPtr;
+	uint32 RawSize;
+	FMemory::Memcpy(&RawSize, Data + sizeof(uint8), sizeof(uint32));
+	return (RawSize > 0 && RawSize == Size - USBT_CODEC_HEADER_SIZE) ? Data + USBT_CODEC_HEADER_SIZE : nullptr;
 }
 
-TDataPtr LoadDataFromKvFile(int32 FileId, const TVoxelIndex& Index, TFileItmType ItemType) {
+// returns nullptr if data is broken or codec is unknown
+TDataPtr DecompressWithCodec(const uint8* Data, size_t Size) {
+	if (Size < USBT_CODEC_HEADER_SIZE) {
+		return nullptr;
+	}
 
-	//UE_LOG(LogVt, Log, TEXT("LoadDataFromKvFile -> %d %d %d %d"), Index.X, Index.Y, Index.Z, ItemType);
+	const ESandboxTerrainDataCodec Codec = (ESandboxTerrainDataCodec)Data[0];
+	uint32 RawSize;
+	FMemory::Memcpy(&RawSize, Data + sizeof(uint8), sizeof(uint32));
 
-	TFileItmKey Key{ Index, ItemType };
-	TDataPtr DataPtr = FKvdb::LoadData(FileId, Key);
-	if (DataPtr == nullptr || DataPtr->size() == 0) {
+	if (RawSize > CodecMaxRawSize) {
+		UE_LOG(LogVt, Error, TEXT("Unable to decompress terrain data: codec %d, uncompressed size %u is over limit"), (int32)Codec, RawSize);
 		return nullptr;
 	}
-	return DataPtr;
-}
 
-TDataPtr Decompress(TDataPtr CompressedDataPtr) {
-	TDataPtr Result = std::make_shared<TData>();
-	TArray<uint8> BinaryArray;
-	BinaryArray.SetNum(CompressedDataPtr->size());
-	FMemory::Memcpy(BinaryArray.GetData(), CompressedDataPtr->data(), CompressedDataPtr->size());
+	const uint8* Payload = Data + USBT_CODEC_HEADER_SIZE;
+	const int32 PayloadSize = Size - USBT_CODEC_HEADER_SIZE;
 
-	FArchiveLoadCompressedProxy Decompressor = FArchiveLoadCompressedProxy(BinaryArray, NAME_Zlib);
-	if (Decompressor.GetError()) {
-		//UE_LOG(LogVt, Log, TEXT("FArchiveLoadCompressedProxy -> ERROR : File was not compressed"));
+	TDataPtr Result = std::make_shared<TData>(RawSize);
+	if (Codec == ESandboxTerrainDataCodec::None) {
+		if ((uint32)PayloadSize != RawSize) {
+			return nullptr;
+		}
+
+		FMemory::Memcpy(Result->data(), Payload, RawSize);
 		return Result;
 	}
 
-	TArray<uint8> DecompressedData;
-	Decompressor << DecompressedData;
+	const FName FormatName = GetCodecFormatName(Codec);
+	if (FormatName == NAME_None || !FCompression::UncompressMemory(FormatName, Result->data(), RawSize, Payload, PayloadSize)) {
+		UE_LOG(LogVt, Error, TEXT("Unable to decompress terrain data: codec %d, %d bytes"), (int32)Codec, PayloadSize);
+		return nullptr;
+	}
 
-	float CompressionRatio = ((float)CompressedDataPtr->size() / (float)DecompressedData.Num()) * 100.f;
-	//UE_LOG(LogVt, Log, TEXT("DecompressedData -> %d bytes ==> %d bytes -> %f%%"), DecompressedData.Num(), CompressedDataPtr->size(), CompressionRatio);
+	return Result;
+}
 
-	Result->resize(DecompressedData.Num());
-	FMemory::Memcpy(Result->data(), DecompressedData.GetData(), DecompressedData.Num());
-	Decompressor.FlushCache();
-	DecompressedData.Empty();
+TDataPtr ASandboxTerrainController::CompressData(TDataPtr Data, uint32 FormatVersion) const {
+	if (FormatVersion == 0) {
+		return Compress(Data);
+	}
 
-	return Result;
+	return CompressWithCodec(*Data, DataCodec);
+}
+
+TDataPtr ASandboxTerrainController::DecompressData(const uint8* Data, size_t Size, uint32 FormatVersion) const {
+	if (FormatVersion == 0) {
+		return Decompress(Data, Size);
+	}
+
+	return DecompressWithCodec(Data, Size);
 }
 
 //======================================================================================================================================================================
@@ -209,17 +205,36 @@ TDataPtr Decompress(TDataPtr CompressedDataPtr) {
 bool ASandboxTerrainController::LoadMeshAndObjectDataByIndex(const TVoxelIndex& Index, TMeshDataPtr& MeshData, TInstanceMeshTypeMap& ZoneInstMeshMap) const {
 	TDataPtr DataPtr = LoadDataFromKvFile(DataFileId, Index, TFileItmType::MESH_DATA);
 
-	if (DataPtr) {
+	if (DataPtr && DataPtr->size() >= sizeof(TKvFileZoneData)) {
 		usbt::TFastUnsafeDeserializer Deserializer(DataPtr->data());
 		TKvFileZoneData ZoneHeader;
 		Deserializer >> ZoneHeader;
 
-		if (ZoneHeader.LenMd > 0) {
-			TDataPtr CompressedMdPtr = std::make_shared<TData>();
-			CompressedMdPtr->resize(ZoneHeader.LenMd);
-			Deserializer.read(CompressedMdPtr->data(), ZoneHeader.LenMd);
-			auto DecompressedDataPtr = Decompress(CompressedMdPtr);
-			MeshData = DeserializeMeshDataFast(*DecompressedDataPtr, 0);
+		if (ZoneHeader.LenMd > DataPtr->size() - sizeof(TKvFileZoneData)) {
+			UE_LOG(LogVt, Error, TEXT("LoadMeshAndObjectDataByIndex error: broken mesh %d %d %d"), Index.X, Index.Y, Index.Z);
+		} else if (ZoneHeader.LenMd > 0) {
+			const bool bCompact = MapInfo.FormatVersion >= USBT_MAP_FORMAT_COMPACT_MESH;
+
+			// uncompressed mesh is read in place from loaded item, compressed one is decompressed to separate buffer
+			TMeshDataPtr LoadedMd = nullptr;
+			const uint8* RawMd = (MapInfo.FormatVersion > 0) ? GetUncompressedPayload(Deserializer.current(), ZoneHeader.LenMd) : nullptr;
+			if (RawMd) {
+				LoadedMd = DeserializeMeshDataFast(RawMd, ZoneHeader.LenMd - USBT_CODEC_HEADER_SIZE, 0, bCompact);
+			} else {
+				auto DecompressedDataPtr = DecompressData(Deserializer.current(), ZoneHeader.LenMd, MapInfo.FormatVersion);
+				if (DecompressedDataPtr && DecompressedDataPtr->size() > 0) {
+					LoadedMd = DeserializeMeshDataFast(*DecompressedDataPtr, 0, bCompact);
+				}
+			}
+
+			if (LoadedMd) {
+				TFileItmKey Key{ Index, TFileItmType::MESH_DATA };
+				std::bitset<sizeof(uint64)> ZoneFlags(FKvdb::GetKeyFlags(DataFileId, Key));
+				LoadedMd->bCollisionOnly = ZoneFlags.test((size_t)TZoneFlag::CollisionOnlyMesh);
+				MeshData = LoadedMd;
+			} else {
+				UE_LOG(LogVt, Error, TEXT("LoadMeshAndObjectDataByIndex error: broken mesh %d %d %d"), Index.X, Index.Y, Index.Z);
+			}
 		}
 
 		TDataPtr ObjDataPtr = LoadDataFromKvFile(DataFileId, Index, TFileItmType::OBJ_DATA);
@@ -246,9 +261,14 @@ TVoxelData* ASandboxTerrainController::LoadVoxelDataByIndex(const TVoxelIndex& I
 
 	TDataPtr DataPtr = LoadDataFromKvFile(DataFileId, Index, TFileItmType::VOXEL_DATA);
 	if (DataPtr) {
-		DeserializeVd(DataPtr, Vd);
+		if (!DeserializeVd(DataPtr, Vd, MapInfo.FormatVersion)) {
+			UE_LOG(LogVt, Error, TEXT("LoadVoxelDataByIndex error: broken vd %d %d %d"), Index.X, Index.Y, Index.Z);
+			delete Vd;
+			return nullptr;
+		}
 	} else {
 		UE_LOG(LogVt, Warning, TEXT("LoadVoxelDataByIndex error: no vd found in file"));
+		delete Vd;
 		return nullptr;
 	}
 
@@ -262,10 +282,15 @@ TVoxelData* ASandboxTerrainController::LoadVoxelDataByIndex(const TVoxelIndex& I
 // serialize vd
 //======================================================================================================================================================================
 
-TDataPtr ASandboxTerrainController::SerializeVd(TVoxelData* Vd) const {
+TDataPtr ASandboxTerrainController::SerializeVd(TVoxelData* Vd, uint32 FormatVersion) const {
 	TDataPtr Data = Vd->serialize();
 	size_t DataSize = Data->size();
+
+	if (FormatVersion > 0) {
+		return CompressData(Data, FormatVersion);
+	}
 	
+	// legacy: small vd without volumes is not compressed
 	size_t TTT = sizeof(TVoxelDataHeader) + sizeof(uint32);
 	if (DataSize > TTT) {
 		TDataPtr CompressedData = Compress(Data);
@@ -275,14 +300,19 @@ TDataPtr ASandboxTerrainController::SerializeVd(TVoxelData* Vd) const {
 	return Data;
 }
 
-void ASandboxTerrainController::DeserializeVd(TDataPtr Data, TVoxelData* Vd) const {
+bool ASandboxTerrainController::DeserializeVd(TDataPtr Data, TVoxelData* Vd, uint32 FormatVersion) const {
+	if (FormatVersion > 0) {
+		auto DecompressedDataPtr = DecompressData(Data->data(), Data->size(), FormatVersion);
+		return DecompressedDataPtr && deserializeVoxelData(Vd, *DecompressedDataPtr);
+	}
+
 	size_t TTT = sizeof(TVoxelDataHeader) + sizeof(uint32);
 	if (Data->size() > TTT) {
 		auto DecompressedDataPtr = Decompress(Data);
-		deserializeVoxelData(Vd, *DecompressedDataPtr);
-	} else {
-		deserializeVoxelData(Vd, *Data);
+		return deserializeVoxelData(Vd, *DecompressedDataPtr);
 	}
+
+	return deserializeVoxelData(Vd, *Data);
 }
 
 //======================================================================================================================================================================
@@ -342,17 +372,22 @@ void ASandboxTerrainController::CloseFile() {
 // save
 //======================================================================================================================================================================
 
-uint32 SaveZoneToFile(TVoxelDataInfoPtr VdInfoPtr, uint32 KvFileId, const TVoxelIndex& Index, const TDataPtr DataVd, const TDataPtr DataMd, const TDataPtr DataObj) {
+uint32 SaveZoneToFile(TVoxelDataInfoPtr VdInfoPtr, uint32 KvFileId, const TVoxelIndex& Index, const TDataPtr DataVd, const TDataPtr DataMd, const TDataPtr DataObj, bool bCollisionOnlyMesh = false) {
 	TKvFileZoneData ZoneHeader;
 
 	std::bitset<sizeof(uint64)> ZoneFlags(0);
 
-	if (!DataVd) {
+	// not loaded voxel data is already stored, only mesh is saved (see GenerateZoneLod)
+	if (!DataVd && VdInfoPtr->DataState != TVoxelDataState::READY_TO_LOAD) {
 		ZoneFlags.set((size_t)TZoneFlag::NoVoxelData);
 	}
 
 	if (DataMd) {
 		ZoneHeader.LenMd = DataMd->size();
+
+		if (bCollisionOnlyMesh) {
+			ZoneFlags.set((size_t)TZoneFlag::CollisionOnlyMesh);
+		}
 	} else {
 		ZoneFlags.set((size_t)TZoneFlag::NoMesh);
 
@@ -395,11 +430,11 @@ void ASandboxTerrainController::ForceSave(const TVoxelIndex& ZoneIndex, TVoxelDa
 	TDataPtr DataObj = nullptr;
 
 	if (Vd) {
-		DataVd = SerializeVd(Vd);
+		DataVd = SerializeVd(Vd, MapInfo.FormatVersion);
 	}
 
 	if (MeshDataPtr) {
-		DataMd = SerializeMeshData(MeshDataPtr);
+		DataMd = CompressData(SerializeMeshDataRaw(*MeshDataPtr, MapInfo.FormatVersion >= USBT_MAP_FORMAT_COMPACT_MESH), MapInfo.FormatVersion);
 	}
 
 	if (InstanceObjectMap.Num() > 0) {
@@ -421,7 +456,7 @@ void ASandboxTerrainController::Save(std::function<void(uint32, uint32)> OnProgr
 	double Start = FPlatformTime::Seconds();
 
 	uint32 SavedCount = 0;
-	std::unordered_set<TVoxelIndex> SaveIndexSet = TerrainData->PopSaveIndexSet();
+	TFlatSet<TVoxelIndex> SaveIndexSet = TerrainData->PopSaveIndexSet();
 	uint32 Total = (uint32)SaveIndexSet.size();
 	for (const TVoxelIndex& Index : SaveIndexSet) {
 		TVoxelDataInfoPtr VdInfoPtr = TerrainData->GetVoxelDataInfo(Index);
@@ -429,18 +464,20 @@ void ASandboxTerrainController::Save(std::function<void(uint32, uint32)> OnProgr
 		TDataPtr DataVd = nullptr;
 		TDataPtr DataMd = nullptr;
 		TDataPtr DataObj = nullptr;
+		bool bCollisionOnlyMesh = false;
 
 		VdInfoPtr->Lock();
 		bool bSave = false;
 
 		if (VdInfoPtr->IsNeedTerrainSave()) {
 			if (VdInfoPtr->Vd && VdInfoPtr->CanSaveVd()) {
-				DataVd = SerializeVd(VdInfoPtr->Vd);
+				DataVd = SerializeVd(VdInfoPtr->Vd, MapInfo.FormatVersion);
 			}
 
 			auto MeshDataPtr = VdInfoPtr->PopMeshDataCache();
 			if (MeshDataPtr) {
-				DataMd = SerializeMeshData(MeshDataPtr);
+				DataMd = CompressData(SerializeMeshDataRaw(*MeshDataPtr, MapInfo.FormatVersion >= USBT_MAP_FORMAT_COMPACT_MESH), MapInfo.FormatVersion);
+				bCollisionOnlyMesh = MeshDataPtr->bCollisionOnly;
 			}
 			else {
 				if (VdInfoPtr->Vd && VdInfoPtr->Vd->getDensityFillState() == MIXED)
@@ -479,7 +516,7 @@ void ASandboxTerrainController::Save(std::function<void(uint32, uint32)> OnProgr
 		}
 
 		if (bSave) {
-			uint32 CRC = SaveZoneToFile(VdInfoPtr, DataFileId, Index, DataVd, DataMd, DataObj);
+			uint32 CRC = SaveZoneToFile(VdInfoPtr, DataFileId, Index, DataVd, DataMd, DataObj, bCollisionOnlyMesh);
 		}
 
 		SavedCount++;
@@ -495,6 +532,7 @@ void ASandboxTerrainController::Save(std::function<void(uint32, uint32)> OnProgr
 		}
 
 		VdInfoPtr->Unload();
+		TerrainData->SetEditMesh(Index, nullptr);
 		VdInfoPtr->Unlock();
 	}
 
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "VoxelIndex.h"
+#include "VoxelMeshData.h"
+#include "FlatMap.h"
+#include <list>
+#include <mutex>
+
+// Last mesh generated by terrain edit of each zone, base for partial remesh of next edit of the same zone.
+// Such mesh keeps cell info buffers, so only few recently edited zones have it: least recently edited is dropped over limit.
+// Own mutex is taken under zone lock only and never the other way, zone lock guards use of returned mesh.
+class TEditMeshCache {
+
+private:
+
+	struct TItem {
+		TVoxelIndex zone_index;
+		TMeshDataPtr mesh_data;
+	};
+
+	std::mutex mutex;
+	std::list<TItem> item_list;
+	TFlatMap<TVoxelIndex, std::list<TItem>::iterator> item_map;
+
+	size_t max_size;
+
+public:
+
+	TEditMeshCache(size_t size_limit) : max_size(size_limit) {
+
+	}
+
+	TMeshDataPtr find(const TVoxelIndex& zone_index) {
+		const std::lock_guard<std::mutex> lock(mutex);
+		auto* it = item_map.find(zone_index);
+		return it ? (*it)->mesh_data : nullptr;
+	}
+
+	// nullptr removes zone mesh
+	void put(const TVoxelIndex& zone_index, TMeshDataPtr mesh_data) {
+		// meshes are released after unlock
+		TMeshDataPtr dropped = nullptr;
+		TMeshDataPtr evicted = nullptr;
+
+		const std::lock_guard<std::mutex> lock(mutex);
+		auto* it = item_map.find(zone_index);
+		if (it) {
+			dropped = std::move((*it)->mesh_data);
+			item_list.erase(*it);
+			item_map.erase(zone_index);
+		}
+
+		if (!mesh_data) {
+			return;
+		}
+
+		item_list.push_front(TItem{ zone_index, std::move(mesh_data) });
+		item_map.insert(zone_index, item_list.begin());
+
+		if (item_list.size() > max_size) {
+			TItem& last = item_list.back();
+			evicted = std::move(last.mesh_data);
+			item_map.erase(last.zone_index);
+			item_list.pop_back();
+		}
+	}
+
+	void clear() {
+		const std::lock_guard<std::mutex> lock(mutex);
+		item_map.clear();
+		item_list.clear();
+	}
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "VoxelIndex.h"
+#include "FlatMap.h"
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+// Append-only history of zone VStamp changes, one entry per map version (MapVerHash).
+// Client which has map version N gets only zones changed since N instead of whole modified zone map.
+// Oldest entries are dropped when log is over size limit, then clients with older version need whole map.
+class TMapVersionLog {
+
+public:
+
+	struct TEntry {
+		TVoxelIndex zone_index;
+		uint32_t vstamp;
+	};
+
+private:
+
+	struct TLogItem {
+		uint32_t map_version;
+		TEntry entry;
+	};
+
+	std::mutex mutex;
+	std::deque<TLogItem> item_list;
+
+	// log contains all changes made after this version
+	uint32_t base_version = 0;
+	uint32_t last_version = 0;
+
+	size_t max_size;
+
+public:
+
+	TMapVersionLog(size_t size_limit) : max_size(size_limit) {
+
+	}
+
+	void add(uint32_t map_version, const TVoxelIndex& zone_index, uint32_t vstamp) {
+		const std::lock_guard<std::mutex> lock(mutex);
+		item_list.push_back(TLogItem{ map_version, TEntry{ zone_index, vstamp } });
+		last_version = map_version;
+
+		while (item_list.size() > max_size) {
+			base_version = item_list.front().map_version;
+			item_list.pop_front();
+		}
+	}
+
+	// last VStamp of each zone changed after from_version, sorted by index.
+	// false if log is truncated or client version is unknown, whole map should be sent then
+	bool get(uint32_t from_version, uint32_t& to_version, std::vector<TEntry>& out) {
+		out.clear();
+
+		const std::lock_guard<std::mutex> lock(mutex);
+		if (from_version < base_version || from_version > last_version) {
+			return false;
+		}
+
+		to_version = last_version;
+
+		TFlatMap<TVoxelIndex, uint32_t> zone_map;
+		auto it = std::upper_bound(item_list.begin(), item_list.end(), from_version, [](uint32_t v, const TLogItem& itm) { return v < itm.map_version; });
+		for (; it != item_list.end(); ++it) {
+			zone_map.findOrAdd(it->entry.zone_index) = it->entry.vstamp;
+		}
+
+		out.reserve(zone_map.size());
+		for (const auto& itm : zone_map) {
+			out.push_back(TEntry{ itm.first, itm.second });
+		}
+
+		std::sort(out.begin(), out.end(), [](const TEntry& a, const TEntry& b) {
+			const TVoxelIndex& i = a.zone_index;
+			const TVoxelIndex& j = b.zone_index;
+			return (i.X != j.X) ? i.X < j.X : (i.Y != j.Y) ? i.Y < j.Y : i.Z < j.Z;
+		});
+
+		return true;
+	}
+
+	// changes made before map_version are not known
+	void clear(uint32_t map_version) {
+		const std::lock_guard<std::mutex> lock(mutex);
+		item_list.clear();
+		base_version = map_version;
+		last_version = map_version;
+	}
+
+	//=====================================================================================
+	// encoding: varint count, then for each entry zigzag varint index delta from previous entry and varint vstamp
+	//=====================================================================================
+
+	static void writeVarint(std::vector<uint8_t>& data, uint32_t val) {
+		while (val >= 0x80) {
+			data.push_back((uint8_t)(val | 0x80));
+			val >>= 7;
+		}
+
+		data.push_back((uint8_t)val);
+	}
+
+	static bool readVarint(const uint8_t*& ptr, const uint8_t* end, uint32_t& val) {
+		val = 0;
+		for (int shift = 0; shift < 35 && ptr < end; shift += 7) {
+			const uint8_t b = *ptr++;
+			val |= (uint32_t)(b & 0x7f) << shift;
+			if (!(b & 0x80)) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	static uint32_t zigzag(int32_t v) {
+		return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+	}
+
+	static int32_t unzigzag(uint32_t v) {
+		return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+	}
+
+	static void encode(const std::vector<TEntry>& entry_list, std::vector<uint8_t>& data) {
+		data.reserve(data.size() + 5 + entry_list.size() * 5);
+		writeVarint(data, (uint32_t)entry_list.size());
+
+		TVoxelIndex prev(0, 0, 0);
+		for (const auto& e : entry_list) {
+			writeVarint(data, zigzag(e.zone_index.X - prev.X));
+			writeVarint(data, zigzag(e.zone_index.Y - prev.Y));
+			writeVarint(data, zigzag(e.zone_index.Z - prev.Z));
+			writeVarint(data, e.vstamp);
+			prev = e.zone_index;
+		}
+	}
+
+	static bool decode(const uint8_t* data, size_t size, std::vector<TEntry>& entry_list) {
+		const uint8_t* ptr = data;
+		const uint8_t* end = data + size;
+
+		uint32_t count;
+		if (!readVarint(ptr, end, count) || count > size) {
+			return false;
+		}
+
+		entry_list.clear();
+		entry_list.reserve(count);
+
+		TVoxelIndex prev(0, 0, 0);
+		for (uint32_t i = 0; i < count; i++) {
+			uint32_t dx, dy, dz, vstamp;
+			if (!readVarint(ptr, end, dx) || !readVarint(ptr, end, dy) || !readVarint(ptr, end, dz) || !readVarint(ptr, end, vstamp)) {
+				return false;
+			}
+
+			prev = TVoxelIndex(prev.X + unzigzag(dx), prev.Y + unzigzag(dy), prev.Z + unzigzag(dz));
+			entry_list.push_back(TEntry{ prev, vstamp });
+		}
+
+		return ptr == end;
+	}
+};
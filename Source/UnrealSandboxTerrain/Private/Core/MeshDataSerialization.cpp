@@ -0,0 +1,212 @@
+
+#include "MeshDataSerialization.h"
+
+
+//======================================================================================================================================================================
+// mesh data de/serealization
+//======================================================================================================================================================================
+
+static void SerializeSectionMesh(const FProcMeshSection& Mesh, usbt::TFastUnsafeSerializer& Serializer, bool bCompact) {
+	if (bCompact) {
+		Mesh.SerializeMeshCompact(Serializer);
+	} else {
+		Mesh.SerializeMesh(Serializer);
+	}
+}
+
+static bool DeserializeSectionMesh(FProcMeshSection& Mesh, usbt::TFastUnsafeDeserializer& Deserializer, const uint8* End, bool bCompact) {
+	if (bCompact) {
+		return Mesh.DeserializeMeshCompact(Deserializer, End);
+	}
+
+	return Mesh.DeserializeMeshFast(Deserializer, End);
+}
+
+template <typename T>
+static bool ReadChecked(usbt::TFastUnsafeDeserializer& Deserializer, const uint8* End, T& Val) {
+	if (Deserializer.available(End) < sizeof(T)) {
+		return false;
+	}
+
+	Deserializer >> Val;
+	return true;
+}
+
+void SerializeMeshContainer(const TMeshContainer& MeshContainer, usbt::TFastUnsafeSerializer& Serializer, bool bCompact) {
+	// save regular materials
+	int32 LodSectionRegularMatNum = MeshContainer.MaterialSectionMap.Num();
+	Serializer << LodSectionRegularMatNum;
+	for (auto& Elem : MeshContainer.MaterialSectionMap) {
+		unsigned short MatId = Elem.Key;
+		const TMeshMaterialSection& MaterialSection = Elem.Value;
+
+		Serializer << MatId;
+
+		const FProcMeshSection& Mesh = MaterialSection.MaterialMesh;
+		SerializeSectionMesh(Mesh, Serializer, bCompact);
+	}
+
+	// save transition materials
+	int32 LodSectionTransitionMatNum = MeshContainer.MaterialTransitionSectionMap.Num();
+	Serializer << LodSectionTransitionMatNum;
+	for (auto& Elem : MeshContainer.MaterialTransitionSectionMap) {
+		unsigned short MatId = Elem.Key;
+		const TMeshMaterialTransitionSection& TransitionMaterialSection = Elem.Value;
+
+		Serializer << MatId;
+
+		int MatSetSize = TransitionMaterialSection.MaterialIdSet.size();
+		Serializer << MatSetSize;
+
+		for (unsigned short MatSetElement : TransitionMaterialSection.MaterialIdSet) {
+			Serializer << MatSetElement;
+		}
+
+		const FProcMeshSection& Mesh = TransitionMaterialSection.MaterialMesh;
+		SerializeSectionMesh(Mesh, Serializer, bCompact);
+	}
+}
+
+std::shared_ptr<std::vector<uint8>> SerializeMeshDataRaw(const TMeshData& MeshData, bool bCompact) {
+	usbt::TFastUnsafeSerializer Serializer;
+
+	// extracted LODs only
+	int32 LodArraySize = 0;
+	for (int32 LodIdx = 0; LodIdx < MeshData.MeshSectionLodArray.Num(); LodIdx++) {
+		if (MeshData.HasLod(LodIdx)) {
+			LodArraySize++;
+		}
+	}
+
+	Serializer << LodArraySize;
+
+	for (int32 LodIdx = 0; LodIdx < MeshData.MeshSectionLodArray.Num(); LodIdx++) {
+		if (!MeshData.HasLod(LodIdx)) {
+			continue;
+		}
+
+		const TMeshLodSection& LodSection = MeshData.MeshSectionLodArray[LodIdx];
+		Serializer << LodIdx;
+
+		// save whole mesh
+		SerializeSectionMesh(LodSection.WholeMesh, Serializer, bCompact);
+
+		SerializeMeshContainer(LodSection.RegularMeshContainer, Serializer, bCompact);
+
+		if (LodIdx > 0) {
+			for (auto i = 0; i < 6; i++) {
+				SerializeMeshContainer(LodSection.TransitionPatchArray[i], Serializer, bCompact);
+			}
+		}
+	}
+
+	return Serializer.data();
+}
+
+bool DeserializeMeshContainerFast(TMeshContainer& MeshContainer, usbt::TFastUnsafeDeserializer& Deserializer, const uint8* End, bool bCompact) {
+	// regular materials
+	int32 LodSectionRegularMatNum;
+	if (!ReadChecked(Deserializer, End, LodSectionRegularMatNum)) {
+		return false;
+	}
+
+	for (int RMatIdx = 0; RMatIdx < LodSectionRegularMatNum; RMatIdx++) {
+		unsigned short MatId;
+		if (!ReadChecked(Deserializer, End, MatId)) {
+			return false;
+		}
+
+		TMeshMaterialSection& MatSection = MeshContainer.MaterialSectionMap.FindOrAdd(MatId);
+		MatSection.MaterialId = MatId;
+
+		if (!DeserializeSectionMesh(MatSection.MaterialMesh, Deserializer, End, bCompact)) {
+			return false;
+		}
+	}
+
+	// transition materials
+	int32 LodSectionTransitionMatNum;
+	if (!ReadChecked(Deserializer, End, LodSectionTransitionMatNum)) {
+		return false;
+	}
+
+	for (int TMatIdx = 0; TMatIdx < LodSectionTransitionMatNum; TMatIdx++) {
+		unsigned short MatId;
+		int MatSetSize;
+		if (!ReadChecked(Deserializer, End, MatId) || !ReadChecked(Deserializer, End, MatSetSize)) {
+			return false;
+		}
+
+		std::set<unsigned short> MatSet;
+		for (int MatSetIdx = 0; MatSetIdx < MatSetSize; MatSetIdx++) {
+			unsigned short MatSetElement;
+			if (!ReadChecked(Deserializer, End, MatSetElement)) {
+				return false;
+			}
+
+			MatSet.insert(MatSetElement);
+		}
+
+		TMeshMaterialTransitionSection& MatTransSection = MeshContainer.MaterialTransitionSectionMap.FindOrAdd(MatId);
+		MatTransSection.MaterialId = MatId;
+		MatTransSection.MaterialIdSet = MatSet;
+
+		if (!DeserializeSectionMesh(MatTransSection.MaterialMesh, Deserializer, End, bCompact)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+TMeshDataPtr DeserializeMeshDataFast(const std::vector<uint8>& Data, uint32 CollisionMeshSectionLodIndex, bool bCompact) {
+	return DeserializeMeshDataFast(Data.data(), Data.size(), CollisionMeshSectionLodIndex, bCompact);
+}
+
+TMeshDataPtr DeserializeMeshDataFast(const uint8* Data, size_t Size, uint32 CollisionMeshSectionLodIndex, bool bCompact) {
+	TMeshDataPtr MeshDataPtr(new TMeshData);
+	usbt::TFastUnsafeDeserializer Deserializer(Data);
+	const uint8* End = Data + Size;
+
+	int32 LodArraySize;
+	if (!ReadChecked(Deserializer, End, LodArraySize) || LodArraySize < 0 || LodArraySize > LOD_ARRAY_SIZE) {
+		return nullptr;
+	}
+
+	MeshDataPtr->LodMask = 0;
+
+	for (int LodIdx = 0; LodIdx < LodArraySize; LodIdx++) {
+		int32 LodIndex;
+		if (!ReadChecked(Deserializer, End, LodIndex) || LodIndex < 0 || LodIndex >= LOD_ARRAY_SIZE || MeshDataPtr->HasLod(LodIndex)) {
+			return nullptr;
+		}
+
+		MeshDataPtr->LodMask |= 1u << LodIndex;
+		TMeshLodSection& LodSection = MeshDataPtr->MeshSectionLodArray[LodIndex];
+
+		// whole mesh
+		if (!DeserializeSectionMesh(LodSection.WholeMesh, Deserializer, End, bCompact) || !DeserializeMeshContainerFast(LodSection.RegularMeshContainer, Deserializer, End, bCompact)) {
+			return nullptr;
+		}
+
+		if (LodIndex > 0) {
+			for (auto i = 0; i < 6; i++) {
+				if (!DeserializeMeshContainerFast(LodSection.TransitionPatchArray[i], Deserializer, End, bCompact)) {
+					return nullptr;
+				}
+			}
+		}
+	}
+
+	// mesh without requested collision LOD collides with its most detailed LOD
+	uint32 CollisionLod = CollisionMeshSectionLodIndex;
+	if (MeshDataPtr->LodMask != 0 && !MeshDataPtr->HasLod(CollisionLod)) {
+		CollisionLod = 0;
+		while (!MeshDataPtr->HasLod(CollisionLod)) {
+			CollisionLod++;
+		}
+	}
+
+	MeshDataPtr->SetCollisionLod(CollisionLod);
+	return MeshDataPtr;
+}
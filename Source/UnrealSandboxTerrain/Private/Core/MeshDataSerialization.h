@@ -0,0 +1,20 @@
+#pragma once
+
+#include "EngineMinimal.h"
+#include "VoxelMeshData.h"
+#include "serialization.hpp"
+
+
+void SerializeMeshContainer(const TMeshContainer& MeshContainer, usbt::TFastUnsafeSerializer& Serializer, bool bCompact = false);
+
+// false if data before End is broken
+bool DeserializeMeshContainerFast(TMeshContainer& MeshContainer, usbt::TFastUnsafeDeserializer& Deserializer, const uint8* End, bool bCompact = false);
+
+// uncompressed mesh data. compact: quantized vertexes and 16-bit indexes, see FProcMeshSection::SerializeMeshCompact
+std::shared_ptr<std::vector<uint8>> SerializeMeshDataRaw(const TMeshData& MeshData, bool bCompact = false);
+
+// returns nullptr if data is broken
+TMeshDataPtr DeserializeMeshDataFast(const std::vector<uint8>& Data, uint32 CollisionMeshSectionLodIndex, bool bCompact = false);
+
+// same, reads mesh from memory it doesn't own, e.g. uncompressed mesh inside loaded file item
+TMeshDataPtr DeserializeMeshDataFast(const uint8* Data, size_t Size, uint32 CollisionMeshSectionLodIndex, bool bCompact = false);
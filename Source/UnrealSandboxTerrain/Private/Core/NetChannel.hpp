@@ -0,0 +1,554 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <mutex>
+#include <memory>
+#include <random>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+
+// datagram types of channel. first two words have the same layout as message opcode and opcode extension
+#define NET_CHANNEL_FRAGMENT	200
+#define NET_CHANNEL_ACK			201
+
+// Reliable message channel over unreliable datagrams, one per remote host.
+// Message is split to fragments, each fragment is one datagram with own sequence number. Receiver acknowledges
+// next expected sequence number (all below are received) and bitmap of received fragments above it.
+// Sender keeps up to window fragments in flight, fragment is sent again after retransmit timeout
+// or at once when fragment sent later is acknowledged before it (negative ack, time based as RACK in RFC 8985).
+// Messages are delivered when all fragments are received, order of messages is not kept.
+// Optional token bucket limits send rate: new fragments wait for tokens, retransmits are sent at once but take tokens too.
+// Datagrams are sent by send function under channel lock.
+class TNetChannel {
+
+public:
+
+	typedef std::function<void(const uint8_t* data, size_t size)> TSendFunc;
+
+	typedef std::vector<uint8_t> TMessage;
+
+private:
+
+	struct TFragmentHeader {
+		uint32_t op_code;
+		uint32_t op_code_ext;
+		uint32_t session;
+		uint32_t seq;
+		uint32_t message_id;
+		uint16_t fragment_index;
+		uint16_t fragment_count;
+	};
+
+	struct TAckHeader {
+		uint32_t op_code;
+		uint32_t op_code_ext;
+		uint32_t session;
+		uint32_t next_seq; // all fragments below are received
+		uint32_t word_num; // bitmap words follow, bit i is fragment next_seq + 1 + i
+	};
+
+	struct TOutMessage {
+		uint32_t id;
+		std::shared_ptr<const TMessage> data;
+		uint16_t fragment_count;
+		uint16_t next_fragment;
+	};
+
+	struct TInFlight {
+		uint32_t message_id;
+		TMessage datagram;
+		double first_send;
+		double last_send;
+		int send_count;
+	};
+
+	struct TPartialMessage {
+		std::vector<TMessage> fragment_array;
+		int received = 0;
+	};
+
+	std::mutex mutex;
+	TSendFunc send_func;
+
+	const int window;
+	const int fragment_size;
+
+	// sender
+	uint32_t session;
+	uint32_t next_seq = 0;
+	uint32_t next_message_id = 0;
+	std::deque<TOutMessage> out_queue;
+	std::map<uint32_t, TInFlight> in_flight;
+
+	// not acknowledged fragment count of each queued message
+	std::map<uint32_t, int> pending_map;
+
+	double srtt = 0;
+	double rttvar = 0;
+	double rto = 0.3;
+
+	// latest send time of acknowledged fragment
+	double rack_send_time = 0;
+
+	bool bBroken = false;
+	uint64_t retransmit_count = 0;
+
+	// pacing, bytes per second. 0 - not limited
+	double rate = 0;
+	double burst = 0;
+	double tokens = 0;
+	double token_time = 0;
+
+	// send statistics
+	uint64_t sent_bytes = 0;
+	uint64_t rate_window_bytes = 0;
+	double rate_window_start = 0;
+	double send_rate = 0;
+
+	static constexpr double RATE_WINDOW = 1.0;
+
+	// receiver
+	uint32_t rcv_session = 0;
+	uint32_t rcv_next_seq = 0;
+	std::set<uint32_t> rcv_ahead;
+	std::map<uint32_t, TPartialMessage> partial_map;
+	size_t partial_fragment_num = 0; // sum of fragment count of partial messages
+	int unacked_count = 0;
+	bool bAckPending = false;
+	double last_receive = 0;
+
+	static constexpr double MIN_RTO = 0.05;
+	static constexpr double MAX_RTO = 2.0;
+	static constexpr int MAX_SEND_COUNT = 30;
+	static constexpr int ACK_EVERY = 8;
+	static constexpr uint32_t MAX_ACK_WORDS = 64;
+
+	// limits of incomplete messages of receiver, fragment which exceeds them is not acknowledged and comes again
+	static constexpr size_t MAX_PARTIAL_MESSAGES = 256;
+	static constexpr size_t MAX_PARTIAL_FRAGMENTS = 0x20000;
+
+	template <typename T>
+	static void write(TMessage& buf, const T& val) {
+		const size_t pos = buf.size();
+		buf.resize(pos + sizeof(T));
+		memcpy(buf.data() + pos, &val, sizeof(T));
+	}
+
+	template <typename T>
+	static bool read(const uint8_t* data, size_t size, size_t& pos, T& val) {
+		if (pos + sizeof(T) > size) {
+			return false;
+		}
+
+		memcpy(&val, data + pos, sizeof(T));
+		pos += sizeof(T);
+		return true;
+	}
+
+	static uint32_t newSession() {
+		std::random_device rd;
+		uint32_t s;
+		do {
+			s = rd();
+		} while (s == 0);
+
+		return s;
+	}
+
+	void transmit(TInFlight& fragment, double now) {
+		if (fragment.send_count > 0) {
+			retransmit_count++;
+		}
+
+		fragment.last_send = now;
+		fragment.send_count++;
+		send_func(fragment.datagram.data(), fragment.datagram.size());
+
+		const size_t size = fragment.datagram.size();
+		if (rate > 0) {
+			tokens -= size;
+		}
+
+		sent_bytes += size;
+		rate_window_bytes += size;
+	}
+
+	void updateTokens(double now) {
+		if (rate > 0 && now > token_time) {
+			tokens = std::min(burst, tokens + (now - token_time) * rate);
+		}
+
+		token_time = now;
+
+		if (now - rate_window_start >= RATE_WINDOW) {
+			send_rate = rate_window_bytes / (now - rate_window_start);
+			rate_window_bytes = 0;
+			rate_window_start = now;
+		}
+	}
+
+	void fillWindow(double now) {
+		updateTokens(now);
+
+		while ((int)in_flight.size() < window && !out_queue.empty() && (rate == 0 || tokens > 0)) {
+			TOutMessage& msg = out_queue.front();
+
+			const size_t offset = (size_t)msg.next_fragment * fragment_size;
+			const size_t len = std::min((size_t)fragment_size, msg.data->size() - offset);
+
+			TFragmentHeader header{ NET_CHANNEL_FRAGMENT, 0, session, next_seq, msg.id, msg.next_fragment, msg.fragment_count };
+			TInFlight& fragment = in_flight[next_seq];
+			fragment.message_id = msg.id;
+			fragment.datagram.reserve(sizeof(header) + len);
+			write(fragment.datagram, header);
+			fragment.datagram.insert(fragment.datagram.end(), msg.data->begin() + offset, msg.data->begin() + offset + len);
+			fragment.first_send = now;
+			fragment.send_count = 0;
+			transmit(fragment, now);
+
+			next_seq++;
+			msg.next_fragment++;
+			if (msg.next_fragment == msg.fragment_count) {
+				out_queue.pop_front();
+			}
+		}
+	}
+
+	// RFC 6298, samples of retransmitted fragments are not used
+	void updateRto(double rtt) {
+		if (srtt == 0) {
+			srtt = rtt;
+			rttvar = rtt / 2;
+		} else {
+			rttvar = 0.75 * rttvar + 0.25 * std::abs(srtt - rtt);
+			srtt = 0.875 * srtt + 0.125 * rtt;
+		}
+
+		rto = std::clamp(srtt + 4 * rttvar, MIN_RTO, MAX_RTO);
+	}
+
+	void acknowledge(uint32_t seq, double now) {
+		auto it = in_flight.find(seq);
+		if (it != in_flight.end()) {
+			if (it->second.send_count == 1) {
+				updateRto(now - it->second.first_send);
+			}
+
+			rack_send_time = std::max(rack_send_time, it->second.last_send);
+
+			auto pending = pending_map.find(it->second.message_id);
+			if (pending != pending_map.end() && --pending->second == 0) {
+				pending_map.erase(pending);
+			}
+
+			in_flight.erase(it);
+		}
+	}
+
+	void sendAck() {
+		uint32_t word_num = 0;
+		if (!rcv_ahead.empty()) {
+			word_num = std::min((*rcv_ahead.rbegin() - rcv_next_seq - 1) / 64 + 1, MAX_ACK_WORDS);
+		}
+
+		std::vector<uint64_t> bitmap(word_num, 0);
+		for (uint32_t seq : rcv_ahead) {
+			const uint32_t bit = seq - rcv_next_seq - 1;
+			if (bit >= word_num * 64) {
+				break;
+			}
+
+			bitmap[bit / 64] |= 1ull << (bit % 64);
+		}
+
+		TMessage datagram;
+		datagram.reserve(sizeof(TAckHeader) + word_num * sizeof(uint64_t));
+		write(datagram, TAckHeader{ NET_CHANNEL_ACK, 0, rcv_session, rcv_next_seq, word_num });
+		for (uint64_t word : bitmap) {
+			write(datagram, word);
+		}
+
+		send_func(datagram.data(), datagram.size());
+		unacked_count = 0;
+		bAckPending = false;
+	}
+
+	// fragment of multi fragment message must match message it belongs to and fit receiver limits
+	bool isValidPartialFragment(const TFragmentHeader& header, size_t payload_size) const {
+		if (payload_size == 0) {
+			return false; // only single fragment message can be empty
+		}
+
+		auto it = partial_map.find(header.message_id);
+		if (it == partial_map.end()) {
+			return partial_map.size() < MAX_PARTIAL_MESSAGES && partial_fragment_num + header.fragment_count <= MAX_PARTIAL_FRAGMENTS;
+		}
+
+		const std::vector<TMessage>& fragment_array = it->second.fragment_array;
+		return header.fragment_count == fragment_array.size() && fragment_array[header.fragment_index].empty();
+	}
+
+	void receiveFragment(const uint8_t* data, size_t size, std::vector<TMessage>& message_list) {
+		size_t pos = 0;
+		TFragmentHeader header;
+		if (!read(data, size, pos, header) || header.fragment_count == 0 || header.fragment_index >= header.fragment_count) {
+			return;
+		}
+
+		if (header.session != rcv_session) {
+			// remote host started new channel
+			rcv_session = header.session;
+			rcv_next_seq = 0;
+			rcv_ahead.clear();
+			partial_map.clear();
+			partial_fragment_num = 0;
+		}
+
+		const uint32_t seq = header.seq;
+		if (seq < rcv_next_seq || rcv_ahead.count(seq) > 0) {
+			// duplicate: previous ack is lost
+			bAckPending = true;
+			return;
+		}
+
+		if (seq - rcv_next_seq > MAX_ACK_WORDS * 64) {
+			return; // outside of any sender window
+		}
+
+		if (header.fragment_count > 1 && !isValidPartialFragment(header, size - pos)) {
+			return;
+		}
+
+		bool bGap = false;
+		if (seq == rcv_next_seq) {
+			rcv_next_seq++;
+			while (!rcv_ahead.empty() && *rcv_ahead.begin() == rcv_next_seq) {
+				rcv_ahead.erase(rcv_ahead.begin());
+				rcv_next_seq++;
+			}
+		} else {
+			rcv_ahead.insert(seq);
+			bGap = true;
+		}
+
+		if (header.fragment_count == 1) {
+			message_list.emplace_back(data + pos, data + size);
+		} else {
+			TPartialMessage& partial = partial_map[header.message_id];
+			if (partial.fragment_array.empty()) {
+				partial.fragment_array.resize(header.fragment_count);
+				partial_fragment_num += header.fragment_count;
+			}
+
+			partial.fragment_array[header.fragment_index].assign(data + pos, data + size);
+			partial.received++;
+
+			if (partial.received == (int)partial.fragment_array.size()) {
+				TMessage message;
+				for (const TMessage& fragment : partial.fragment_array) {
+					message.insert(message.end(), fragment.begin(), fragment.end());
+				}
+
+				message_list.push_back(std::move(message));
+				partial_fragment_num -= partial.fragment_array.size();
+				partial_map.erase(header.message_id);
+			}
+		}
+
+		// gap means lost fragment: ack at once to let sender retransmit it
+		unacked_count++;
+		if (bGap || unacked_count >= ACK_EVERY) {
+			sendAck();
+		} else {
+			bAckPending = true;
+		}
+	}
+
+	void receiveAck(const uint8_t* data, size_t size, double now) {
+		size_t pos = 0;
+		TAckHeader header;
+		if (!read(data, size, pos, header) || header.session != session) {
+			return;
+		}
+
+		while (!in_flight.empty() && in_flight.begin()->first < header.next_seq) {
+			acknowledge(in_flight.begin()->first, now);
+		}
+
+		for (uint32_t w = 0; w < header.word_num; w++) {
+			uint64_t word;
+			if (!read(data, size, pos, word)) {
+				return;
+			}
+
+			for (uint32_t bit = 0; word != 0; bit++, word >>= 1) {
+				if (word & 1) {
+					acknowledge(header.next_seq + 1 + w * 64 + bit, now);
+				}
+			}
+		}
+
+		// fragment sent noticeably earlier than acknowledged one is lost, not reordered.
+		// after retransmit it is lost again only if fragment sent later than retransmit is acknowledged
+		const double reorder_window = std::max(srtt / 4, 0.001);
+		for (auto& element : in_flight) {
+			if (element.second.last_send + reorder_window < rack_send_time) {
+				transmit(element.second, now);
+			}
+		}
+
+		fillWindow(now);
+	}
+
+public:
+
+	// now is start of idle time, see getLastReceiveTime
+	TNetChannel(TSendFunc func, double now, int window_size = 128, int max_fragment_size = 1200) : send_func(std::move(func)), window(window_size), fragment_size(max_fragment_size), last_receive(now) {
+		session = newSession();
+		token_time = now;
+		rate_window_start = now;
+	}
+
+	// bytes per second and largest burst in bytes, rate 0 - not limited
+	void setRate(double bytes_per_sec, double burst_bytes, double now) {
+		const std::lock_guard<std::mutex> lock(mutex);
+		rate = bytes_per_sec;
+		burst = std::max(burst_bytes, (double)fragment_size);
+		tokens = burst;
+		token_time = now;
+	}
+
+	// drop queued messages and start new session, remote host resets its receiver on first fragment
+	void reset(double now) {
+		const std::lock_guard<std::mutex> lock(mutex);
+		session = newSession();
+		next_seq = 0;
+		out_queue.clear();
+		in_flight.clear();
+		pending_map.clear();
+		rack_send_time = 0;
+		bBroken = false;
+		last_receive = now;
+	}
+
+	static bool isChannelDatagram(const uint8_t* data, size_t size) {
+		uint32_t op_code;
+		size_t pos = 0;
+		return read(data, size, pos, op_code) && (op_code == NET_CHANNEL_FRAGMENT || op_code == NET_CHANNEL_ACK);
+	}
+
+	// queue message, it is sent as window allows
+	void send(const uint8_t* data, size_t size, double now) {
+		const std::lock_guard<std::mutex> lock(mutex);
+		if (bBroken) {
+			return;
+		}
+
+		const size_t count = std::max((size_t)1, (size + fragment_size - 1) / fragment_size);
+		if (count > 0xffff) {
+			return;
+		}
+
+		pending_map[next_message_id] = (int)count;
+		out_queue.push_back(TOutMessage{ next_message_id++, std::make_shared<const TMessage>(data, data + size), (uint16_t)count, 0 });
+		fillWindow(now);
+	}
+
+	// handle channel datagram, complete messages are added to message list
+	void receive(const uint8_t* data, size_t size, double now, std::vector<TMessage>& message_list) {
+		const std::lock_guard<std::mutex> lock(mutex);
+
+		uint32_t op_code;
+		size_t pos = 0;
+		if (!read(data, size, pos, op_code)) {
+			return;
+		}
+
+		last_receive = now;
+
+		if (op_code == NET_CHANNEL_FRAGMENT) {
+			receiveFragment(data, size, message_list);
+		} else if (op_code == NET_CHANNEL_ACK) {
+			receiveAck(data, size, now);
+		}
+	}
+
+	// send delayed ack, retransmit timed out fragments. should be called every few milliseconds
+	void tick(double now) {
+		const std::lock_guard<std::mutex> lock(mutex);
+
+		if (bAckPending) {
+			sendAck();
+		}
+
+		if (bBroken) {
+			return;
+		}
+
+		for (auto& element : in_flight) {
+			TInFlight& fragment = element.second;
+			const double timeout = rto * (1 << std::min(fragment.send_count - 1, 4)); // exponential backoff
+			if (now - fragment.last_send >= timeout) {
+				if (fragment.send_count >= MAX_SEND_COUNT) {
+					// remote host is gone
+					bBroken = true;
+					in_flight.clear();
+					out_queue.clear();
+					pending_map.clear();
+					return;
+				}
+
+				transmit(fragment, now);
+			}
+		}
+
+		fillWindow(now);
+	}
+
+	bool isBroken() {
+		const std::lock_guard<std::mutex> lock(mutex);
+		return bBroken;
+	}
+
+	bool isIdle() {
+		const std::lock_guard<std::mutex> lock(mutex);
+		return in_flight.empty() && out_queue.empty();
+	}
+
+	// messages which are not completely acknowledged by remote host
+	int getPendingMessageCount() {
+		const std::lock_guard<std::mutex> lock(mutex);
+		return (int)pending_map.size();
+	}
+
+	double getLastReceiveTime() {
+		const std::lock_guard<std::mutex> lock(mutex);
+		return last_receive;
+	}
+
+	uint64_t getRetransmitCount() {
+		const std::lock_guard<std::mutex> lock(mutex);
+		return retransmit_count;
+	}
+
+	double getRto() {
+		const std::lock_guard<std::mutex> lock(mutex);
+		return rto;
+	}
+
+	uint64_t getSentBytes() {
+		const std::lock_guard<std::mutex> lock(mutex);
+		return sent_bytes;
+	}
+
+	// bytes per second in last complete window
+	double getSendRate() {
+		const std::lock_guard<std::mutex> lock(mutex);
+		return send_rate;
+	}
+};
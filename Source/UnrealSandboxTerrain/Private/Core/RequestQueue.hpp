@@ -0,0 +1,129 @@
+#pragma once
+
+#include <list>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+enum class TRequestPushResult {
+	ADDED,
+	MERGED,		// equal request of the same client is already queued, nothing added
+	REJECTED,	// queue is full or stopped
+};
+
+// Bounded request queue shared by worker threads. Each client has own queue ordered by priority (lower first, FIFO if equal),
+// clients are served round robin, so client which sent many requests does not delay others.
+// Request equal to one already queued by the same client is dropped.
+template <typename C, typename R>
+class TFairRequestQueue {
+
+private:
+
+	struct TItem {
+		int priority;
+		R request;
+	};
+
+	struct TClientQueue {
+		C client;
+		std::deque<TItem> queue;
+	};
+
+	std::mutex mutex;
+	std::condition_variable cv;
+
+	// round robin order, client is removed when its queue is empty
+	std::list<TClientQueue> client_list;
+
+	size_t total_size = 0;
+	size_t max_total_size;
+	size_t max_client_size;
+
+	bool bStopped = false;
+
+public:
+
+	TFairRequestQueue(size_t total_size_limit, size_t client_size_limit) : max_total_size(total_size_limit), max_client_size(client_size_limit) {
+
+	}
+
+	TRequestPushResult push(const C& client, const R& request, int priority = 0) {
+		{
+			const std::lock_guard<std::mutex> lock(mutex);
+			if (bStopped || total_size >= max_total_size) {
+				return TRequestPushResult::REJECTED;
+			}
+
+			auto it = std::find_if(client_list.begin(), client_list.end(), [&](const TClientQueue& q) { return q.client == client; });
+			if (it == client_list.end()) {
+				it = client_list.insert(client_list.end(), TClientQueue{ client, {} });
+			}
+
+			if (std::find_if(it->queue.begin(), it->queue.end(), [&](const TItem& itm) { return itm.request == request; }) != it->queue.end()) {
+				return TRequestPushResult::MERGED;
+			}
+
+			if (it->queue.size() >= max_client_size) {
+				return TRequestPushResult::REJECTED;
+			}
+
+			auto pos = std::upper_bound(it->queue.begin(), it->queue.end(), priority, [](int p, const TItem& itm) { return p < itm.priority; });
+			it->queue.insert(pos, TItem{ priority, request });
+			total_size++;
+		}
+
+		cv.notify_one();
+		return TRequestPushResult::ADDED;
+	}
+
+	// wait for request, false if queue is stopped
+	bool pop(C& client, R& request) {
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [this]() -> bool { return bStopped || total_size > 0; });
+		if (bStopped) {
+			return false;
+		}
+
+		auto it = client_list.begin();
+		client = it->client;
+		request = std::move(it->queue.front().request);
+		it->queue.pop_front();
+		total_size--;
+
+		if (it->queue.empty()) {
+			client_list.erase(it);
+		} else {
+			client_list.splice(client_list.end(), client_list, it);
+		}
+
+		return true;
+	}
+
+	// drop requests of gone client
+	void removeClient(const C& client) {
+		const std::lock_guard<std::mutex> lock(mutex);
+		auto it = std::find_if(client_list.begin(), client_list.end(), [&](const TClientQueue& q) { return q.client == client; });
+		if (it != client_list.end()) {
+			total_size -= it->queue.size();
+			client_list.erase(it);
+		}
+	}
+
+	// wake up all waiting workers, not handled requests are dropped
+	void stop() {
+		{
+			const std::lock_guard<std::mutex> lock(mutex);
+			bStopped = true;
+			client_list.clear();
+			total_size = 0;
+		}
+
+		cv.notify_all();
+	}
+
+	size_t size() {
+		const std::lock_guard<std::mutex> lock(mutex);
+		return total_size;
+	}
+};
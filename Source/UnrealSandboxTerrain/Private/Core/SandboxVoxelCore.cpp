@@ -11,12 +11,17 @@
 #include "SandboxVoxelCore.h"
 #include "Transvoxel.h"
 #include "VoxelIndex.h"
+#include "ThreadPool.hpp"
+#include "FlatMap.h"
 #include <cmath>
 #include <vector>
 #include <mutex>
 #include <iterator>
 #include <map>
 
+// mem stat
+std::atomic<int> md_counter{ 0 };
+
 
 #define FORCEINLINE2 FORCEINLINE  
 //#define FORCEINLINE2 FORCENOINLINE  //debug
@@ -25,6 +30,8 @@ typedef struct TVoxelDataGenerationParam {
     int lod = 0;
     bool bGenerateLOD = false;
 	bool bIgnoreLodPatches = false;
+	bool bKeepCellInfo = false;
+	bool bCollisionOnly = false;
     
 	FORCEINLINE2 int step() const {
 		return 1 << lod; 
@@ -32,6 +39,8 @@ typedef struct TVoxelDataGenerationParam {
 
     TVoxelDataGenerationParam(const TVoxelDataParam& vdp) {
         bGenerateLOD = vdp.bGenerateLOD;
+        bKeepCellInfo = vdp.bKeepCellInfo;
+        bCollisionOnly = vdp.bCollisionOnly;
     }
 
 } TVoxelDataGenerationParam;
@@ -50,6 +59,225 @@ static FORCEINLINE2 FVector clcNormal(FVector &p1, FVector &p2, FVector &p3) {
     return n;
 }
 
+//====================================================================================
+
+// mesh vertex is identified by LOD0 grid edge it was interpolated on:
+// linear indexes of edge points, lower index in high 32 bits
+typedef uint64 TEdgeKey;
+
+#define EDGE_KEY_EMPTY		(~0ull)
+
+struct TVertexInfo {
+	FVector normal;
+	int32 vertexIndex = 0;
+
+	// head of material index list in TVertexCache::slotArray, -1 if empty
+	int32 materialSlot = -1;
+	int32 materialTransitionSlot = -1;
+};
+
+// Vertex welding cache: edge key -> vertex info (open addressing, linear probing).
+// Per-material vertex indexes are kept in flat slot list instead of map per vertex.
+// Cache instances are pooled per thread and reused by next mesh extractor without reallocation.
+class TVertexCache {
+
+private:
+	struct TEntry {
+		TEdgeKey key;
+		int32 info;
+		uint32 generation;
+	};
+
+	struct TMaterialSlot {
+		unsigned short matId;
+		int32 index;
+		int32 next;
+	};
+
+	std::vector<TEntry> table;
+	std::vector<TVertexInfo> infoArray;
+	std::vector<TMaterialSlot> slotArray;
+
+	uint32 generation = 1;
+	int shift = 0;
+
+	static std::vector<TVertexCache*>& getPool() {
+		static thread_local struct TPool {
+			std::vector<TVertexCache*> list;
+			~TPool() {
+				for (TVertexCache* cache : list) {
+					delete cache;
+				}
+			}
+		} pool;
+
+		return pool.list;
+	}
+
+	FORCEINLINE2 uint32 clcHash(TEdgeKey key) const {
+		return (uint32)((key * 0x9E3779B97F4A7C15ull) >> shift);
+	}
+
+	FORCEINLINE2 void insert(TEdgeKey key, int32 info) {
+		const uint32 mask = (uint32)table.size() - 1;
+		for (uint32 i = clcHash(key); ; i = (i + 1) & mask) {
+			TEntry& e = table[i];
+			if (e.generation != generation) {
+				e = TEntry{ key, info, generation };
+				return;
+			}
+		}
+	}
+
+	void grow() {
+		std::vector<TEntry> old;
+		old.swap(table);
+
+		const int bits = old.empty() ? 8 : 64 - shift + 1;
+		table.assign(1ull << bits, TEntry{ EDGE_KEY_EMPTY, -1, 0 });
+		shift = 64 - bits;
+
+		for (const TEntry& e : old) {
+			if (e.generation == generation) {
+				insert(e.key, e.info);
+			}
+		}
+	}
+
+public:
+
+	static TVertexCache* acquire() {
+		std::vector<TVertexCache*>& pool = getPool();
+		TVertexCache* cache;
+		if (pool.empty()) {
+			cache = new TVertexCache();
+		} else {
+			cache = pool.back();
+			pool.pop_back();
+		}
+
+		cache->reset();
+		return cache;
+	}
+
+	static void release(TVertexCache* cache) {
+		getPool().push_back(cache);
+	}
+
+	void reset() {
+		infoArray.clear();
+		slotArray.clear();
+
+		generation++;
+		if (generation == 0) {
+			// counter overflow: invalidate all entries explicitly
+			std::fill(table.begin(), table.end(), TEntry{ EDGE_KEY_EMPTY, -1, 0 });
+			generation = 1;
+		}
+	}
+
+	FORCEINLINE2 TVertexInfo& findOrAdd(TEdgeKey key) {
+		if ((infoArray.size() + 1) * 2 > table.size()) {
+			grow();
+		}
+
+		const uint32 mask = (uint32)table.size() - 1;
+		for (uint32 i = clcHash(key); ; i = (i + 1) & mask) {
+			TEntry& e = table[i];
+			if (e.generation != generation) {
+				e = TEntry{ key, (int32)infoArray.size(), generation };
+				infoArray.emplace_back();
+				return infoArray.back();
+			}
+
+			if (e.key == key) {
+				return infoArray[e.info];
+			}
+		}
+	}
+
+	FORCEINLINE2 const TVertexInfo* find(TEdgeKey key) const {
+		if (table.empty()) {
+			return nullptr;
+		}
+
+		const uint32 mask = (uint32)table.size() - 1;
+		for (uint32 i = clcHash(key); ; i = (i + 1) & mask) {
+			const TEntry& e = table[i];
+			if (e.generation != generation) {
+				return nullptr;
+			}
+
+			if (e.key == key) {
+				return &infoArray[e.info];
+			}
+		}
+	}
+
+	FORCEINLINE2 int32 findMaterialIndex(int32 slot, unsigned short matId) const {
+		for (; slot >= 0; slot = slotArray[slot].next) {
+			if (slotArray[slot].matId == matId) {
+				return slotArray[slot].index;
+			}
+		}
+
+		return -1;
+	}
+
+	FORCEINLINE2 void addMaterialIndex(int32& head, unsigned short matId, int32 index) {
+		slotArray.push_back(TMaterialSlot{ matId, index, head });
+		head = (int32)slotArray.size() - 1;
+	}
+};
+
+#define CELL_MAX_VERTEX_COUNT	12
+
+// sorted set of cell vertex materials, same order as std::set
+struct TCellMaterialSet {
+	unsigned short id[CELL_MAX_VERTEX_COUNT];
+	int num = 0;
+
+	FORCEINLINE2 void insert(unsigned short matId) {
+		int i = 0;
+		while (i < num && id[i] < matId) {
+			i++;
+		}
+
+		if (i < num && id[i] == matId) {
+			return;
+		}
+
+		for (int j = num; j > i; j--) {
+			id[j] = id[j - 1];
+		}
+
+		id[i] = matId;
+		num++;
+	}
+
+	FORCEINLINE2 int32 indexOf(unsigned short matId) const {
+		for (int i = 0; i < num; i++) {
+			if (id[i] == matId) {
+				return i;
+			}
+		}
+
+		return -1;
+	}
+
+	int size() const {
+		return num;
+	}
+
+	const unsigned short* begin() const {
+		return id;
+	}
+
+	const unsigned short* end() const {
+		return id + num;
+	}
+};
+
 //####################################################################################################################################
 //
 //	VoxelMeshExtractor
@@ -75,6 +303,7 @@ private:
 	struct TmpPoint {
 		FVector v;
 		unsigned short matId;
+		TEdgeKey edge;
 	};
 
 	class MeshHandler {
@@ -90,7 +319,6 @@ private:
 
 		// transition material
 		unsigned short transitionMaterialIndex = 0;
-		TMap<FString, unsigned short> transitionMaterialDict;
 		std::map<uint64, uint16> transitionMaterialMap;
 
 		int triangleCount = 0;
@@ -99,28 +327,42 @@ private:
 
 	public:
 
-		struct VertexInfo {
-			FVector normal;
-
-			std::map<unsigned short, int32> indexInMaterialSectionMap;
-			std::map<unsigned short, int32> indexInMaterialTransitionSectionMap;
-
-			int vertexIndex = 0;
-		};
-
-		TMap<FVector, VertexInfo> vertexInfoMap;
+		TVertexCache* vertexCache;
 
 		MeshHandler(VoxelMeshExtractor* e, FProcMeshSection* s, TMeshContainer* mc) :
                         generalMeshSection(s), extractor(e), meshMatContainer(mc) {
 			materialSectionMapPtr = &meshMatContainer->MaterialSectionMap;
 			materialTransitionSectionMapPtr = &meshMatContainer->MaterialTransitionSectionMap;
+			vertexCache = TVertexCache::acquire();
+		}
+
+		~MeshHandler() {
+			TVertexCache::release(vertexCache);
 		}
 
 	private:
 
+		FORCEINLINE bool isKeepCellInfo() const {
+			return extractor->voxel_data_param.bKeepCellInfo;
+		}
+
+		void registerSectionVertexes(TMeshMaterialSection& matSectionRef, unsigned short matId, bool bTransition) {
+			const FProcMeshSection& section = matSectionRef.MaterialMesh;
+			for (int32 i = 0; i < section.ProcVertexEdgeBuffer.Num(); i++) {
+				TVertexInfo& vertexInfo = vertexCache->findOrAdd(section.ProcVertexEdgeBuffer[i]);
+				if (vertexInfo.normal.IsZero()) {
+					vertexInfo.normal = section.ProcVertexBuffer[i].Normal;
+				}
+
+				vertexCache->addMaterialIndex(bTransition ? vertexInfo.materialTransitionSlot : vertexInfo.materialSlot, matId, i);
+			}
+
+			matSectionRef.vertexIndexCounter = section.ProcVertexEdgeBuffer.Num();
+		}
+
 		FORCEINLINE void addVertexGeneral(const TmpPoint &point, const FVector& n) {
 			const FVector v = point.v;
-			VertexInfo& vertexInfo = vertexInfoMap.FindOrAdd(v);
+			TVertexInfo& vertexInfo = vertexCache->findOrAdd(point.edge);
 
 			if (vertexInfo.normal.IsZero()) {
 				// new vertex
@@ -129,6 +371,10 @@ private:
 				TMeshVertex Vertex{v, n, -1};
 				generalMeshSection->ProcIndexBuffer.Add(vertexGeneralIndex);
 				generalMeshSection->AddVertex(Vertex);
+				if (isKeepCellInfo()) {
+					generalMeshSection->ProcVertexEdgeBuffer.Add(point.edge);
+				}
+
 				vertexInfo.vertexIndex = vertexGeneralIndex;
 
 				vertexGeneralIndex++;
@@ -143,9 +389,9 @@ private:
 			}
 		}
 
-		FORCEINLINE void addVertexMat(unsigned short matId, const TmpPoint &point, const FVector& n) {
+		FORCEINLINE void addVertexMat(TMeshMaterialSection& matSectionRef, unsigned short matId, const TmpPoint &point, const FVector& n) {
 			const FVector& v = point.v;
-			VertexInfo& vertexInfo = vertexInfoMap.FindOrAdd(v);
+			TVertexInfo& vertexInfo = vertexCache->findOrAdd(point.edge);
 
 			if (vertexInfo.normal.IsZero()) {
 				vertexInfo.normal = n;
@@ -156,29 +402,28 @@ private:
 				vertexInfo.normal = tmp;
 			}
 
-			// get current mat section
-			TMeshMaterialSection& matSectionRef = materialSectionMapPtr->FindOrAdd(matId);
-			matSectionRef.MaterialId = matId; // update mat id (if case of new section was created by FindOrAdd)
-
-			if (vertexInfo.indexInMaterialSectionMap.find(matId) != vertexInfo.indexInMaterialSectionMap.end()) {
+			const int32 vertexIndex = vertexCache->findMaterialIndex(vertexInfo.materialSlot, matId);
+			if (vertexIndex >= 0) {
 				// vertex exist in mat section
 				// just get vertex index and put to index buffer
-				int32 vertexIndex = vertexInfo.indexInMaterialSectionMap[matId];
 				matSectionRef.MaterialMesh.ProcIndexBuffer.Add(vertexIndex);
 			} else { // vertex not exist in mat section
 				matSectionRef.MaterialMesh.ProcIndexBuffer.Add(matSectionRef.vertexIndexCounter);
 
 				TMeshVertex Vertex{v, vertexInfo.normal, -1};
 				matSectionRef.MaterialMesh.AddVertex(Vertex);
+				if (isKeepCellInfo()) {
+					matSectionRef.MaterialMesh.ProcVertexEdgeBuffer.Add(point.edge);
+				}
 
-				vertexInfo.indexInMaterialSectionMap[matId] = matSectionRef.vertexIndexCounter;
+				vertexCache->addMaterialIndex(vertexInfo.materialSlot, matId, matSectionRef.vertexIndexCounter);
 				matSectionRef.vertexIndexCounter++;
 			}
 		}
 
-		FORCEINLINE void addVertexMatTransition(std::set<unsigned short>& materialIdSet, unsigned short matId, const TmpPoint &point, const FVector& n) {
+		FORCEINLINE void addVertexMatTransition(TMeshMaterialSection& matSectionRef, const TCellMaterialSet& materialIdSet, unsigned short matId, const TmpPoint &point, const FVector& n) {
 			const FVector& v = point.v;
-			VertexInfo& vertexInfo = vertexInfoMap.FindOrAdd(v);
+			TVertexInfo& vertexInfo = vertexCache->findOrAdd(point.edge);
 
 			if (vertexInfo.normal.IsZero()) {
 				vertexInfo.normal = n;
@@ -190,41 +435,59 @@ private:
 				vertexInfo.normal = tmp;
 			}
 
-			// get current mat section
-			TMeshMaterialSection& matSectionRef = materialTransitionSectionMapPtr->FindOrAdd(matId);
-			matSectionRef.MaterialId = matId; // update mat id (if case of new section was created by FindOrAdd)
-
-			if (vertexInfo.indexInMaterialTransitionSectionMap.find(matId) != vertexInfo.indexInMaterialTransitionSectionMap.end()) {
+			const int32 vertexIndex = vertexCache->findMaterialIndex(vertexInfo.materialTransitionSlot, matId);
+			if (vertexIndex >= 0) {
 				// vertex exist in mat section
 				// just get vertex index and put to index buffer
-				int32 vertexIndex = vertexInfo.indexInMaterialTransitionSectionMap[matId];
 				matSectionRef.MaterialMesh.ProcIndexBuffer.Add(vertexIndex);
 			} else { // vertex not exist in mat section
 				matSectionRef.MaterialMesh.ProcIndexBuffer.Add(matSectionRef.vertexIndexCounter);
 
 				TMeshVertex Vertex{v, vertexInfo.normal, -1};
+				Vertex.MatIdx = materialIdSet.indexOf(point.matId);
 
-				int i = 0;
-				int32 MatIdx = -1;
-				for (unsigned short m : materialIdSet) {
-					if (m == point.matId) {
-						MatIdx = i;
-						break;
-					}
-
-					i++;
+				matSectionRef.MaterialMesh.AddVertex(Vertex);
+				if (isKeepCellInfo()) {
+					matSectionRef.MaterialMesh.ProcVertexEdgeBuffer.Add(point.edge);
 				}
 
-				Vertex.MatIdx = MatIdx;
-
-				matSectionRef.MaterialMesh.AddVertex(Vertex);
-				vertexInfo.indexInMaterialTransitionSectionMap[matId] = matSectionRef.vertexIndexCounter;
+				vertexCache->addMaterialIndex(vertexInfo.materialTransitionSlot, matId, matSectionRef.vertexIndexCounter);
 				matSectionRef.vertexIndexCounter++;
 			}
 		}
 
 	public:
-		FORCEINLINE unsigned short getTransitionMaterialIndex(std::set<unsigned short>& materialIdSet) {
+		// register vertexes of existing mesh sections: new triangles are welded to them by grid edge.
+		// general section and transition material codes belong to main mesh handler only
+		void registerExistingVertexes(bool bMain) {
+			if (bMain) {
+				const TArray<uint64>& edgeBuffer = generalMeshSection->ProcVertexEdgeBuffer;
+				for (int32 i = 0; i < edgeBuffer.Num(); i++) {
+					TVertexInfo& vertexInfo = vertexCache->findOrAdd(edgeBuffer[i]);
+					vertexInfo.normal = generalMeshSection->ProcVertexBuffer[i].Normal;
+					vertexInfo.vertexIndex = i;
+				}
+
+				vertexGeneralIndex = edgeBuffer.Num();
+			}
+
+			for (auto& Element : *materialSectionMapPtr) {
+				registerSectionVertexes(Element.Value, Element.Key, false);
+			}
+
+			for (auto& Element : *materialTransitionSectionMapPtr) {
+				registerSectionVertexes(Element.Value, Element.Key, true);
+
+				if (bMain) {
+					transitionMaterialMap.insert({ Element.Value.TransitionCode, Element.Key });
+					if (Element.Key >= transitionMaterialIndex) {
+						transitionMaterialIndex = Element.Key + 1;
+					}
+				}
+			}
+		}
+
+		FORCEINLINE unsigned short getTransitionMaterialIndex(const TCellMaterialSet& materialIdSet) {
 			uint64 code = TMeshMaterialTransitionSection::GenerateTransitionCode(materialIdSet);
 			if (transitionMaterialMap.find(code) == transitionMaterialMap.end()) {
 				// not found
@@ -234,7 +497,7 @@ private:
 
 				TMeshMaterialTransitionSection& sectionRef = materialTransitionSectionMapPtr->FindOrAdd(idx);
 				sectionRef.TransitionCode = code;
-				sectionRef.MaterialIdSet = materialIdSet;
+				sectionRef.MaterialIdSet = std::set<unsigned short>(materialIdSet.begin(), materialIdSet.end());
 
 				return idx;
 			} else {
@@ -248,24 +511,41 @@ private:
 			addVertexGeneral(tmp1, normal);
 			addVertexGeneral(tmp2, normal);
 			addVertexGeneral(tmp3, normal);
+			if (isKeepCellInfo()) {
+				generalMeshSection->ProcTriangleCellBuffer.Add(extractor->cell_index);
+			}
 
 			triangleCount++;
 		}
 
 		// usual mesh with one material
 		FORCEINLINE void addTriangleMat(const FVector& normal, unsigned short matId, TmpPoint &tmp1, TmpPoint &tmp2, TmpPoint &tmp3) {
-			addVertexMat(matId, tmp1, normal);
-			addVertexMat(matId, tmp2, normal);
-			addVertexMat(matId, tmp3, normal);
+			// get current mat section
+			TMeshMaterialSection& matSectionRef = materialSectionMapPtr->FindOrAdd(matId);
+			matSectionRef.MaterialId = matId; // update mat id (if case of new section was created by FindOrAdd)
+
+			addVertexMat(matSectionRef, matId, tmp1, normal);
+			addVertexMat(matSectionRef, matId, tmp2, normal);
+			addVertexMat(matSectionRef, matId, tmp3, normal);
+			if (isKeepCellInfo()) {
+				matSectionRef.MaterialMesh.ProcTriangleCellBuffer.Add(extractor->cell_index);
+			}
 
 			triangleCount++;
 		}
 
 		// transitional mesh between two or more meshes with different material
-		FORCEINLINE void addTriangleMatTransition(const FVector& normal, std::set<unsigned short>& materialIdSet, unsigned short matId, TmpPoint &tmp1, TmpPoint &tmp2, TmpPoint &tmp3) {
-			addVertexMatTransition(materialIdSet, matId, tmp1, normal);
-			addVertexMatTransition(materialIdSet, matId, tmp2, normal);
-			addVertexMatTransition(materialIdSet, matId, tmp3, normal);
+		FORCEINLINE void addTriangleMatTransition(const FVector& normal, const TCellMaterialSet& materialIdSet, unsigned short matId, TmpPoint &tmp1, TmpPoint &tmp2, TmpPoint &tmp3) {
+			// get current mat section
+			TMeshMaterialSection& matSectionRef = materialTransitionSectionMapPtr->FindOrAdd(matId);
+			matSectionRef.MaterialId = matId; // update mat id (if case of new section was created by FindOrAdd)
+
+			addVertexMatTransition(matSectionRef, materialIdSet, matId, tmp1, normal);
+			addVertexMatTransition(matSectionRef, materialIdSet, matId, tmp2, normal);
+			addVertexMatTransition(matSectionRef, materialIdSet, matId, tmp3, normal);
+			if (isKeepCellInfo()) {
+				matSectionRef.MaterialMesh.ProcTriangleCellBuffer.Add(extractor->cell_index);
+			}
 
 			triangleCount++;
 		}
@@ -275,6 +555,9 @@ private:
 	MeshHandler* mainMeshHandler;
 	TArray<MeshHandler*> transitionHandlerArray;
 
+	// linear index of current cell
+	int32 cell_index = 0;
+
 public:
 	VoxelMeshExtractor(TMeshLodSection &a, const TVoxelData &b, const TVoxelDataGenerationParam c) : mesh_data(a), voxel_data(b), voxel_data_param(c) {
 		mainMeshHandler = new MeshHandler(this, &a.WholeMesh, &a.RegularMeshContainer);
@@ -458,18 +741,34 @@ private:
 		}
 	}
 
+	// interpolate always from lower to higher edge point: same edge gives bitwise same vertex in all cells
+	FORCEINLINE2 void edgeInterpolation(struct TmpPoint& tp, const TPointInfo& point1, const TPointInfo& point2) {
+		const uint64 index1 = voxel_data.clcLinearIndex(point1.adr);
+		const uint64 index2 = voxel_data.clcLinearIndex(point2.adr);
+
+		if (index1 <= index2) {
+			tp.edge = (index1 << 32) | index2;
+			tp.v = vertexInterpolation(point1.pos, point2.pos, point1.density, point2.density);
+		} else {
+			tp.edge = (index2 << 32) | index1;
+			tp.v = vertexInterpolation(point2.pos, point1.pos, point2.density, point1.density);
+		}
+	}
+
 	FORCEINLINE2 TmpPoint vertexClc(TPointInfo& point1, TPointInfo& point2) {
 		struct TmpPoint ret;
 
 		if (voxel_data_param.lod != 0) {
 			TPointInfo new_point1, new_point2;
 			convertToLod0(point1, point2, new_point1, new_point2);
-			ret.v = vertexInterpolation(new_point1.pos, new_point2.pos, new_point1.density, new_point2.density);
+			edgeInterpolation(ret, new_point1, new_point2);
 		} else {
-			ret.v = vertexInterpolation(point1.pos, point2.pos, point1.density, point2.density);
+			edgeInterpolation(ret, point1, point2);
 		}
 
-		if (voxel_data_param.lod == 0) {
+		if (voxel_data_param.bCollisionOnly) {
+			ret.matId = 0; // no material sections
+		} else if (voxel_data_param.lod == 0) {
 			selectMaterialLOD0(ret, point1, point2);
 		} else {
 			selectMaterialLODBig(ret, point1, point2);
@@ -504,19 +803,27 @@ private:
 		}
 
 		unsigned int c = regularCellClass[caseCode];
-		RegularCellData cd = regularCellData[c];
-		std::vector<TmpPoint> vertexList;
-		vertexList.reserve(cd.GetTriangleCount() * 3);
-
-		std::set<unsigned short> materialIdSet;
+		const RegularCellData& cd = regularCellData[c];
+		TmpPoint vertexList[CELL_MAX_VERTEX_COUNT];
+		TCellMaterialSet materialIdSet;
 
 		for (int i = 0; i < cd.GetVertexCount(); i++) {
 			const int edgeCode = regularVertexData[caseCode][i];
 			const unsigned short v0 = (edgeCode >> 4) & 0x0F;
 			const unsigned short v1 = edgeCode & 0x0F;
-			struct TmpPoint tp = vertexClc(d[v0], d[v1]);
-			materialIdSet.insert(tp.matId);
-			vertexList.push_back(tp);
+			vertexList[i] = vertexClc(d[v0], d[v1]);
+			materialIdSet.insert(vertexList[i].matId);
+		}
+
+		if (voxel_data_param.bCollisionOnly) {
+			for (int i = 0; i < cd.GetTriangleCount() * 3; i += 3) {
+				TmpPoint& tmp1 = vertexList[cd.vertexIndex[i]];
+				TmpPoint& tmp2 = vertexList[cd.vertexIndex[i + 1]];
+				TmpPoint& tmp3 = vertexList[cd.vertexIndex[i + 2]];
+				mainMeshHandler->addTriangleGeneral(-clcNormal(tmp1.v, tmp2.v, tmp3.v), tmp1, tmp2, tmp3);
+			}
+
+			return;
 		}
 
 		bool isTransitionMaterialSection = materialIdSet.size() > 1;
@@ -606,21 +913,19 @@ private:
 
 		const bool inverse = (classIndex & 128) != 0;
 
-		TransitionCellData cellData = transitionCellData[classIndex & 0x7F];
+		const TransitionCellData& cellData = transitionCellData[classIndex & 0x7F];
 
-		std::vector<TmpPoint> vertexList;
-		vertexList.reserve(cellData.GetTriangleCount() * 3);
-		std::set<unsigned short> materialIdSet;
+		TmpPoint vertexList[CELL_MAX_VERTEX_COUNT];
+		TCellMaterialSet materialIdSet;
 
 		for (int i = 0; i < cellData.GetVertexCount(); i++) {
 			const int edgeCode = transitionVertexData[caseCode][i];
 			const unsigned short v0 = (edgeCode >> 4) & 0x0F;
 			const unsigned short v1 = edgeCode & 0x0F;
-			struct TmpPoint tp = vertexClc(d[v0], d[v1]);
+			vertexList[i] = vertexClc(d[v0], d[v1]);
 
-			materialIdSet.insert(tp.matId);
-			vertexList.push_back(tp);
-			//mesh_data.DebugPointList.Add(tp.v);
+			materialIdSet.insert(vertexList[i].matId);
+			//mesh_data.DebugPointList.Add(vertexList[i].v);
 		}
 
 		bool isTransitionMaterialSection = materialIdSet.size() > 1;
@@ -641,15 +946,13 @@ private:
 			// calculate normal
 			FVector n = -clcNormal(tmp1.v, tmp2.v, tmp3.v);
 
-			if(mainMeshHandler->vertexInfoMap.Contains(tmp1.v)) {
-				MeshHandler::VertexInfo& vertexInfo = mainMeshHandler->vertexInfoMap.FindOrAdd(tmp1.v);
-				n = vertexInfo.normal;
-			} else if (mainMeshHandler->vertexInfoMap.Contains(tmp2.v)) {
-				MeshHandler::VertexInfo& vertexInfo = mainMeshHandler->vertexInfoMap.FindOrAdd(tmp2.v);
-				n = vertexInfo.normal;
-			} else if (mainMeshHandler->vertexInfoMap.Contains(tmp3.v)) {
-				MeshHandler::VertexInfo& vertexInfo = mainMeshHandler->vertexInfoMap.FindOrAdd(tmp3.v);
-				n = vertexInfo.normal;
+			const TVertexCache* mainVertexCache = mainMeshHandler->vertexCache;
+			if (const TVertexInfo* vertexInfo = mainVertexCache->find(tmp1.edge)) {
+				n = vertexInfo->normal;
+			} else if (const TVertexInfo* vertexInfo = mainVertexCache->find(tmp2.edge)) {
+				n = vertexInfo->normal;
+			} else if (const TVertexInfo* vertexInfo = mainVertexCache->find(tmp3.edge)) {
+				n = vertexInfo->normal;
 			}
 
 			if (isTransitionMaterialSection) {
@@ -704,7 +1007,17 @@ private:
     //####################################################################################################################################
     
 public:
+	void registerExistingVertexes() {
+		mainMeshHandler->registerExistingVertexes(true);
+
+		for (MeshHandler* transitionHandler : transitionHandlerArray) {
+			transitionHandler->registerExistingVertexes(false);
+		}
+	}
+
 	FORCEINLINE2 void generateCell(int x, int y, int z) {
+		cell_index = voxel_data.clcLinearIndex(x, y, z);
+
 		TPointInfo d[8];
         makeVoxelpointArray(d, x, y, z);
 		extractRegularCell(d);
@@ -714,6 +1027,43 @@ public:
 
 typedef std::shared_ptr<VoxelMeshExtractor> VoxelMeshExtractorPtr;
 
+// LODs to extract: lodMask and collision LOD, only LOD 0 without bGenerateLOD or with bCollisionOnly
+static uint32 clcLodMask(const TVoxelDataParam& vdp) {
+	if (!vdp.bGenerateLOD || vdp.bCollisionOnly) {
+		return 1;
+	}
+
+	return (vdp.lodMask & USBT_LOD_MASK_ALL) | (1u << vdp.collisionLOD);
+}
+
+// Call func for each LOD of lod_mask. Each LOD writes own TMeshLodSection only, so with thread pool they run as parallel tasks.
+// Collision LOD is started first as the longest one, but it is not handed out earlier: mesh is published after all LODs are done.
+// Edited zone is locked until then and mesh apply waits for the same lock, so early collision would not be applied sooner
+static void forEachLod(const TVoxelDataParam& vdp, uint32 lod_mask, const std::function<void(int lod)>& func) {
+	int lod_list[LOD_ARRAY_SIZE];
+	int lod_num = 0;
+
+	if ((lod_mask >> vdp.collisionLOD) & 1) {
+		lod_list[lod_num++] = vdp.collisionLOD;
+	}
+
+	for (int lod = 0; lod < LOD_ARRAY_SIZE; lod++) {
+		if (lod != vdp.collisionLOD && ((lod_mask >> lod) & 1)) {
+			lod_list[lod_num++] = lod;
+		}
+	}
+
+	if (vdp.threadPool && lod_num > 1) {
+		// calling thread waits for LOD tasks, run them before other work
+		vdp.threadPool->parallelFor(lod_num, [&](int i) { func(lod_list[i]); }, TTaskPriority::PLAYER_EDIT);
+		return;
+	}
+
+	for (int i = 0; i < lod_num; i++) {
+		func(lod_list[i]);
+	}
+}
+
 //####################################################################################################################################
 
 TMeshDataPtr polygonizeSingleCell(const TVoxelData& vd, const TVoxelDataParam& vdp, int x, int y, int z) {
@@ -743,28 +1093,48 @@ TMeshDataPtr polygonizeCellSubstanceCacheNoLOD(const TVoxelData &vd, const TVoxe
 }
 
 
+static void extractLodCellSubstanceCache(const TVoxelData& vd, const TVoxelDataParam& vdp, int lod, TMeshLodSection& lod_section) {
+	TVoxelDataGenerationParam me_vdp = vdp;
+	me_vdp.lod = lod;
+	VoxelMeshExtractorPtr mesh_extractor_ptr = VoxelMeshExtractorPtr(new VoxelMeshExtractor(lod_section, vd, me_vdp));
+
+	const int n = vd.num();
+	vd.forEachCacheItem(lod, [=](const TSubstanceCacheItem& itm) {
+		const int index = itm.index;
+		const int x = index / (n * n);
+		const int y = (index / n) % n;
+		const int z = index % n;
+		mesh_extractor_ptr->generateCell(x, y, z);
+	});
+}
+
+// mesh extractor visits cells of its LOD step only
+static void extractLodVoxelGrid(const TVoxelData& vd, const TVoxelDataParam& vdp, int lod, TMeshLodSection& lod_section) {
+	TVoxelDataGenerationParam me_vdp = vdp;
+	me_vdp.lod = lod;
+	VoxelMeshExtractorPtr me_ptr = VoxelMeshExtractorPtr(new VoxelMeshExtractor(lod_section, vd, me_vdp));
+
+	const int s = me_vdp.step();
+	const auto n = vd.num() - 1;
+	for (auto x = 0; x < n; x += s) {
+		for (auto y = 0; y < n; y += s) {
+			for (auto z = 0; z < n; z += s) {
+				me_ptr->generateCell(x, y, z);
+			}
+		}
+	}
+}
+
 TMeshDataPtr polygonizeCellSubstanceCacheLOD(const TVoxelData &vd, const TVoxelDataParam &vdp) {
 	TMeshDataPtr mesh_data_ptr = std::make_shared<TMeshData>();
-	static const int max_lod = LOD_ARRAY_SIZE;
+	mesh_data_ptr->LodMask = clcLodMask(vdp);
 
-	// create mesh extractor for each LOD
-	for (auto lod = 0; lod < max_lod; lod++) {
-		TVoxelDataGenerationParam me_vdp = vdp;
-		me_vdp.lod = lod;
-		VoxelMeshExtractorPtr mesh_extractor_ptr = VoxelMeshExtractorPtr(new VoxelMeshExtractor(mesh_data_ptr->MeshSectionLodArray[lod], vd, me_vdp));
-		int step = me_vdp.step();
-
-		const int n = vd.num();
-		vd.forEachCacheItem(lod, [=](const TSubstanceCacheItem& itm) {
-			const int index = itm.index;
-			const int x = index / (n * n);
-			const int y = (index / n) % n;
-			const int z = index % n;
-			mesh_extractor_ptr->generateCell(x, y, z);
-		});
-	}
+	// mesh extractor for each LOD
+	forEachLod(vdp, mesh_data_ptr->LodMask, [&](int lod) {
+		extractLodCellSubstanceCache(vd, vdp, lod, mesh_data_ptr->MeshSectionLodArray[lod]);
+	});
 
-	mesh_data_ptr->CollisionMeshPtr = &mesh_data_ptr->MeshSectionLodArray[vdp.collisionLOD].WholeMesh;
+	mesh_data_ptr->SetCollisionLod(vdp.collisionLOD);
 	return mesh_data_ptr;
 }
 
@@ -789,46 +1159,395 @@ TMeshDataPtr polygonizeVoxelGridNoLOD(const TVoxelData &vd, const TVoxelDataPara
 
 TMeshDataPtr polygonizeVoxelGridWithLOD(const TVoxelData &vd, const TVoxelDataParam &vdp) {
 	TMeshData* mesh_data = new TMeshData();
-	std::vector<VoxelMeshExtractorPtr> MeshExtractorLod;
-	static const int max_lod = LOD_ARRAY_SIZE;
+	mesh_data->LodMask = clcLodMask(vdp);
 
-	// create mesh extractor for each LOD
-	for (auto lod = 0; lod < max_lod; lod++) {
-		TVoxelDataGenerationParam me_vdp = vdp;
-		me_vdp.lod = lod;
-		VoxelMeshExtractorPtr me_ptr = VoxelMeshExtractorPtr(new VoxelMeshExtractor(mesh_data->MeshSectionLodArray[lod], vd, me_vdp));
-		MeshExtractorLod.push_back(me_ptr);
+	// mesh extractor for each LOD
+	forEachLod(vdp, mesh_data->LodMask, [&](int lod) {
+		extractLodVoxelGrid(vd, vdp, lod, mesh_data->MeshSectionLodArray[lod]);
+	});
+
+    if(vdp.bZCut){
+        VoxelMeshExtractorPtr mdresh_extractor_ptr = VoxelMeshExtractorPtr(new VoxelMeshExtractor(mesh_data->MeshSectionLodArray[0], vd, vdp));
+    }
+    
+	mesh_data->SetCollisionLod(vdp.collisionLOD);
+	return TMeshDataPtr(mesh_data);
+}
+
+//####################################################################################################################################
+// partial remesh
+//####################################################################################################################################
+
+static FORCEINLINE2 bool isCellInBox(int32 cell, int n, const TVoxelIndex& lower, const TVoxelIndex& upper) {
+	const int x = cell / (n * n);
+	const int y = (cell / n) % n;
+	const int z = cell % n;
+	return x >= lower.X && x <= upper.X && y >= lower.Y && y <= upper.Y && z >= lower.Z && z <= upper.Z;
+}
+
+// remove triangles of cells inside cell box [lower, upper] and vertexes not used anymore. returns false if section has no cell info
+static bool removeCellTriangles(FProcMeshSection& section, int n, const TVoxelIndex& lower, const TVoxelIndex& upper) {
+	const int32 triangleNum = section.ProcIndexBuffer.Num() / 3;
+	if (section.ProcTriangleCellBuffer.Num() != triangleNum || section.ProcVertexEdgeBuffer.Num() != section.ProcVertexBuffer.Num()) {
+		return false;
 	}
 
-    const auto n = vd.num() - 1;
-	for (auto x = 0; x < n; x++) {
-		for (auto y = 0; y < n; y++) {
-			for (auto z = 0; z < n; z++) {
-				// generate mesh for each LOD
-				//==================================================================
-				for (auto i = 0; i < max_lod; i++) {
-					int s = 1 << i;
-					if (x % s == 0 && y % s == 0 && z % s == 0) {
-						VoxelMeshExtractorPtr me_ptr = MeshExtractorLod[i];
-						me_ptr->generateCell(x, y, z);
-					}
+	std::vector<int32> remap(section.ProcVertexBuffer.Num(), -1);
+	int32 t = 0;
+
+	for (int32 i = 0; i < triangleNum; i++) {
+		const int32 cell = section.ProcTriangleCellBuffer[i];
+		if (isCellInBox(cell, n, lower, upper)) {
+			continue;
+		}
+
+		for (int k = 0; k < 3; k++) {
+			const uint32 vertexIndex = section.ProcIndexBuffer[i * 3 + k];
+			section.ProcIndexBuffer[t * 3 + k] = vertexIndex;
+			remap[vertexIndex] = 0;
+		}
+
+		section.ProcTriangleCellBuffer[t] = cell;
+		t++;
+	}
+
+	if (t == triangleNum) {
+		return true;
+	}
+
+	section.ProcIndexBuffer.SetNum(t * 3);
+	section.ProcTriangleCellBuffer.SetNum(t);
+
+	int32 v = 0;
+	section.SectionLocalBox.Init();
+	for (int32 i = 0; i < section.ProcVertexBuffer.Num(); i++) {
+		if (remap[i] >= 0) {
+			remap[i] = v;
+			section.ProcVertexBuffer[v] = section.ProcVertexBuffer[i];
+			section.ProcVertexEdgeBuffer[v] = section.ProcVertexEdgeBuffer[i];
+			section.SectionLocalBox += section.ProcVertexBuffer[v].Pos;
+			v++;
+		}
+	}
+
+	section.ProcVertexBuffer.SetNum(v);
+	section.ProcVertexEdgeBuffer.SetNum(v);
+
+	for (uint32& vertexIndex : section.ProcIndexBuffer) {
+		vertexIndex = remap[vertexIndex];
+	}
+
+	return true;
+}
+
+static bool removeCellTriangles(TMeshContainer& container, int n, const TVoxelIndex& lower, const TVoxelIndex& upper) {
+	for (auto& Element : container.MaterialSectionMap) {
+		if (!removeCellTriangles(Element.Value.MaterialMesh, n, lower, upper)) {
+			return false;
+		}
+	}
+
+	for (auto& Element : container.MaterialTransitionSectionMap) {
+		if (!removeCellTriangles(Element.Value.MaterialMesh, n, lower, upper)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// edges of vertexes used by triangles of cells inside cell box, these vertexes lose part of their triangles on remesh
+static void collectCellEdges(const FProcMeshSection& section, int n, const TVoxelIndex& lower, const TVoxelIndex& upper, TFlatMap<TEdgeKey, FVector>& edge_map) {
+	const int32 triangleNum = section.ProcIndexBuffer.Num() / 3;
+	if (section.ProcTriangleCellBuffer.Num() != triangleNum || section.ProcVertexEdgeBuffer.Num() != section.ProcVertexBuffer.Num()) {
+		return;
+	}
+
+	for (int32 i = 0; i < triangleNum; i++) {
+		if (isCellInBox(section.ProcTriangleCellBuffer[i], n, lower, upper)) {
+			for (int k = 0; k < 3; k++) {
+				edge_map.findOrAdd(section.ProcVertexEdgeBuffer[section.ProcIndexBuffer[i * 3 + k]]) = FVector(0);
+			}
+		}
+	}
+}
+
+static void setVertexNormals(FProcMeshSection& section, const TFlatMap<TEdgeKey, FVector>& normal_map) {
+	for (int32 i = 0; i < section.ProcVertexEdgeBuffer.Num(); i++) {
+		const FVector* normal = normal_map.find(section.ProcVertexEdgeBuffer[i]);
+		if (normal && !normal->IsZero()) {
+			section.ProcVertexBuffer[i].Normal = *normal;
+		}
+	}
+}
+
+static void setVertexNormals(TMeshContainer& container, const TFlatMap<TEdgeKey, FVector>& normal_map) {
+	for (auto& Element : container.MaterialSectionMap) {
+		setVertexNormals(Element.Value.MaterialMesh, normal_map);
+	}
+
+	for (auto& Element : container.MaterialTransitionSectionMap) {
+		setVertexNormals(Element.Value.MaterialMesh, normal_map);
+	}
+}
+
+// Kept vertexes on region border still have normals of removed triangles. Average them again over current triangles of general section
+// and copy to all sections. normal_map contains edges of vertexes of removed triangles, vertexes of first keptVertexNum are kept ones
+static void updateBorderNormals(TMeshLodSection& lod_section, TFlatMap<TEdgeKey, FVector>& normal_map, int32 keptTriangleNum, int32 keptVertexNum) {
+	const FProcMeshSection& section = lod_section.WholeMesh;
+	const int32 triangleNum = section.ProcIndexBuffer.Num() / 3;
+
+	for (int32 i = keptTriangleNum * 3; i < triangleNum * 3; i++) {
+		const uint32 vertexIndex = section.ProcIndexBuffer[i];
+		if ((int32)vertexIndex < keptVertexNum) {
+			normal_map.findOrAdd(section.ProcVertexEdgeBuffer[vertexIndex]) = FVector(0);
+		}
+	}
+
+	if (normal_map.empty()) {
+		return;
+	}
+
+	// vertexes re-created by extractor get no sum here and keep own normals
+	for (int32 i = 0; i < triangleNum; i++) {
+		FVector* normalArray[3];
+		bool bBorder = false;
+		for (int k = 0; k < 3; k++) {
+			const uint32 vertexIndex = section.ProcIndexBuffer[i * 3 + k];
+			normalArray[k] = ((int32)vertexIndex < keptVertexNum) ? normal_map.find(section.ProcVertexEdgeBuffer[vertexIndex]) : nullptr;
+			bBorder |= normalArray[k] != nullptr;
+		}
+
+		if (bBorder) {
+			FVector p1 = section.ProcVertexBuffer[section.ProcIndexBuffer[i * 3]].Pos;
+			FVector p2 = section.ProcVertexBuffer[section.ProcIndexBuffer[i * 3 + 1]].Pos;
+			FVector p3 = section.ProcVertexBuffer[section.ProcIndexBuffer[i * 3 + 2]].Pos;
+			const FVector n = -clcNormal(p1, p2, p3);
+			for (int k = 0; k < 3; k++) {
+				if (normalArray[k]) {
+					*normalArray[k] += n;
 				}
-				//==================================================================
 			}
 		}
 	}
 
-    if(vdp.bZCut){
-        VoxelMeshExtractorPtr mdresh_extractor_ptr = VoxelMeshExtractorPtr(new VoxelMeshExtractor(mesh_data->MeshSectionLodArray[0], vd, vdp));
-    }
-    
-	mesh_data->CollisionMeshPtr = &mesh_data->MeshSectionLodArray[vdp.collisionLOD].WholeMesh;
-	return TMeshDataPtr(mesh_data);
+	for (auto& itm : normal_map) {
+		itm.second.Normalize();
+	}
+
+	setVertexNormals(lod_section.WholeMesh, normal_map);
+	setVertexNormals(lod_section.RegularMeshContainer, normal_map);
+	for (TMeshContainer& container : lod_section.TransitionPatchArray) {
+		setVertexNormals(container, normal_map);
+	}
+}
+
+template <typename T>
+static void removeEmptySections(T& sectionMap) {
+	TArray<unsigned short> emptyList;
+	for (const auto& Element : sectionMap) {
+		if (Element.Value.MaterialMesh.ProcIndexBuffer.Num() == 0) {
+			emptyList.Add(Element.Key);
+		}
+	}
+
+	for (unsigned short key : emptyList) {
+		sectionMap.Remove(key);
+	}
+}
+
+// Copy of base mesh where only cells which contain voxels of box [lower, upper] are extracted again.
+// Base mesh must be generated with bKeepCellInfo from the same voxel data before change. Returns nullptr if it is not possible
+TMeshDataPtr sandboxVoxelGenerateMeshRegion(const TVoxelData& vd, const TVoxelDataParam& vdp, const TMeshData& base, const TVoxelIndex& lower, const TVoxelIndex& upper) {
+	if (!vd.isSubstanceCacheValid() || vdp.bZCut || vdp.bForceNoCache || base.bCollisionOnly != vdp.bCollisionOnly) {
+		return nullptr;
+	}
+
+	TMeshDataPtr mesh_data_ptr = std::make_shared<TMeshData>();
+	mesh_data_ptr->MeshSectionLodArray = base.MeshSectionLodArray;
+	mesh_data_ptr->LodMask = base.LodMask & clcLodMask(vdp);
+	mesh_data_ptr->bCollisionOnly = base.bCollisionOnly;
+
+	const int n = vd.num();
+	std::atomic<bool> bNoCellInfo{ false };
+
+	forEachLod(vdp, mesh_data_ptr->LodMask, [&](int lod) {
+		TVoxelDataGenerationParam me_vdp = vdp;
+		me_vdp.lod = lod;
+		me_vdp.bKeepCellInfo = true;
+
+		TVoxelIndex cell_lower, cell_upper;
+		if (!vd::tools::clcCellBox(n, me_vdp.step(), lower, upper, cell_lower, cell_upper)) {
+			return;
+		}
+
+		TMeshLodSection& lod_section = mesh_data_ptr->MeshSectionLodArray[lod];
+		TFlatMap<TEdgeKey, FVector> border_normal_map;
+		collectCellEdges(lod_section.WholeMesh, n, cell_lower, cell_upper, border_normal_map);
+
+		if (!removeCellTriangles(lod_section.WholeMesh, n, cell_lower, cell_upper) || !removeCellTriangles(lod_section.RegularMeshContainer, n, cell_lower, cell_upper)) {
+			bNoCellInfo = true;
+			return;
+		}
+
+		for (TMeshContainer& container : lod_section.TransitionPatchArray) {
+			if (!removeCellTriangles(container, n, cell_lower, cell_upper)) {
+				bNoCellInfo = true;
+				return;
+			}
+		}
+
+		const int32 keptTriangleNum = lod_section.WholeMesh.ProcIndexBuffer.Num() / 3;
+		const int32 keptVertexNum = lod_section.WholeMesh.ProcVertexBuffer.Num();
+
+		{
+			VoxelMeshExtractor mesh_extractor(lod_section, vd, me_vdp);
+			mesh_extractor.registerExistingVertexes();
+
+			vd.forEachCacheItem(lod, [&](const TSubstanceCacheItem& itm) {
+				const int index = itm.index;
+				const int x = index / (n * n);
+				const int y = (index / n) % n;
+				const int z = index % n;
+
+				if (x >= cell_lower.X && x <= cell_upper.X && y >= cell_lower.Y && y <= cell_upper.Y && z >= cell_lower.Z && z <= cell_upper.Z) {
+					mesh_extractor.generateCell(x, y, z);
+				}
+			});
+		}
+
+		updateBorderNormals(lod_section, border_normal_map, keptTriangleNum, keptVertexNum);
+
+		// transition material sections of regular mesh keep material codes for transition patches
+		removeEmptySections(lod_section.RegularMeshContainer.MaterialSectionMap);
+		for (TMeshContainer& container : lod_section.TransitionPatchArray) {
+			removeEmptySections(container.MaterialSectionMap);
+			removeEmptySections(container.MaterialTransitionSectionMap);
+		}
+	});
+
+	if (bNoCellInfo) {
+		return nullptr;
+	}
+
+	mesh_data_ptr->SetCollisionLod(base.CollisionLod);
+	return mesh_data_ptr;
 }
 
 //####################################################################################################################################
 
-TMeshDataPtr sandboxVoxelGenerateMesh(const TVoxelData &vd, const TVoxelDataParam &vdp) {
+// shared vertex pool
+//####################################################################################################################################
+
+static FORCEINLINE2 uint64 hashVector(const FVector& v, uint64 h) {
+	const double c[3] = { (double)v.X, (double)v.Y, (double)v.Z };
+	for (int i = 0; i < 3; i++) {
+		uint64 bits;
+		memcpy(&bits, &c[i], sizeof(uint64));
+		h = (h ^ bits) * 0x100000001B3ull;
+		h ^= h >> 29;
+	}
+
+	return h;
+}
+
+struct TPoolPosKey {
+	FVector pos;
+
+	bool operator == (const TPoolPosKey& other) const {
+		return pos == other.pos;
+	}
+};
+
+struct TPoolPosKeyHash {
+	size_t operator()(const TPoolPosKey& key) const {
+		return (size_t)hashVector(key.pos, 0xCBF29CE484222325ull);
+	}
+};
+
+// render sections share vertexes only if all vertex attributes are equal
+struct TPoolVertexKey {
+	FVector pos;
+	FVector normal;
+	int32 matIdx;
+
+	bool operator == (const TPoolVertexKey& other) const {
+		return pos == other.pos && normal == other.normal && matIdx == other.matIdx;
+	}
+};
+
+struct TPoolVertexKeyHash {
+	size_t operator()(const TPoolVertexKey& key) const {
+		return (size_t)hashVector(key.normal, hashVector(key.pos, 0xCBF29CE484222325ull) + (uint32)key.matIdx);
+	}
+};
+
+// Move vertexes of all sections of LOD to one pool, equal vertexes are stored once.
+// Collision mesh uses position only, so it references any render vertex at the same position
+static void shareLodVertexes(TMeshLodSection& lod_section) {
+	if (lod_section.VertexPoolPtr) {
+		return;
+	}
+
+	std::shared_ptr<TArray<TMeshVertex>> pool_ptr = std::make_shared<TArray<TMeshVertex>>();
+	TArray<TMeshVertex>& pool = *pool_ptr;
+
+	TFlatMap<TPoolVertexKey, uint32, TPoolVertexKeyHash> vertex_map;
+	TFlatMap<TPoolPosKey, uint32, TPoolPosKeyHash> pos_map;
+
+	auto moveToPool = [&](FProcMeshSection& section, bool bPositionOnly) {
+		const int32 vertex_num = section.ProcVertexBuffer.Num();
+		section.ProcPoolIndexBuffer.SetNum(vertex_num);
+		for (int32 i = 0; i < vertex_num; i++) {
+			const TMeshVertex& vertex = section.ProcVertexBuffer[i];
+			const TPoolVertexKey key{ vertex.Pos, vertex.Normal, vertex.MatIdx };
+
+			const uint32* found = bPositionOnly ? pos_map.find(TPoolPosKey{ vertex.Pos }) : vertex_map.find(key);
+			if (found) {
+				section.ProcPoolIndexBuffer[i] = *found;
+				continue;
+			}
+
+			const uint32 index = (uint32)pool.Num();
+			pool.Add(vertex);
+			vertex_map.insert(key, index);
+			pos_map.insert(TPoolPosKey{ vertex.Pos }, index);
+			section.ProcPoolIndexBuffer[i] = index;
+		}
+
+		section.ProcVertexBuffer.Empty();
+		section.VertexPoolPtr = pool_ptr;
+	};
+
+	auto moveContainerToPool = [&](TMeshContainer& container) {
+		for (auto& element : container.MaterialSectionMap) {
+			moveToPool(element.Value.MaterialMesh, false);
+		}
+
+		for (auto& element : container.MaterialTransitionSectionMap) {
+			moveToPool(element.Value.MaterialMesh, false);
+		}
+	};
+
+	moveContainerToPool(lod_section.RegularMeshContainer);
+	for (TMeshContainer& container : lod_section.TransitionPatchArray) {
+		moveContainerToPool(container);
+	}
+
+	moveToPool(lod_section.WholeMesh, true);
+
+	pool.Shrink();
+	lod_section.VertexPoolPtr = pool_ptr;
+}
+
+static TMeshDataPtr generateMesh(const TVoxelData& vd, const TVoxelDataParam& vdp) {
+	if (vdp.bCollisionOnly) {
+		TMeshDataPtr mesh_data_ptr = (vd.isSubstanceCacheValid() && !vdp.bZCut && !vdp.bForceNoCache) ? polygonizeCellSubstanceCacheNoLOD(vd, vdp) : polygonizeVoxelGridNoLOD(vd, vdp);
+		mesh_data_ptr->LodMask = 1;
+		mesh_data_ptr->bCollisionOnly = true;
+		return mesh_data_ptr;
+	}
+
     if (vd.isSubstanceCacheValid() && !vdp.bZCut && !vdp.bForceNoCache) {
 		return vdp.bGenerateLOD ? polygonizeCellSubstanceCacheLOD(vd, vdp) : polygonizeCellSubstanceCacheNoLOD(vd, vdp);
 	}
@@ -836,3 +1555,46 @@ TMeshDataPtr sandboxVoxelGenerateMesh(const TVoxelData &vd, const TVoxelDataPara
 	//UE_LOG(LogVt, Warning, TEXT("No voxel data cache: %f %f %f"), vd.getOrigin().X, vd.getOrigin().Y, vd.getOrigin().Z);
 	return vdp.bGenerateLOD ? polygonizeVoxelGridWithLOD(vd, vdp) : polygonizeVoxelGridNoLOD(vd, vdp);
 }
+
+TMeshDataPtr sandboxVoxelGenerateMesh(const TVoxelData &vd, const TVoxelDataParam &vdp) {
+	TMeshDataPtr mesh_data_ptr = generateMesh(vd, vdp);
+
+	// partial remesh needs own vertex buffer of each section
+	if (vdp.bShareVertexes && !vdp.bKeepCellInfo) {
+		forEachLod(vdp, clcLodMask(vdp), [&](int lod) {
+			shareLodVertexes(mesh_data_ptr->MeshSectionLodArray[lod]);
+		});
+	}
+
+	return mesh_data_ptr;
+}
+
+// Copy of base mesh with LODs of lod_mask which base mesh doesn't have. Existing LODs are copied, new ones are extracted from voxel data.
+// Voxel data must be the same as base mesh is generated from. Collision LOD is vdp.collisionLOD if mesh has it, otherwise one of base mesh
+TMeshDataPtr sandboxVoxelGenerateMeshLod(const TVoxelData& vd, const TVoxelDataParam& vdp, const TMeshData& base, uint32 lod_mask) {
+	TMeshDataPtr mesh_data_ptr = std::make_shared<TMeshData>();
+	mesh_data_ptr->MeshSectionLodArray = base.MeshSectionLodArray;
+
+	const uint32 new_mask = lod_mask & USBT_LOD_MASK_ALL & ~base.LodMask;
+	const bool bCache = vd.isSubstanceCacheValid() && !vdp.bZCut && !vdp.bForceNoCache;
+
+	forEachLod(vdp, new_mask, [&](int lod) {
+		TMeshLodSection& lod_section = mesh_data_ptr->MeshSectionLodArray[lod];
+		if (bCache) {
+			extractLodCellSubstanceCache(vd, vdp, lod, lod_section);
+		} else {
+			extractLodVoxelGrid(vd, vdp, lod, lod_section);
+		}
+
+		if (vdp.bShareVertexes && !vdp.bKeepCellInfo) {
+			shareLodVertexes(lod_section);
+		}
+	});
+
+	mesh_data_ptr->LodMask = base.LodMask | new_mask;
+	mesh_data_ptr->SetCollisionLod(mesh_data_ptr->HasLod(vdp.collisionLOD) ? vdp.collisionLOD : base.CollisionLod);
+	mesh_data_ptr->BaseMaterialId = base.BaseMaterialId;
+	mesh_data_ptr->VStamp = base.VStamp;
+	mesh_data_ptr->SourceRevision = base.SourceRevision;
+	return mesh_data_ptr;
+}
@@ -8,5 +8,9 @@
 
 std::shared_ptr<TMeshData> sandboxVoxelGenerateMesh(const TVoxelData &vd, const TVoxelDataParam &vdp);
 
+std::shared_ptr<TMeshData> sandboxVoxelGenerateMeshRegion(const TVoxelData& vd, const TVoxelDataParam& vdp, const TMeshData& base, const TVoxelIndex& lower, const TVoxelIndex& upper);
+
+std::shared_ptr<TMeshData> sandboxVoxelGenerateMeshLod(const TVoxelData& vd, const TVoxelDataParam& vdp, const TMeshData& base, uint32 lod_mask);
+
 TMeshDataPtr polygonizeSingleCell(const TVoxelData& vd, const TVoxelDataParam& vdp, int x, int y, int z);
 
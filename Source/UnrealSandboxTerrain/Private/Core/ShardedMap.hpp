@@ -0,0 +1,123 @@
+#pragma once
+
+#include "FlatMap.h"
+#include <shared_mutex>
+#include <mutex>
+#include <functional>
+#include <stdint.h>
+
+// Concurrent hash map split to independent shards.
+// Each shard has own reader-writer lock: lookups take shared lock only,
+// insert takes exclusive lock of one shard.
+template <typename K, typename V, int ShardNum = 64, typename H = std::hash<K>>
+class TShardedMap {
+
+	static_assert((ShardNum & (ShardNum - 1)) == 0, "shard number must be power of two");
+
+private:
+
+	struct alignas(64) TShard {
+		mutable std::shared_mutex mutex;
+		TFlatMap<K, V, H> map;
+	};
+
+	TShard shard_array[ShardNum];
+
+	TShard& getShard(const K& key) {
+		return shard_array[clcShardIndex(key)];
+	}
+
+	const TShard& getShard(const K& key) const {
+		return shard_array[clcShardIndex(key)];
+	}
+
+	// shard is selected by middle bits of mixed hash, slot inside shard - by high bits
+	static int clcShardIndex(const K& key) {
+		const uint64_t h = (uint64_t)H()(key) * 0x9E3779B97F4A7C15ull;
+		return (int)(h >> 20) & (ShardNum - 1);
+	}
+
+public:
+
+	bool find(const K& key, V& val) const {
+		const TShard& shard = getShard(key);
+		std::shared_lock<std::shared_mutex> lock(shard.mutex);
+		const V* v = shard.map.find(key);
+		if (!v) {
+			return false;
+		}
+
+		val = *v;
+		return true;
+	}
+
+	bool contains(const K& key) const {
+		const TShard& shard = getShard(key);
+		std::shared_lock<std::shared_mutex> lock(shard.mutex);
+		return shard.map.contains(key);
+	}
+
+	// returns existing value or inserts new one created by factory.
+	// factory is called under exclusive shard lock
+	template <typename F>
+	V findOrAdd(const K& key, F factory) {
+		TShard& shard = getShard(key);
+
+		{
+			std::shared_lock<std::shared_mutex> lock(shard.mutex);
+			const V* v = shard.map.find(key);
+			if (v) {
+				return *v;
+			}
+		}
+
+		std::unique_lock<std::shared_mutex> lock(shard.mutex);
+		const V* v = shard.map.find(key);
+		if (v) {
+			return *v;
+		}
+
+		V res = factory();
+		shard.map.insert(key, res);
+		return res;
+	}
+
+	void set(const K& key, const V& val) {
+		TShard& shard = getShard(key);
+		std::unique_lock<std::shared_mutex> lock(shard.mutex);
+		shard.map[key] = val;
+	}
+
+	bool erase(const K& key) {
+		TShard& shard = getShard(key);
+		std::unique_lock<std::shared_mutex> lock(shard.mutex);
+		return shard.map.erase(key);
+	}
+
+	size_t size() const {
+		size_t s = 0;
+		for (const TShard& shard : shard_array) {
+			std::shared_lock<std::shared_mutex> lock(shard.mutex);
+			s += shard.map.size();
+		}
+
+		return s;
+	}
+
+	// shard is locked while function is called for its items
+	void forEach(std::function<void(const K&, const V&)> func) const {
+		for (const TShard& shard : shard_array) {
+			std::shared_lock<std::shared_mutex> lock(shard.mutex);
+			for (const auto& p : shard.map) {
+				func(p.first, p.second);
+			}
+		}
+	}
+
+	void clear() {
+		for (TShard& shard : shard_array) {
+			std::unique_lock<std::shared_mutex> lock(shard.mutex);
+			shard.map.clear();
+		}
+	}
+};
@@ -156,6 +156,7 @@ protected :
 		TArray<TSpawnZoneParam> SpawnList;
 		TSpawnZoneParam SpawnZoneParam;
 		SpawnZoneParam.Index = Index;
+		SpawnZoneParam.LodMask = Controller->ClcZoneLodMask(Index, OriginIndex);
 		SpawnList.Add(SpawnZoneParam);
 
 		// batch with one zone. CPU only
@@ -10,12 +10,16 @@
 #include "EngineMinimal.h"
 #include "VoxelIndex.h"
 #include "VoxelData.h"
-#include <unordered_map>
+#include "ShardedMap.hpp"
+#include "FlatMap.h"
+#include "ZoneDeltaLog.hpp"
+#include "ZonePayloadCache.hpp"
+#include "MapVersionLog.hpp"
+#include "EditMeshCache.hpp"
 #include <mutex>
 #include <shared_mutex>
 #include <memory>
 #include <atomic>
-#include <unordered_set>
 
 
 struct TSyncItem {
@@ -30,20 +34,30 @@ class TTerrainData {
 private:
 
 
-	std::shared_timed_mutex StorageMapMutex;
-	std::unordered_map<TVoxelIndex, std::shared_ptr<TVoxelDataInfo>> StorageMap;
+	TShardedMap<TVoxelIndex, std::shared_ptr<TVoxelDataInfo>> StorageMap;
 
 	std::shared_timed_mutex SaveIndexSetMutex;
-	std::unordered_set<TVoxelIndex> SaveIndexSet;
+	TFlatSet<TVoxelIndex> SaveIndexSet;
 
 	std::shared_timed_mutex SyncMapMutex;
-	std::unordered_map<TVoxelIndex, TSyncItem> SyncMap;
+	TFlatMap<TVoxelIndex, TSyncItem> SyncMap;
 
 	TMap<TVoxelIndex, TZoneModificationData> ModifiedVdMap;
 	std::atomic<int32> MapVerHash = 0;
 	std::mutex ModifiedVdMapMutex;
 
 	std::atomic<int32> ZonesCount = 0;
+
+	TZoneDeltaLog ZoneDeltaLog{ USBT_NET_DELTA_LOG_SIZE, USBT_NET_DELTA_ZONE_SIZE };
+
+	TZonePayloadCache ZonePayloadCache{ USBT_NET_ZONE_CACHE_SIZE };
+
+	TMapVersionLog MapVersionLog{ USBT_NET_MAP_LOG_SIZE };
+
+	TEditMeshCache EditMeshCache{ USBT_EDIT_MESH_CACHE_SIZE };
+
+	// guarded by ModifiedVdMapMutex
+	TFlatMap<TVoxelIndex, double> ZoneEditTimeMap;
     
 public:
 
@@ -77,11 +91,73 @@ public:
 		return ModifiedVdMap;
 	}
 
-	void IncreaseVStamp(const TVoxelIndex& ZoneIndex) {
+	int32 IncreaseVStamp(const TVoxelIndex& ZoneIndex) {
 		const std::lock_guard<std::mutex> Lock(ModifiedVdMapMutex);
 		TZoneModificationData& Data = ModifiedVdMap.FindOrAdd(ZoneIndex);
 		Data.VStamp++;
 		MapVerHash++;
+		MapVersionLog.add(MapVerHash, ZoneIndex, Data.VStamp);
+		ZoneEditTimeMap.findOrAdd(ZoneIndex) = FPlatformTime::Seconds();
+		ZonePayloadCache.invalidate(ZoneIndex);
+		return Data.VStamp;
+	}
+
+	// zones changed since client map version, false if server does not have such history
+	bool GetMapDelta(const int32 FromMapVStamp, int32& ToMapVStamp, std::vector<TMapVersionLog::TEntry>& EntryList) {
+		uint32 To = 0;
+		if (!MapVersionLog.get(FromMapVStamp, To, EntryList)) {
+			return false;
+		}
+
+		ToMapVStamp = To;
+		return true;
+	}
+
+	// 0 if zone is not edited since start
+	double GetZoneEditTime(const TVoxelIndex& ZoneIndex) {
+		const std::lock_guard<std::mutex> Lock(ModifiedVdMapMutex);
+		const double* Time = ZoneEditTimeMap.find(ZoneIndex);
+		return Time ? *Time : 0;
+	}
+
+	TDataPtr FindZonePayload(const TVoxelIndex& ZoneIndex, const int32 VStamp) {
+		return ZonePayloadCache.find(ZoneIndex, VStamp);
+	}
+
+	// last edit mesh of zone, should be used under zone lock
+	TMeshDataPtr GetEditMesh(const TVoxelIndex& ZoneIndex) {
+		return EditMeshCache.find(ZoneIndex);
+	}
+
+	void SetEditMesh(const TVoxelIndex& ZoneIndex, TMeshDataPtr MeshDataPtr) {
+		EditMeshCache.put(ZoneIndex, MeshDataPtr);
+	}
+
+	uint64 GetZonePayloadGeneration(const TVoxelIndex& ZoneIndex) {
+		return ZonePayloadCache.generation(ZoneIndex);
+	}
+
+	// Generation is value of GetZonePayloadGeneration before zone data was read
+	void PutZonePayload(const TVoxelIndex& ZoneIndex, const int32 VStamp, const uint64 Generation, TDataPtr Payload) {
+		ZonePayloadCache.put(ZoneIndex, VStamp, Generation, Payload);
+	}
+
+	// objects are changed without VStamp change
+	void InvalidateZonePayload(const TVoxelIndex& ZoneIndex) {
+		ZonePayloadCache.invalidate(ZoneIndex);
+	}
+
+	// region of voxels changed by edit which made VStamp, nullptr if only objects are changed
+	void AddZoneDelta(const TVoxelIndex& ZoneIndex, const int32 VStamp, TDataPtr RegionData) {
+		ZoneDeltaLog.add(ZoneIndex, VStamp, RegionData);
+	}
+
+	void MarkZoneObjectsChanged(const TVoxelIndex& ZoneIndex, const int32 VStamp) {
+		ZoneDeltaLog.markObjectsChanged(ZoneIndex, VStamp);
+	}
+
+	bool GetZoneDelta(const TVoxelIndex& ZoneIndex, const int32 FromVStamp, const int32 ToVStamp, std::vector<TDataPtr>& RegionList, bool& bObjectsChanged) {
+		return ZoneDeltaLog.get(ZoneIndex, FromVStamp, ToVStamp, USBT_NET_DELTA_ZONE_SIZE, RegionList, bObjectsChanged);
 	}
 
 	bool IsSaveIndexEmpty() {
@@ -94,24 +170,27 @@ public:
 		SaveIndexSet.insert(Index);
 	}
 
-	std::unordered_set<TVoxelIndex> PopSaveIndexSet() {
+	TFlatSet<TVoxelIndex> PopSaveIndexSet() {
 		std::unique_lock<std::shared_timed_mutex> Lock(SaveIndexSetMutex);
-		std::unordered_set<TVoxelIndex> Res = SaveIndexSet;
-		SaveIndexSet.clear();
+		TFlatSet<TVoxelIndex> Res;
+		std::swap(Res, SaveIndexSet);
 		return Res;
 	}
 
 	void AddSyncItem(const TVoxelIndex& Index) {
 		std::unique_lock<std::shared_timed_mutex> Lock(SyncMapMutex);
-		SyncMap[Index].Timestamp = FPlatformTime::Seconds();
-		SyncMap[Index].Cnt++;
+		TSyncItem& Itm = SyncMap.findOrAdd(Index);
+		Itm.Timestamp = FPlatformTime::Seconds();
+		Itm.Cnt++;
 	}
 
 	void AddSyncItem(const TSet<TVoxelIndex>& IndexSet) {
 		std::unique_lock<std::shared_timed_mutex> Lock(SyncMapMutex);
+		SyncMap.reserve(SyncMap.size() + IndexSet.Num());
 		for (const auto& Index : IndexSet) {
-			SyncMap[Index].Timestamp = FPlatformTime::Seconds();
-			SyncMap[Index].Cnt++;
+			TSyncItem& Itm = SyncMap.findOrAdd(Index);
+			Itm.Timestamp = FPlatformTime::Seconds();
+			Itm.Cnt++;
 		}
 	}
 
@@ -122,7 +201,7 @@ public:
 
 	bool IsOutOfSync(const TVoxelIndex& Index) {
 		std::shared_lock<std::shared_timed_mutex> Lock(SyncMapMutex);
-		return SyncMap.find(Index) != SyncMap.end();
+		return SyncMap.contains(Index);
 	}
 
 	int SyncMapSize() {
@@ -130,9 +209,9 @@ public:
 		return (int)SyncMap.size();
 	}
 
-	std::unordered_set<TVoxelIndex> StaledSyncItems(const double Timeout) {
+	TFlatSet<TVoxelIndex> StaledSyncItems(const double Timeout) {
 		std::shared_lock<std::shared_timed_mutex> Lock(SyncMapMutex);
-		std::unordered_set<TVoxelIndex> result;
+		TFlatSet<TVoxelIndex> result;
 
 		const auto Timestamp = FPlatformTime::Seconds();
 
@@ -189,14 +268,7 @@ public:
 	//=====================================================================================
     
 	TVoxelDataInfoPtr GetVoxelDataInfo(const TVoxelIndex& Index) {
-		std::unique_lock<std::shared_timed_mutex> Lock(StorageMapMutex);
-		if (StorageMap.find(Index) != StorageMap.end()) {
-			return StorageMap[Index];
-		} else {
-			TVoxelDataInfoPtr NewVdinfo = std::make_shared<TVoxelDataInfo>();
-			StorageMap.insert({ Index, NewVdinfo });
-			return NewVdinfo;
-		}
+		return StorageMap.findOrAdd(Index, [] { return std::make_shared<TVoxelDataInfo>(); });
     }
 
 	//=====================================================================================
@@ -207,6 +279,11 @@ public:
 		// no locking because end play only
 		StorageMap.clear();
 		ModifiedVdMap.Empty();
+		ZoneDeltaLog.clear();
+		ZonePayloadCache.clear();
+		EditMeshCache.clear();
+		MapVersionLog.clear(MapVerHash);
+		ZoneEditTimeMap.clear();
     }
 };
 
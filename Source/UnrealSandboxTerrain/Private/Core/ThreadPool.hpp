@@ -1,92 +1,268 @@
+#pragma once
 
 #include <iostream>
+#include <algorithm>
 #include <atomic>
 #include <vector>
 #include <list>
 #include <mutex>
 #include <functional>
 #include <thread>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <type_traits>
+#include <chrono>
+
+// priority classes, lower value runs first
+enum class TTaskPriority : uint8_t {
+    PLAYER_EDIT = 0,
+    NEAR_STREAMING = 1,
+    FAR_STREAMING = 2,
+    SAVE = 3
+};
 
-class TConveyour {
+#define TASK_PRIORITY_NUM 4
+
+// closures up to this size are stored in task itself without heap allocation
+#define TASK_INLINE_SIZE 48
+
+// move-only callable with small buffer
+class TTask {
 
 private:
-    std::mutex m;
 
-    std::list<std::function<void()>> list;
+    struct TOps {
+        void (*invoke)(void*);
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void*);
+    };
+
+    template <typename F>
+    struct TInlineOps {
+        static void invoke(void* p) {
+            (*static_cast<F*>(p))();
+        }
+
+        static void move(void* dst, void* src) {
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+
+        static void destroy(void* p) {
+            static_cast<F*>(p)->~F();
+        }
+
+        static constexpr TOps ops{ invoke, move, destroy };
+    };
+
+    template <typename F>
+    struct THeapOps {
+        static void invoke(void* p) {
+            (**static_cast<F**>(p))();
+        }
 
-    std::atomic<int> s{0};
+        static void move(void* dst, void* src) {
+            *static_cast<F**>(dst) = *static_cast<F**>(src);
+        }
+
+        static void destroy(void* p) {
+            delete *static_cast<F**>(p);
+        }
+
+        static constexpr TOps ops{ invoke, move, destroy };
+    };
+
+    alignas(std::max_align_t) unsigned char storage[TASK_INLINE_SIZE];
+
+    const TOps* ops = nullptr;
 
 public:
 
-    void push(std::function<void()> f) {
-        const std::lock_guard<std::mutex> lock(m);
-        list.push_back(f);
-        s++;
+    TTask() { }
+
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, TTask>>>
+    TTask(F&& f) {
+        using T = std::decay_t<F>;
+        if constexpr (sizeof(T) <= TASK_INLINE_SIZE && alignof(T) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<T>) {
+            new (storage) T(std::forward<F>(f));
+            ops = &TInlineOps<T>::ops;
+        } else {
+            *reinterpret_cast<T**>(storage) = new T(std::forward<F>(f));
+            ops = &THeapOps<T>::ops;
+        }
     }
 
-    bool pop(std::function<void()>& f) {
-        const std::lock_guard<std::mutex> lock(m);
+    TTask(TTask&& other) noexcept {
+        if (other.ops) {
+            other.ops->move(storage, other.storage);
+            ops = other.ops;
+            other.ops = nullptr;
+        }
+    }
 
-        if (list.size() == 0) {
-            return false;
+    TTask& operator=(TTask&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops) {
+                other.ops->move(storage, other.storage);
+                ops = other.ops;
+                other.ops = nullptr;
+            }
         }
 
-        f = list.front();
-        list.pop_front();
-        s--;
+        return *this;
+    }
 
-        return true;
+    TTask(const TTask&) = delete;
+
+    TTask& operator=(const TTask&) = delete;
+
+    ~TTask() {
+        reset();
     }
 
-    int size() {
-        return s.load();
+    void reset() {
+        if (ops) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
     }
 
+    explicit operator bool() const {
+        return ops != nullptr;
+    }
+
+    void operator()() {
+        ops->invoke(storage);
+    }
 };
 
 
+// Work-stealing thread pool.
+// Each worker has own deque per priority class. Task added from worker thread goes to its own deque,
+// from other threads - round robin. Idle worker takes task of highest priority class from own deque first,
+// then steals from others.
 class TThreadPool {
 
 private:
 
-    std::atomic<int> task_size;
+    struct TWorker {
+        std::mutex mutex;
+        std::deque<TTask> queue[TASK_PRIORITY_NUM];
+        std::atomic<int> queue_size[TASK_PRIORITY_NUM] = {};
+        std::thread thread;
+    };
 
-    std::atomic_flag shutdown;
+    std::vector<std::unique_ptr<TWorker>> worker_list;
 
-    std::mutex mutex;
+    // queued tasks, total and per priority class
+    std::atomic<int> task_size{ 0 };
+    std::atomic<int> priority_size[TASK_PRIORITY_NUM] = {};
 
-    std::condition_variable cv;
+    std::atomic<unsigned int> next_worker{ 0 };
 
-    std::vector<std::thread> thread_list;
+    std::atomic<bool> shutdown{ false };
 
-    std::list<std::function<void()>> task_list;
+    std::mutex idle_mutex;
+    std::condition_variable idle_cv;
+    std::atomic<int> idle_num{ 0 };
 
-    void run() {
-        while (!shutdown.test()) {
-            std::unique_lock lock(mutex);
-            cv.wait(lock, [this]()->bool { return task_list.size() > 0 || shutdown.test(); });
+    static inline thread_local TThreadPool* current_pool = nullptr;
+    static inline thread_local int current_worker = -1;
 
-            if (task_list.size() > 0 && !shutdown.test()) {
-                std::function<void()> f = task_list.front();
-                task_list.pop_front();
-                task_size--;
-                lock.unlock();
-                f();
+    bool popFront(TWorker& worker, int p, TTask& task) {
+        if (worker.queue_size[p].load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
+
+        const std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.queue[p].empty()) {
+            return false;
+        }
+
+        task = std::move(worker.queue[p].front());
+        worker.queue[p].pop_front();
+        worker.queue_size[p]--;
+        return true;
+    }
+
+    bool stealBack(TWorker& worker, int p, TTask& task) {
+        if (worker.queue_size[p].load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
+
+        const std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.queue[p].empty()) {
+            return false;
+        }
+
+        task = std::move(worker.queue[p].back());
+        worker.queue[p].pop_back();
+        worker.queue_size[p]--;
+        return true;
+    }
+
+    bool pop(int idx, TTask& task) {
+        const int num = (int)worker_list.size();
+
+        for (int p = 0; p < TASK_PRIORITY_NUM; p++) {
+            if (priority_size[p].load() <= 0) {
+                continue;
+            }
 
+            if (popFront(*worker_list[idx], p, task)) {
+                priority_size[p]--;
+                return true;
+            }
+
+            for (int i = 1; i < num; i++) {
+                if (stealBack(*worker_list[(idx + i) % num], p, task)) {
+                    priority_size[p]--;
+                    return true;
+                }
             }
         }
+
+        return false;
+    }
+
+    void run(int idx) {
+        current_pool = this;
+        current_worker = idx;
+
+        TTask task;
+        while (!shutdown.load()) {
+            if (pop(idx, task)) {
+                task_size--;
+                task();
+                task.reset();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(idle_mutex);
+            idle_num++;
+            idle_cv.wait(lock, [this]() -> bool { return task_size.load() > 0 || shutdown.load(); });
+            idle_num--;
+        }
     };
 
 public:
 
-    TThreadPool(int num) {
-        task_size = 0;
-        shutdown.clear();
+    // num <= 0 - one worker per CPU core
+    TThreadPool(int num = 0) {
+        if (num <= 0) {
+            num = std::max(1, (int)std::thread::hardware_concurrency());
+        }
+
+        for (int i = 0; i < num; i++) {
+            worker_list.push_back(std::make_unique<TWorker>());
+        }
 
         for (int i = 0; i < num; i++) {
-            //TODO linux
-            std::thread t(&TThreadPool::run, this);
-            thread_list.push_back(std::move(t));
+            worker_list[i]->thread = std::thread(&TThreadPool::run, this, i);
         }
     };
 
@@ -94,30 +270,44 @@ public:
         shutdownAndWait();
     };
 
-    void addTask(const std::function<void()> task, bool bHiPrio = false) {
-        std::lock_guard<std::mutex> lock(mutex);
+    void addTask(TTask task, TTaskPriority priority) {
+        const int p = (int)priority;
+        const int idx = (current_pool == this) ? current_worker : (int)(next_worker++ % worker_list.size());
+        TWorker& worker = *worker_list[idx];
+
+        // counters first: worker which sees them before push is done just retries
         task_size++;
+        priority_size[p]++;
 
-        if (bHiPrio) {
-            task_list.push_front(task);
-        } else {
-            task_list.push_back(task);
+        {
+            const std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.queue[p].push_back(std::move(task));
+            worker.queue_size[p]++;
         }
 
-        cv.notify_one();
+        if (idle_num.load() > 0) {
+            // sync with worker which is going to sleep right now
+            idle_mutex.lock();
+            idle_mutex.unlock();
+            idle_cv.notify_one();
+        }
     }
 
+    // not started tasks are dropped
     void shutdownAndWait() {
-        shutdown.test_and_set();
-        cv.notify_all();
+        {
+            const std::lock_guard<std::mutex> lock(idle_mutex);
+            shutdown = true;
+        }
 
-        //TODO linux 
+        idle_cv.notify_all();
 
-        for (auto& t : thread_list) {
-            t.join();
+        for (auto& worker : worker_list) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
         }
 
-        thread_list.clear();
         task_size = 0;
     }
 
@@ -125,4 +315,192 @@ public:
         return task_size;
     }
 
+    int threadNum() const {
+        return (int)worker_list.size();
+    }
+
+    // Call func(0) .. func(num - 1) on calling thread and pool workers, return when all calls are finished.
+    // Indexes are taken in ascending order by calling thread and helper tasks. Calling thread runs not taken indexes itself
+    // and never waits for unrelated tasks, so it is safe to call from worker thread.
+    void parallelFor(int num, const std::function<void(int)>& func, TTaskPriority priority) {
+        struct TState {
+            std::atomic<int> next{ 0 };
+            std::atomic<int> done{ 0 };
+            std::mutex mutex;
+            std::condition_variable cv;
+        };
+
+        // helper task can start after return, it finds no index and does not touch func
+        auto state = std::make_shared<TState>();
+        auto work = [state, &func, num]() {
+            int i;
+            while ((i = state->next++) < num) {
+                func(i);
+                if (++state->done == num) {
+                    { const std::lock_guard<std::mutex> lock(state->mutex); }
+                    state->cv.notify_all();
+                }
+            }
+        };
+
+        const int helper_num = std::min(num, threadNum()) - 1;
+        for (int i = 0; i < helper_num; i++) {
+            addTask(work, priority);
+        }
+
+        work();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->cv.wait(lock, [&]() -> bool { return state->done.load() == num; });
+    }
+
+};
+
+
+// conveyor task cost classes
+enum class TConveyorTaskClass : uint8_t {
+    GENERAL = 0,
+    ADD_ZONE = 1, // create zone component, apply mesh and spawn instances
+    APPLY_MESH = 2,
+    NO_MESH_ZONE = 3
+};
+
+#define CONVEYOR_TASK_CLASS_NUM 4
+
+struct TConveyorStat {
+    int size = 0; // queue depth
+    uint64_t done = 0;
+    double cost = 0; // average execution time, sec
+    double latency = 0; // average time in queue, sec
+    double max_latency = 0;
+};
+
+// Game thread task queue. Lock-free multi-producer single-consumer list:
+// push can be called from any thread, pop and execute - from consumer (game) thread only.
+class TConveyour {
+
+private:
+
+    typedef std::chrono::steady_clock TClock;
+
+    struct TNode {
+        std::atomic<TNode*> next{ nullptr };
+        TTask task;
+        TConveyorTaskClass task_class = TConveyorTaskClass::GENERAL;
+        TClock::time_point push_time;
+    };
+
+    // producers append to tail, consumer owns head. head is dummy node, first task is head->next
+    std::atomic<TNode*> tail;
+    TNode* head;
+
+    std::atomic<int> s{ 0 };
+    std::atomic<int> class_size[CONVEYOR_TASK_CLASS_NUM] = {};
+
+    // consumer thread only
+    TConveyorStat class_stat[CONVEYOR_TASK_CLASS_NUM];
+
+    TNode* front() const {
+        return head->next.load(std::memory_order_acquire);
+    }
+
+    // take task from first node, first node becomes dummy
+    TTask popFront(TNode* node) {
+        TTask task = std::move(node->task);
+        delete head;
+        head = node;
+        s--;
+        class_size[(int)node->task_class]--;
+        return task;
+    }
+
+    static void updateAverage(double& avg, double val) {
+        avg = (avg == 0) ? val : avg * 0.9 + val * 0.1;
+    }
+
+public:
+
+    TConveyour() {
+        head = new TNode();
+        tail = head;
+    }
+
+    ~TConveyour() {
+        while (TNode* node = front()) {
+            popFront(node);
+        }
+
+        delete head;
+    }
+
+    void push(TTask f, TConveyorTaskClass task_class) {
+        TNode* node = new TNode();
+        node->task = std::move(f);
+        node->task_class = task_class;
+        node->push_time = TClock::now();
+
+        s++;
+        class_size[(int)task_class]++;
+
+        TNode* prev = tail.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    bool pop(TTask& f) {
+        TNode* node = front();
+        if (!node) {
+            return false;
+        }
+
+        f = popFront(node);
+        return true;
+    }
+
+    // Execute tasks in queue order within time budget (sec). Next task is started only if
+    // average cost of its class fits remaining budget. At least one task is executed.
+    int execute(double budget) {
+        int num = 0;
+        double time = 0;
+
+        while (TNode* node = front()) {
+            const int c = (int)node->task_class;
+            TConveyorStat& stat = class_stat[c];
+
+            if (num > 0 && time + stat.cost > budget) {
+                break;
+            }
+
+            const TClock::time_point push_time = node->push_time;
+            TTask task = popFront(node);
+
+            const TClock::time_point start = TClock::now();
+            task();
+            const TClock::time_point end = TClock::now();
+
+            const double latency = std::chrono::duration<double>(start - push_time).count();
+            const double cost = std::chrono::duration<double>(end - start).count();
+
+            updateAverage(stat.latency, latency);
+            updateAverage(stat.cost, cost);
+            stat.max_latency = std::max(stat.max_latency, latency);
+            stat.done++;
+
+            time += cost;
+            num++;
+        }
+
+        return num;
+    }
+
+    int size() {
+        return s.load();
+    }
+
+    // consumer thread only
+    TConveyorStat getStat(TConveyorTaskClass task_class) const {
+        TConveyorStat stat = class_stat[(int)task_class];
+        stat.size = class_size[(int)task_class].load();
+        return stat;
+    }
+
 };
@@ -1,38 +1,54 @@
 
 #include "VoxelData.h"
 #include "serialization.hpp"
+#include "FlatMap.h"
 #include <string.h> // memcpy
+#include <cmath>
+#include <climits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define USBT_VD_ROW_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define USBT_VD_ROW_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 // mem stat
 std::atomic<int> vd_counter{ 0 };
 
+// high 32 bits of voxel data revision
+std::atomic<uint32> vd_revision_counter{ 0 };
+
 //====================================================================================
 // Voxel data impl
 //====================================================================================
 
 TVoxelData::TVoxelData() {
-	density_data = nullptr;
 	density_state = TVoxelDataFillState::ZERO;
-	material_data = nullptr;
 
 	voxel_num = 0;
 	volume_size = 0;
+	revision = (uint64)(++vd_revision_counter) << 32;
+	resetDirtyRegion();
 	vd_counter++;
 }
 
 TVoxelData::TVoxelData(int num, float size) {
-	density_data = nullptr;
 	density_state = TVoxelDataFillState::ZERO;
-	material_data = nullptr;
 
 	voxel_num = num;
 	volume_size = size;
+	revision = (uint64)(++vd_revision_counter) << 32;
+	resetDirtyRegion();
 	vd_counter++;
 }
 
 TVoxelData::~TVoxelData() {
-	if (density_data != nullptr) delete[] density_data;
-	if (material_data != nullptr) delete[] material_data;
 	vd_counter--;
 }
 
@@ -45,14 +61,11 @@ void TVoxelData::initCache() {
 }
 
 void TVoxelData::copyDataUnsafe(const TDensityVal* src_density_data, const TMaterialId* src_material_data) {
-	const int s = voxel_num * voxel_num * voxel_num;
-	density_data = new TDensityVal[s];
-	material_data = new TMaterialId[s];
-
-	memcpy(density_data, src_density_data, s * sizeof(TDensityVal));
-	memcpy(material_data, src_material_data, s * sizeof(TMaterialId));
+	density_data.copyFrom(voxel_num, src_density_data);
+	material_data.copyFrom(voxel_num, src_material_data);
 
 	density_state = TVoxelDataFillState::MIXED;
+	markDirtyAll();
 }
 
 void TVoxelData::copyCacheUnsafe(const int* cache_data, const int* len) {
@@ -71,31 +84,22 @@ void TVoxelData::copyCacheUnsafe(const int* cache_data, const int* len) {
 }
 
 void TVoxelData::initializeDensity() {
-	const int s = voxel_num * voxel_num * voxel_num;
-	density_data = new TDensityVal[s];
 	const TDensityVal d = (density_state == TVoxelDataFillState::FULL) ? 0xff : 0x00;
-
-	for (auto x = 0; x < voxel_num; x++) {
-		for (auto y = 0; y < voxel_num; y++) {
-			for (auto z = 0; z < voxel_num; z++) {
-				const int index = clcLinearIndex(x, y, z);
-				density_data[clcLinearIndex(x, y, z)] = d;
-			}
-		}
-	}
+	density_data.init(voxel_num, d);
 }
 
 void TVoxelData::initializeMaterial() {
-	const int s = voxel_num * voxel_num * voxel_num;
-	material_data = new TMaterialId[s];
+	material_data.init(voxel_num, base_fill_mat);
+}
 
-	for (auto x = 0; x < voxel_num; x++) {
-		for (auto y = 0; y < voxel_num; y++) {
-			for (auto z = 0; z < voxel_num; z++) {
-				material_data[clcLinearIndex(x, y, z)] = base_fill_mat;
-			}
-		}
-	}
+// release dense bricks which contain only one value
+void TVoxelData::compact() {
+	density_data.compact();
+	material_data.compact();
+}
+
+size_t TVoxelData::getResidentSize() const {
+	return sizeof(TVoxelData) + density_data.getAllocatedSize() + material_data.getAllocatedSize();
 }
 
 TDensityVal TVoxelData::clcFloatToByte(float v) {
@@ -108,7 +112,7 @@ float TVoxelData::clcByteToFloat(TDensityVal v) {
 }
 
 void TVoxelData::setDensity(int x, int y, int z, float density) {
-	if (density_data == NULL) {
+	if (!density_data.isInitialized()) {
 		if (density_state == TVoxelDataFillState::ZERO && density == 0) {
 			return;
 		}
@@ -122,24 +126,34 @@ void TVoxelData::setDensity(int x, int y, int z, float density) {
 	}
 
 	if (x < voxel_num && y < voxel_num && z < voxel_num) {
-		const int index = clcLinearIndex(x, y, z);
-
 		if (density < 0) density = 0;
 		if (density > 1) density = 1;
 
-		density_data[index] = clcFloatToByte(density);
+		if (density_data.set(x, y, z, clcFloatToByte(density))) {
+			markDirty(x, y, z);
+		}
 	}
 }
 
 void TVoxelData::setDensityAndMaterial(const TVoxelIndex& vi, float density, TMaterialId materialId) {
-	const int index = clcLinearIndex(vi.X, vi.Y, vi.Z);
+	if (!density_data.isInitialized()) {
+		initializeDensity();
+	}
+
+	if (!material_data.isInitialized()) {
+		initializeMaterial();
+	}
+
 	density_state = TVoxelDataFillState::MIXED;
-	density_data[index] = clcFloatToByte(density);
-	material_data[index] = materialId;
+	const bool is_density_changed = density_data.set(vi.X, vi.Y, vi.Z, clcFloatToByte(density));
+	const bool is_material_changed = material_data.set(vi.X, vi.Y, vi.Z, materialId);
+	if (is_density_changed || is_material_changed) {
+		markDirty(vi.X, vi.Y, vi.Z);
+	}
 }
 
 float TVoxelData::getDensity(int x, int y, int z) const {
-	if (density_data == NULL) {
+	if (!density_data.isInitialized()) {
 		if (density_state == TVoxelDataFillState::FULL) {
 			return 1;
 		}
@@ -148,8 +162,7 @@ float TVoxelData::getDensity(int x, int y, int z) const {
 	}
 
 	if (x < voxel_num && y < voxel_num && z < voxel_num) {
-		const int index = clcLinearIndex(x, y, z);
-		return clcByteToFloat(density_data[index]);
+		return clcByteToFloat(density_data.get(x, y, z));
 	} else {
 		return 0;
 	}
@@ -164,34 +177,32 @@ float TVoxelData::getDensity(const TVoxelIndex& vi) const {
 }
 
 FORCEINLINE TDensityVal TVoxelData::getRawDensityUnsafe(int x, int y, int z) const {
-	const int index = clcLinearIndex(x, y, z);
-	return density_data[index];
+	return density_data.get(x, y, z);
 }
 
 FORCEINLINE unsigned short TVoxelData::getRawMaterialUnsafe(int x, int y, int z) const {
-	const int index = clcLinearIndex(x, y, z);
-	return material_data[index];
+	return material_data.get(x, y, z);
 }
 
 void TVoxelData::setMaterial(const int x, const int y, const int z, const unsigned short material) {
-	if (material_data == NULL) {
+	if (!material_data.isInitialized()) {
 		initializeMaterial();
 	}
 
 	if (x < voxel_num && y < voxel_num && z < voxel_num) {
-		const int index = clcLinearIndex(x, y, z);
-		material_data[index] = material;
+		if (material_data.set(x, y, z, material)) {
+			markDirty(x, y, z);
+		}
 	}
 }
 
 unsigned short TVoxelData::getMaterial(int x, int y, int z) const {
-	if (material_data == NULL) {
+	if (!material_data.isInitialized()) {
 		return base_fill_mat;
 	}
 
 	if (x < voxel_num && y < voxel_num && z < voxel_num) {
-		const int index = clcLinearIndex(x, y, z);
-		auto mat_id = material_data[index];
+		auto mat_id = material_data.get(x, y, z);
 		if (mat_id == 0) {
 			return base_fill_mat;
 		}
@@ -248,6 +259,26 @@ void TVoxelData::vectorToVoxelIndex(const FVector& v, int& x, int& y, int& z) co
 	z = (int)(v.Z / step) + num() / 2 - 1;
 }
 
+// voxel index box covering world space box, clamped to volume. returns false if box is outside of volume
+bool TVoxelData::clcVoxelBox(const FBox& box, TVoxelIndex& lower, TVoxelIndex& upper) const {
+	const float step = size() / (num() - 1);
+	const float s = size() / 2;
+	const float e = (float)(num() - 1);
+
+	auto clcLower = [=](float v, float o) {
+		return (int)std::floor(std::clamp((v - o + s) / step, -1.f, e + 1.f));
+	};
+
+	auto clcUpper = [=](float v, float o) {
+		return (int)std::ceil(std::clamp((v - o + s) / step, -1.f, e + 1.f));
+	};
+
+	lower = TVoxelIndex(std::max(0, clcLower(box.Min.X, origin.X)), std::max(0, clcLower(box.Min.Y, origin.Y)), std::max(0, clcLower(box.Min.Z, origin.Z)));
+	upper = TVoxelIndex(std::min(num() - 1, clcUpper(box.Max.X, origin.X)), std::min(num() - 1, clcUpper(box.Max.Y, origin.Y)), std::min(num() - 1, clcUpper(box.Max.Z, origin.Z)));
+
+	return lower.X <= upper.X && lower.Y <= upper.Y && lower.Z <= upper.Z;
+}
+
 void TVoxelData::setOrigin(const FVector& o) {
 	origin = o;
 	lower = FVector(o.X - volume_size, o.Y - volume_size, o.Z - volume_size);
@@ -272,21 +303,14 @@ void TVoxelData::deinitializeDensity(TVoxelDataFillState State) {
 	}
 
 	density_state = State;
-	if (density_data != NULL) {
-		delete density_data;
-	}
-
-	density_data = NULL;
+	density_data.clear();
+	markDirtyAll();
 }
 
 void TVoxelData::deinitializeMaterial(unsigned short base_mat) {
 	base_fill_mat = base_mat;
-
-	if (material_data != NULL) {
-		delete material_data;
-	}
-
-	material_data = NULL;
+	material_data.clear();
+	markDirtyAll();
 }
 
 TVoxelDataFillState TVoxelData::getDensityFillState()	const {
@@ -299,7 +323,7 @@ unsigned long TVoxelData::getCaseCode(int x, int y, int z, int step) const {
 
 	vd::tools::makeIndexes(d, x, y, z, step);
 	for (auto i = 0; i < 8; i++) {
-		corner[7 - i] = (density_data[clcLinearIndex(d[i])] <= 127) ? -127 : 0;
+		corner[7 - i] = (density_data.get(d[i].X, d[i].Y, d[i].Z) <= 127) ? -127 : 0;
 	}
 
 	return vd::tools::caseCode(corner);
@@ -318,7 +342,7 @@ bool TVoxelData::performCellSubstanceCaching(int x, int y, int z, int lod, int s
 }
 
 FORCEINLINE void TVoxelData::performSubstanceCacheNoLOD(int x, int y, int z) {
-	if (density_data == NULL) {
+	if (!density_data.isInitialized()) {
 		return;
 	}
 
@@ -326,7 +350,7 @@ FORCEINLINE void TVoxelData::performSubstanceCacheNoLOD(int x, int y, int z) {
 }
 
 void TVoxelData::performSubstanceCacheLOD(int x, int y, int z, int initial_lod) {
-	if (density_data == NULL) {
+	if (!density_data.isInitialized()) {
 		return;
 	}
 
@@ -340,6 +364,117 @@ void TVoxelData::performSubstanceCacheLOD(int x, int y, int z, int initial_lod)
 	}
 }
 
+//====================================================================================
+// Substance cache row sweep
+//====================================================================================
+
+// one bit per voxel: density > 127 (solid). len must be padded to 64
+static void makeSolidRowMask(const TDensityVal* row, int len, uint64* mask) {
+#if defined(USBT_VD_ROW_AVX2)
+	for (int i = 0; i < len; i += 32) {
+		const __m256i v = _mm256_loadu_si256((const __m256i*)(row + i));
+		mask[i >> 6] |= (uint64)(uint32)_mm256_movemask_epi8(v) << (i & 63);
+	}
+#elif defined(USBT_VD_ROW_SSE2)
+	for (int i = 0; i < len; i += 16) {
+		const __m128i v = _mm_loadu_si128((const __m128i*)(row + i));
+		mask[i >> 6] |= (uint64)(uint32)_mm_movemask_epi8(v) << (i & 63);
+	}
+#else
+	for (int i = 0; i < len; i += 8) {
+		uint64 v;
+		memcpy(&v, row + i, sizeof(v));
+		mask[i >> 6] |= (((v & 0x8080808080808080ull) * 0x0002040810204081ull) >> 56) << (i & 63);
+	}
+#endif
+}
+
+static FORCEINLINE int countTrailingZeros(uint64 v) {
+#if defined(_MSC_VER)
+	unsigned long idx;
+	_BitScanForward64(&idx, v);
+	return (int)idx;
+#else
+	return __builtin_ctzll(v);
+#endif
+}
+
+// word i of multiword mask shifted right by s (s <= 64)
+static FORCEINLINE uint64 shiftRowMask(const uint64* mask, int w, int i, int s) {
+	const uint64 lo = (s < 64) ? mask[i] >> s : 0;
+	const uint64 hi = (i + 1 < w) ? ((s < 64) ? mask[i + 1] << (64 - s) : mask[i + 1]) : 0;
+	return lo | hi;
+}
+
+// Classify cells of all LODs at once. Every z-row is converted to a solid bitmask,
+// cell is a surface cell if its 8 corners are neither all solid nor all air.
+// Cache items are emitted in the same order as performSubstanceCacheLOD.
+void TVoxelData::performSubstanceCacheSweep(int lod_num) {
+	if (!density_data.isInitialized()) {
+		return;
+	}
+
+	const int n = voxel_num;
+	const int w = (n + 63) >> 6;
+
+	std::vector<uint64> solid(n * n * w, 0);
+	std::vector<TDensityVal> row(w * 64, 0);
+
+	for (int x = 0; x < n; x++) {
+		for (int y = 0; y < n; y++) {
+			density_data.copyRow(x, y, row.data());
+			makeSolidRowMask(row.data(), w * 64, &solid[(x * n + y) * w]);
+		}
+	}
+
+	std::vector<uint64> any(w), all(w), valid(w);
+
+	for (int lod = 0; lod < lod_num; lod++) {
+		const int s = 1 << lod;
+		const int e = n - 1 - s; // last cell origin
+
+		if (e < 0) {
+			break;
+		}
+
+		std::fill(valid.begin(), valid.end(), 0);
+		for (int z = 0; z <= e; z += s) {
+			valid[z >> 6] |= 1ull << (z & 63);
+		}
+
+		TSubstanceCache& lodCache = substanceCacheLOD[lod];
+
+		for (int x = 0; x <= e; x += s) {
+			for (int y = 0; y <= e; y += s) {
+				const uint64* a = &solid[(x * n + y) * w];
+				const uint64* b = &solid[((x + s) * n + y) * w];
+				const uint64* c = &solid[(x * n + y + s) * w];
+				const uint64* d = &solid[((x + s) * n + y + s) * w];
+
+				for (int i = 0; i < w; i++) {
+					any[i] = a[i] | b[i] | c[i] | d[i];
+					all[i] = a[i] & b[i] & c[i] & d[i];
+				}
+
+				for (int i = 0; i < w; i++) {
+					// bit z of shifted mask is bit z + s
+					const uint64 any_next = shiftRowMask(any.data(), w, i, s);
+					const uint64 all_next = shiftRowMask(all.data(), w, i, s);
+					uint64 m = (any[i] | any_next) & ~(all[i] & all_next) & valid[i];
+
+					while (m) {
+						const int z = (i << 6) + countTrailingZeros(m);
+						m &= m - 1;
+
+						TSubstanceCacheItem* cacheItm = lodCache.emplace();
+						cacheItm->index = clcLinearIndex(x, y, z);
+					}
+				}
+			}
+		}
+	}
+}
+
 void TVoxelData::forEach(std::function<void(int x, int y, int z)> func) {
 	for (int x = 0; x < num(); x++)
 		for (int y = 0; y < num(); y++)
@@ -348,23 +483,46 @@ void TVoxelData::forEach(std::function<void(int x, int y, int z)> func) {
 }
 
 void TVoxelData::forEachWithCache(std::function<void(int x, int y, int z)> func, bool LOD) {
+	forEach(func);
+	compact();
+
 	clearSubstanceCache();
 	initCache();
+	performSubstanceCacheSweep(LOD ? LOD_ARRAY_SIZE : 1);
+}
 
-	for (int x = 0; x < num(); x++) {
-		for (int y = 0; y < num(); y++) {
-			for (int z = 0; z < num(); z++) {
+// func is called only for voxels inside box [lower, upper].
+// substance cache is updated only for cells which contain changed voxels
+void TVoxelData::forEachInBoxWithCache(const TVoxelIndex& lower, const TVoxelIndex& upper, std::function<void(int x, int y, int z)> func, bool LOD) {
+	const bool is_cache_valid = isSubstanceCacheValid();
+	const TVoxelIndex prev_lower = dirty_lower;
+	const TVoxelIndex prev_upper = dirty_upper;
+	resetDirtyRegion();
+
+	for (int x = lower.X; x <= upper.X; x++)
+		for (int y = lower.Y; y <= upper.Y; y++)
+			for (int z = lower.Z; z <= upper.Z; z++)
 				func(x, y, z);
 
-				if (LOD) {
-					performSubstanceCacheLOD(x, y, z);
-				} else {
-					performSubstanceCacheNoLOD(x, y, z);
-				}
+	TVoxelIndex l, u;
+	const bool is_changed = getDirtyRegion(l, u);
+	const int lod_num = LOD ? LOD_ARRAY_SIZE : 1;
 
-			}
-		}
+	if (is_changed) {
+		density_data.compact(l.X, l.Y, l.Z, u.X, u.Y, u.Z);
+		material_data.compact(l.X, l.Y, l.Z, u.X, u.Y, u.Z);
+	}
+
+	if (!is_cache_valid) {
+		clearSubstanceCache();
+		initCache();
+		performSubstanceCacheSweep(lod_num);
+	} else if (is_changed) {
+		updateSubstanceCache(l, u, lod_num);
 	}
+
+	dirty_lower = TVoxelIndex(std::min(prev_lower.X, dirty_lower.X), std::min(prev_lower.Y, dirty_lower.Y), std::min(prev_lower.Z, dirty_lower.Z));
+	dirty_upper = TVoxelIndex(std::max(prev_upper.X, dirty_upper.X), std::max(prev_upper.Y, dirty_upper.Y), std::max(prev_upper.Z, dirty_upper.Z));
 }
 
 void TVoxelData::forEachCacheItem(const int lod, std::function<void(const TSubstanceCacheItem& itm)> func) const{
@@ -388,77 +546,552 @@ void TVoxelData::clcVoxelIndex(uint32 idx, uint32& x, uint32& y, uint32& z) cons
 	z = idx % voxel_num;
 };
 
+// reclassify only cells which contain voxels of box [lower, upper]
+void TVoxelData::updateSubstanceCache(const TVoxelIndex& lower, const TVoxelIndex& upper, int lod_num) {
+	const int n = voxel_num;
+	std::vector<TSubstanceCacheItem> items;
+
+	for (int lod = 0; lod < lod_num; lod++) {
+		const int s = 1 << lod;
+		TVoxelIndex cell_lower, cell_upper;
+		if (!vd::tools::clcCellBox(n, s, lower, upper, cell_lower, cell_upper)) {
+			continue;
+		}
+
+		items.clear();
+		if (density_data.isInitialized()) {
+			for (int x = cell_lower.X; x <= cell_upper.X; x += s) {
+				for (int y = cell_lower.Y; y <= cell_upper.Y; y += s) {
+					for (int z = cell_lower.Z; z <= cell_upper.Z; z += s) {
+						const unsigned long caseCode = getCaseCode(x, y, z, s);
+						if (caseCode != 0x0 && caseCode != 0xff) {
+							TSubstanceCacheItem itm;
+							itm.index = clcLinearIndex(x, y, z);
+							items.push_back(itm);
+						}
+					}
+				}
+			}
+		}
+
+		substanceCacheLOD[lod].replaceBox(n, cell_lower, cell_upper, items);
+	}
+}
+
+FORCEINLINE void TVoxelData::markDirty(int x, int y, int z) {
+	dirty_lower = TVoxelIndex(std::min(dirty_lower.X, x), std::min(dirty_lower.Y, y), std::min(dirty_lower.Z, z));
+	dirty_upper = TVoxelIndex(std::max(dirty_upper.X, x), std::max(dirty_upper.Y, y), std::max(dirty_upper.Z, z));
+	revision++;
+}
+
+void TVoxelData::markDirtyAll() {
+	dirty_lower = TVoxelIndex(0, 0, 0);
+	dirty_upper = TVoxelIndex(voxel_num - 1, voxel_num - 1, voxel_num - 1);
+	revision++;
+}
+
+void TVoxelData::resetDirtyRegion() {
+	dirty_lower = TVoxelIndex(INT_MAX, INT_MAX, INT_MAX);
+	dirty_upper = TVoxelIndex(-1, -1, -1);
+}
+
+bool TVoxelData::getDirtyRegion(TVoxelIndex& lower, TVoxelIndex& upper) const {
+	lower = dirty_lower;
+	upper = dirty_upper;
+	return dirty_lower.X <= dirty_upper.X;
+}
+
+uint64 TVoxelData::getRevision() const {
+	return revision;
+}
+
 void TVoxelData::makeSubstanceCache() {
 	clearSubstanceCache();
 	initCache();
-	
-	for (int x = 0u; x < num(); x++) {
-		for (int y = 0u; y < num(); y++) {
-			for (int z = 0u; z < num(); z++) {
-				performSubstanceCacheLOD(x, y, z);
+	performSubstanceCacheSweep(LOD_ARRAY_SIZE);
+}
+
+#define DATA_END_MARKER 0x000A2D77
+
+// shorter runs of same value are stored as part of literal run
+#define VD_RLE_MIN_RUN 4
+
+static void writeVarint(std::vector<uint8>& out, uint32 v) {
+	while (v >= 0x80) {
+		out.push_back((uint8)(v | 0x80));
+		v >>= 7;
+	}
+
+	out.push_back((uint8)v);
+}
+
+// decoders below read [p, end) only and return false on broken data
+static bool readVarint(const uint8*& p, const uint8* end, uint32& v) {
+	v = 0;
+	for (int shift = 0; shift < 35 && p < end; shift += 7) {
+		const uint8 b = *p++;
+		v |= (uint32)(b & 0x7f) << shift;
+		if (!(b & 0x80)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// z is the fastest axis of linear volume, so runs go along z rows.
+// each run: varint (length << 1 | is_repeat), then one value for repeat run or length values for literal run
+static void encodeRle(const uint8* src, size_t size, std::vector<uint8>& out) {
+	size_t literal_start = 0;
+	auto flushLiteral = [&](size_t end) {
+		if (end > literal_start) {
+			writeVarint(out, (uint32)((end - literal_start) << 1));
+			out.insert(out.end(), src + literal_start, src + end);
+		}
+	};
+
+	size_t i = 0;
+	while (i < size) {
+		size_t j = i + 1;
+		while (j < size && src[j] == src[i]) {
+			j++;
+		}
+
+		if (j - i >= VD_RLE_MIN_RUN) {
+			flushLiteral(i);
+			writeVarint(out, (uint32)(((j - i) << 1) | 1));
+			out.push_back(src[i]);
+			literal_start = j;
+		}
+
+		i = j;
+	}
+
+	flushLiteral(size);
+}
+
+static bool decodeRle(const uint8* p, const uint8* end, uint8* dst, size_t size) {
+	size_t i = 0;
+	while (i < size) {
+		uint32 c;
+		if (!readVarint(p, end, c)) {
+			return false;
+		}
+
+		const size_t len = c >> 1;
+		if (len == 0 || len > size - i) {
+			return false;
+		}
+
+		if (c & 1) {
+			if (p >= end) {
+				return false;
+			}
+
+			memset(dst + i, *p++, len);
+		} else {
+			if ((size_t)(end - p) < len) {
+				return false;
 			}
+
+			memcpy(dst + i, p, len);
+			p += len;
 		}
+
+		i += len;
 	}
+
+	return true;
 }
 
-#define DATA_END_MARKER 0x000A2D77
+// varint palette size, palette, uint8 index bits, indexes packed from low bits
+static void encodePalette(const TMaterialId* src, size_t size, std::vector<uint8>& out) {
+	std::vector<TMaterialId> palette;
+	std::vector<uint32> index_array(size);
+	TFlatMap<TMaterialId, uint32> palette_map;
+
+	TMaterialId last_val = 0;
+	uint32 last_index = 0;
+	for (size_t i = 0; i < size; i++) {
+		const TMaterialId val = src[i];
+		if (palette.empty() || val != last_val) {
+			uint32& index = palette_map.findOrAdd(val);
+			if (palette_map.size() > palette.size()) {
+				index = (uint32)palette.size();
+				palette.push_back(val);
+			}
+
+			last_val = val;
+			last_index = index;
+		}
+
+		index_array[i] = last_index;
+	}
+
+	int bits = 0;
+	while ((1ull << bits) < palette.size()) {
+		bits++;
+	}
+
+	writeVarint(out, (uint32)palette.size());
+	const size_t palette_pos = out.size();
+	out.resize(palette_pos + palette.size() * sizeof(TMaterialId));
+	memcpy(out.data() + palette_pos, palette.data(), palette.size() * sizeof(TMaterialId));
+	out.push_back((uint8)bits);
+
+	if (bits == 0) {
+		return;
+	}
+
+	out.reserve(out.size() + (size * bits + 7) / 8);
+	uint64 acc = 0;
+	int acc_bits = 0;
+	for (size_t i = 0; i < size; i++) {
+		acc |= (uint64)index_array[i] << acc_bits;
+		acc_bits += bits;
+		while (acc_bits >= 8) {
+			out.push_back((uint8)acc);
+			acc >>= 8;
+			acc_bits -= 8;
+		}
+	}
+
+	if (acc_bits > 0) {
+		out.push_back((uint8)acc);
+	}
+}
+
+// material id is 16 bit, so palette can't be bigger
+#define VD_PALETTE_MAX_SIZE	65536
+#define VD_PALETTE_MAX_BITS	16
+
+static bool decodePalette(const uint8* p, const uint8* end, TMaterialId* dst, size_t size) {
+	uint32 palette_size;
+	if (!readVarint(p, end, palette_size) || palette_size == 0 || palette_size > VD_PALETTE_MAX_SIZE) {
+		return false;
+	}
+
+	if ((size_t)(end - p) < palette_size * sizeof(TMaterialId) + 1) {
+		return false;
+	}
+
+	std::vector<TMaterialId> palette(palette_size);
+	memcpy(palette.data(), p, palette_size * sizeof(TMaterialId));
+	p += palette_size * sizeof(TMaterialId);
+
+	const int bits = *p++;
+	if (bits > VD_PALETTE_MAX_BITS) {
+		return false;
+	}
+
+	if (bits == 0) {
+		std::fill(dst, dst + size, palette[0]);
+		return true;
+	}
+
+	if ((size_t)(end - p) < (size * bits + 7) / 8) {
+		return false;
+	}
+
+	const uint64 mask = (1ull << bits) - 1;
+	uint64 acc = 0;
+	int acc_bits = 0;
+	for (size_t i = 0; i < size; i++) {
+		while (acc_bits < bits) {
+			acc |= (uint64)(*p++) << acc_bits;
+			acc_bits += 8;
+		}
+
+		const uint32 index = (uint32)(acc & mask);
+		if (index >= palette_size) {
+			return false;
+		}
+
+		dst[i] = palette[index];
+		acc >>= bits;
+		acc_bits -= bits;
+	}
+
+	return true;
+}
 
 bool deserializeVoxelData(TVoxelData* vd, std::vector<uint8>& data) {
-	usbt::TFastUnsafeDeserializer deserializer(data.data());
+	return deserializeVoxelData(vd, data.data(), data.size());
+}
+
+// zone resolution is 2^(LOD count - 1) + 1, header with bigger one is broken
+#define VD_MAX_VOXEL_NUM 257
+
+// volumes are copied to bricks directly from data, without intermediate buffers.
+// every read is checked against size, false and nothing changed in vd if data is broken
+bool deserializeVoxelData(TVoxelData* vd, const uint8* data, size_t size) {
+	const uint8* end = data + size;
+	usbt::TFastUnsafeDeserializer deserializer(data);
+	auto available = [&]() -> size_t { return end - deserializer.current(); };
 
 	TVoxelDataHeader header;
+	if (size < sizeof(TVoxelDataHeader) + sizeof(uint32)) {
+		return false;
+	}
+
 	deserializer >> header;
+	if (header.voxel_num == 0 || header.voxel_num > VD_MAX_VOXEL_NUM) {
+		return false;
+	}
+
+	const size_t s = header.voxel_num * header.voxel_num * header.voxel_num;
+
+	// encoded volume: byte length, then data
+	auto readEncoded = [&](const uint8*& encoded, const uint8*& encoded_end) -> bool {
+		uint32 len;
+		if (available() < sizeof(uint32)) {
+			return false;
+		}
+
+		deserializer >> len;
+		if (available() < len) {
+			return false;
+		}
+
+		encoded = deserializer.current();
+		encoded_end = encoded + len;
+		deserializer.skip(len);
+		return true;
+	};
+
+	const uint8* density_raw = nullptr;
+	std::vector<TDensityVal> density_buffer;
+	if (header.density_state == TVoxelDataFillState::MIXED) {
+		if (available() < s * sizeof(TDensityVal)) {
+			return false;
+		}
+
+		density_raw = deserializer.current();
+		deserializer.skip(s * sizeof(TDensityVal));
+	} else if (header.density_state == VD_VOLUME_DENSITY_RLE) {
+		const uint8* encoded;
+		const uint8* encoded_end;
+		density_buffer.resize(s);
+		if (!readEncoded(encoded, encoded_end) || !decodeRle(encoded, encoded_end, density_buffer.data(), s)) {
+			return false;
+		}
+
+		density_raw = density_buffer.data();
+	} else if (header.density_state != TVoxelDataFillState::ZERO && header.density_state != TVoxelDataFillState::FULL) {
+		return false;
+	}
+
+	const uint8* material_raw = nullptr;
+	std::vector<TMaterialId> material_buffer;
+	if (header.material_state == TVoxelDataFillState::MIXED) {
+		if (available() < s * sizeof(TMaterialId)) {
+			return false;
+		}
+
+		material_raw = deserializer.current();
+		deserializer.skip(s * sizeof(TMaterialId));
+	} else if (header.material_state == VD_VOLUME_MATERIAL_PALETTE) {
+		const uint8* encoded;
+		const uint8* encoded_end;
+		material_buffer.resize(s);
+		if (!readEncoded(encoded, encoded_end) || !decodePalette(encoded, encoded_end, material_buffer.data(), s)) {
+			return false;
+		}
+
+		material_raw = (const uint8*)material_buffer.data();
+	} else if (header.material_state != TVoxelDataFillState::ZERO && header.material_state != TVoxelDataFillState::FULL) {
+		return false;
+	}
+
+	uint32 end_marker;
+	if (available() < sizeof(uint32)) {
+		return false;
+	}
+
+	deserializer.readObj(end_marker);
+	if (end_marker != DATA_END_MARKER) {
+		return false;
+	}
 
 	vd->voxel_num = header.voxel_num;
 	vd->volume_size = header.volume_size;
 	vd->base_fill_mat = header.base_fill_mat;
 
-	const size_t s = header.voxel_num * header.voxel_num * header.voxel_num;
-	if (header.density_state == TVoxelDataFillState::MIXED) {
-		vd->density_data = new TDensityVal[s];
-		deserializer.read(vd->density_data, s);
+	if (density_raw) {
+		vd->density_data.copyFrom(header.voxel_num, density_raw);
 		vd->density_state = TVoxelDataFillState::MIXED;
 	} else {
 		vd->deinitializeDensity(static_cast<TVoxelDataFillState>(header.density_state));
 	}
 
-	if (header.material_state == TVoxelDataFillState::MIXED) {
-		vd->material_data = new TMaterialId[s];
-		deserializer.read(vd->material_data, s);
+	if (material_raw) {
+		vd->material_data.copyFrom(header.voxel_num, material_raw);
 	} else {
 		vd->deinitializeMaterial(header.base_fill_mat);
 	}
 
-	uint32 end_marker;
-	deserializer.readObj(end_marker);
-	return (end_marker == DATA_END_MARKER);
+	vd->markDirtyAll();
+	return true;
 }
 
 std::shared_ptr<std::vector<uint8>> TVoxelData::serialize() {
 	usbt::TFastUnsafeSerializer serializer;
 	const size_t s = num() * num() * num();
-	const TVoxelDataFillState material_volume_state = (material_data) ? TVoxelDataFillState::MIXED : TVoxelDataFillState::ZERO;
+	const TVoxelDataFillState material_volume_state = (material_data.isInitialized()) ? TVoxelDataFillState::MIXED : TVoxelDataFillState::ZERO;
 
 	TVoxelDataHeader header;
 	header.voxel_num = num();
 	header.volume_size = size();
-	header.density_state = getDensityFillState();
-	header.material_state = material_volume_state;
+	header.density_state = (getDensityFillState() == TVoxelDataFillState::MIXED) ? VD_VOLUME_DENSITY_RLE : getDensityFillState();
+	header.material_state = (material_volume_state == TVoxelDataFillState::MIXED) ? VD_VOLUME_MATERIAL_PALETTE : material_volume_state;
 	header.base_fill_mat = base_fill_mat;
 	serializer << header;
 
-	if (getDensityFillState() == TVoxelDataFillState::MIXED) {
-		serializer.write(density_data, s);
+	// encoded volume: byte length, then data
+	std::vector<uint8> encoded;
+
+	if (header.density_state == VD_VOLUME_DENSITY_RLE) {
+		std::vector<TDensityVal> buffer(s);
+		density_data.copyTo(buffer.data());
+		encodeRle(buffer.data(), s, encoded);
+		serializer << (uint32)encoded.size();
+		serializer.write(encoded.data(), encoded.size());
 	}
 
-	if (material_volume_state == TVoxelDataFillState::MIXED) {
-		serializer.write(material_data, s);
+	if (header.material_state == VD_VOLUME_MATERIAL_PALETTE) {
+		std::vector<TMaterialId> buffer(s);
+		material_data.copyTo(buffer.data());
+		encoded.clear();
+		encodePalette(buffer.data(), s, encoded);
+		serializer << (uint32)encoded.size();
+		serializer.write(encoded.data(), encoded.size());
 	}
 
 	serializer << (uint32)DATA_END_MARKER;
 	return serializer.data();
 }
 
+#define REGION_END_MARKER 0x000A2D78
+
+std::shared_ptr<std::vector<uint8>> TVoxelData::serializeRegion(const TVoxelIndex& l, const TVoxelIndex& u) const {
+	usbt::TFastUnsafeSerializer serializer;
+	const int sx = u.X - l.X + 1;
+	const int sy = u.Y - l.Y + 1;
+	const int sz = u.Z - l.Z + 1;
+	const size_t s = (size_t)sx * sy * sz;
+	serializer << (int32)voxel_num << l.X << l.Y << l.Z << u.X << u.Y << u.Z;
+
+	// raw values, material 0 means base_fill_mat as in volume
+	std::vector<TDensityVal> density_buffer(s, (density_state == TVoxelDataFillState::FULL) ? 0xff : 0x00);
+	std::vector<TMaterialId> material_buffer(s, base_fill_mat);
+	for (int x = 0; x < sx; x++) {
+		for (int y = 0; y < sy; y++) {
+			const size_t i = ((size_t)x * sy + y) * sz;
+			for (int z = 0; z < sz; z++) {
+				if (density_data.isInitialized()) {
+					density_buffer[i + z] = density_data.get(l.X + x, l.Y + y, l.Z + z);
+				}
+
+				if (material_data.isInitialized()) {
+					material_buffer[i + z] = material_data.get(l.X + x, l.Y + y, l.Z + z);
+				}
+			}
+		}
+	}
+
+	std::vector<uint8> encoded;
+	encodeRle(density_buffer.data(), s, encoded);
+	serializer << (uint32)encoded.size();
+	serializer.write(encoded.data(), encoded.size());
+
+	encoded.clear();
+	encodePalette(material_buffer.data(), s, encoded);
+	serializer << (uint32)encoded.size();
+	serializer.write(encoded.data(), encoded.size());
+
+	serializer << (uint32)REGION_END_MARKER;
+	return serializer.data();
+}
+
+bool deserializeVoxelDataRegion(TVoxelData* vd, const uint8* data, size_t size, bool enableLOD) {
+	static const size_t header_size = sizeof(int32) * 7;
+	if (size < header_size + sizeof(uint32) * 3) {
+		return false;
+	}
+
+	usbt::TFastUnsafeDeserializer deserializer(data);
+	int32 n;
+	TVoxelIndex l, u;
+	deserializer >> n >> l.X >> l.Y >> l.Z >> u.X >> u.Y >> u.Z;
+
+	if (n != vd->voxel_num || l.X < 0 || l.Y < 0 || l.Z < 0 || u.X >= n || u.Y >= n || u.Z >= n || l.X > u.X || l.Y > u.Y || l.Z > u.Z) {
+		return false;
+	}
+
+	const int sx = u.X - l.X + 1;
+	const int sy = u.Y - l.Y + 1;
+	const int sz = u.Z - l.Z + 1;
+	const size_t s = (size_t)sx * sy * sz;
+
+	const uint8* end = data + size;
+	auto available = [&]() -> size_t { return end - deserializer.current(); };
+
+	uint32 len;
+	deserializer >> len;
+	std::vector<TDensityVal> density_buffer(s);
+	if (available() < len + sizeof(uint32) || !decodeRle(deserializer.current(), deserializer.current() + len, density_buffer.data(), s)) {
+		return false;
+	}
+
+	deserializer.skip(len);
+
+	deserializer >> len;
+	std::vector<TMaterialId> material_buffer(s);
+	if (available() < len + sizeof(uint32) || !decodePalette(deserializer.current(), deserializer.current() + len, material_buffer.data(), s)) {
+		return false;
+	}
+
+	deserializer.skip(len);
+
+	uint32 end_marker;
+	deserializer.readObj(end_marker);
+	if (end_marker != REGION_END_MARKER) {
+		return false;
+	}
+
+	// uniform volume stays uninitialized if region doesn't change it
+	const TDensityVal uniform_density = (vd->density_state == TVoxelDataFillState::FULL) ? 0xff : 0x00;
+	const bool is_density_uniform = std::all_of(density_buffer.begin(), density_buffer.end(), [=](TDensityVal v) { return v == uniform_density; });
+	const bool is_material_uniform = std::all_of(material_buffer.begin(), material_buffer.end(), [=](TMaterialId v) { return v == vd->base_fill_mat; });
+
+	if (!vd->density_data.isInitialized() && !is_density_uniform) {
+		vd->initializeDensity();
+		vd->density_state = TVoxelDataFillState::MIXED;
+	}
+
+	if (!vd->material_data.isInitialized() && !is_material_uniform) {
+		vd->initializeMaterial();
+	}
+
+	vd->forEachInBoxWithCache(l, u, [&](int x, int y, int z) {
+		const size_t i = ((size_t)(x - l.X) * sy + (y - l.Y)) * sz + (z - l.Z);
+		bool is_changed = false;
+		if (vd->density_data.isInitialized()) {
+			is_changed |= vd->density_data.set(x, y, z, density_buffer[i]);
+		}
+
+		if (vd->material_data.isInitialized()) {
+			is_changed |= vd->material_data.set(x, y, z, material_buffer[i]);
+		}
+
+		if (is_changed) {
+			vd->markDirty(x, y, z);
+		}
+	}, enableLOD);
+
+	return true;
+}
+
 TMaterialId TVoxelData::getBaseMatId() {
 	return base_fill_mat;
 }
@@ -491,7 +1124,7 @@ TSubstanceCache::TSubstanceCache() {
 
 TSubstanceCacheItem* TSubstanceCache::emplace() {
 	auto s = cellArray.size();
-	if (s == idx) {
+	if (s == (size_t)idx) {
 		cellArray.resize(s + s / 2 + 1);
 	}
 
@@ -522,10 +1155,37 @@ void TSubstanceCache::forEach(std::function<void(const TSubstanceCacheItem& itm)
 
 void TSubstanceCache::copy(const int* cache_data, const int len) {
 	cellArray.resize(len);
-	memcpy(cellArray.data(), cache_data, len * sizeof(TSubstanceCacheItem));
+	memcpy((void*)cellArray.data(), cache_data, len * sizeof(TSubstanceCacheItem));
 	idx = len;
 }
 
+void TSubstanceCache::replaceBox(int n, const TVoxelIndex& lower, const TVoxelIndex& upper, const std::vector<TSubstanceCacheItem>& items) {
+	std::vector<TSubstanceCacheItem> res;
+	res.reserve(idx + items.size());
+
+	auto it = items.begin();
+	for (int i = 0; i < idx; i++) {
+		const TSubstanceCacheItem& itm = cellArray[i];
+		const int x = itm.index / (n * n);
+		const int y = (itm.index / n) % n;
+		const int z = itm.index % n;
+
+		if (x >= lower.X && x <= upper.X && y >= lower.Y && y <= upper.Y && z >= lower.Z && z <= upper.Z) {
+			continue;
+		}
+
+		while (it != items.end() && it->index < itm.index) {
+			res.push_back(*it++);
+		}
+
+		res.push_back(itm);
+	}
+
+	res.insert(res.end(), it, items.end());
+	cellArray.swap(res);
+	idx = (int32)cellArray.size();
+}
+
 int32 TSubstanceCache::size() const {
 	return idx;
 }
@@ -543,9 +1203,10 @@ void vd::tools::unsafe::forceAddToCache(TVoxelData* vd, int x, int y, int z, int
 }
 
 void vd::tools::unsafe::setDensity(TVoxelData* vd, const TVoxelIndex& vi, float density) {
-	const int index = vd::tools::clcLinearIndex(vd->num(), vi);
 	vd->density_state = TVoxelDataFillState::MIXED;
-	vd->density_data[index] = vd->clcFloatToByte(density);
+	if (vd->density_data.set(vi.X, vi.Y, vi.Z, vd->clcFloatToByte(density))) {
+		vd->markDirty(vi.X, vi.Y, vi.Z);
+	}
 }
 
 void vd::tools::makeIndexes(TVoxelIndex(&d)[8], int x, int y, int z, int step) {
@@ -588,6 +1249,27 @@ int vd::tools::clcLinearIndex(int n, const TVoxelIndex& vi) {
 };
 
 
+// origins of LOD cells (step aligned) which contain at least one voxel of box [lower, upper]
+bool vd::tools::clcCellBox(int n, int step, const TVoxelIndex& lower, const TVoxelIndex& upper, TVoxelIndex& cell_lower, TVoxelIndex& cell_upper) {
+	const int e = n - 1 - step; // last cell origin
+	if (e < 0) {
+		return false;
+	}
+
+	auto clcLower = [=](int v) {
+		return (std::max(0, v - step) + step - 1) / step * step;
+	};
+
+	auto clcUpper = [=](int v) {
+		return std::min(v, e) / step * step;
+	};
+
+	cell_lower = TVoxelIndex(clcLower(lower.X), clcLower(lower.Y), clcLower(lower.Z));
+	cell_upper = TVoxelIndex(clcUpper(upper.X), clcUpper(upper.Y), clcUpper(upper.Z));
+
+	return cell_lower.X <= cell_upper.X && cell_lower.Y <= cell_upper.Y && cell_lower.Z <= cell_upper.Z;
+}
+
 int vd::tools::memory::getVdCount() {
 	return vd_counter;
 };
@@ -160,17 +160,17 @@ public:
 	}
 
 	FORCEINLINE void CopySection(FProcMeshSection& SrcSection, FProcMeshProxySection* NewSection) {
-		if (SrcSection.ProcIndexBuffer.Num() > 0 && SrcSection.ProcVertexBuffer.Num() > 0) {
+		if (SrcSection.ProcIndexBuffer.Num() > 0 && SrcSection.GetVertexNum() > 0) {
 
 			// Copy data from vertex buffer
-			const int32 NumVerts = SrcSection.ProcVertexBuffer.Num();
+			const int32 NumVerts = SrcSection.GetVertexNum();
 
 			// Allocate verts
 			TArray<FDynamicMeshVertex> Vertices;
 			Vertices.SetNumUninitialized(NumVerts);
 			// Copy verts
 			for (int VertIdx = 0; VertIdx < NumVerts; VertIdx++) {
-				const TMeshVertex& ProcVert = SrcSection.ProcVertexBuffer[VertIdx];
+				const TMeshVertex& ProcVert = SrcSection.GetVertex(VertIdx);
 				FDynamicMeshVertex& Vert = Vertices[VertIdx];
 				ConvertProcMeshToDynMeshVertex(Vert, ProcVert);
 			}
@@ -308,6 +308,14 @@ private:
 
 	ASandboxTerrainController* Controller;
 
+	TVoxelIndex ZoneIndex;
+
+	/** Extracted LODs. Missed LOD is drawn with nearest extracted one until controller extracts it */
+	uint32 LodMask = USBT_LOD_MASK_ALL;
+
+	/** Missed LODs which are already requested */
+	mutable std::atomic<uint32> RequestedLodMask{ 0 };
+
 public:
 
 	FVoxelMeshSceneProxy(UVoxelMeshComponent* Component) : FAbstractMeshSceneProxy(Component) {
@@ -315,6 +323,8 @@ public:
 		Controller = Cast<ASandboxTerrainController>(Component->GetAttachmentRootActor());
 		if (Controller) {
 			CullDistance = Controller->ActiveAreaSize * 1.5 * USBT_ZONE_SIZE;
+			ZoneIndex = Controller->GetZoneIndex(ZoneOrigin);
+			LodMask = Component->LodMask;
 			CopyAll(Component);
 		}
 	}
@@ -442,6 +452,28 @@ public:
 		return I;
 	}
 
+	// more detailed LOD first
+	int32 GetNearestLodIndex(int32 LodIndex) const {
+		for (int32 D = 0; D < LOD_ARRAY_SIZE; D++) {
+			if (LodIndex - D >= 0 && ((LodMask >> (LodIndex - D)) & 1)) {
+				return LodIndex - D;
+			}
+
+			if (LodIndex + D < LOD_ARRAY_SIZE && ((LodMask >> (LodIndex + D)) & 1)) {
+				return LodIndex + D;
+			}
+		}
+
+		return LodIndex;
+	}
+
+	void RequestMissedLod(int32 LodIndex) const {
+		const uint32 Bit = 1u << LodIndex;
+		if ((LodMask & Bit) == 0 && (RequestedLodMask.fetch_or(Bit) & Bit) == 0) {
+			Controller->RequestZoneLod(ZoneIndex, LodIndex);
+		}
+	}
+
 	//================================================================================================
 	// Draw main zone as static mesh
 	//================================================================================================
@@ -449,7 +481,7 @@ public:
 	virtual void DrawStaticElements(FStaticPrimitiveDrawInterface* PDI) {
 		if (LodSectionArray.Num() > 0) {
 			for (int LODIndex = 0; LODIndex < LodSectionArray.Num(); LODIndex++) {
-				const FMeshProxyLodSection* LodSection = LodSectionArray[LODIndex];
+				const FMeshProxyLodSection* LodSection = LodSectionArray[GetNearestLodIndex(LODIndex)];
 				if (LodSection != nullptr) {
 					for (FProcMeshProxySection* MatSection : LodSection->MaterialMeshPtrArray) {
 						if (MatSection != nullptr) {
@@ -477,14 +509,18 @@ public:
 				const FSceneView* View = Views[ViewIndex];
 				const FBoxSphereBounds& ProxyBounds = GetBounds();
 				int32 LodIndex = ComputeLodIndexByScreenSize(View, ProxyBounds.Origin);
+				if (Controller) {
+					RequestMissedLod(LodIndex);
+				}
 
-				if (LodIndex > 0) {
+				const int32 DrawLodIndex = GetNearestLodIndex(LodIndex);
+				if (DrawLodIndex > 0) {
 					// draw transition patches
 					for (auto i = 0; i < 6; i++) {
 						const FVector  NeighborZoneOrigin = ZoneOrigin + NDir[i];
 						const auto NeighborLodIndex = ComputeLodIndexByScreenSize(View, NeighborZoneOrigin);
-						if (NeighborLodIndex < LodIndex) {
-							FMeshProxyLodSection* LodSectionProxy = LodSectionArray[LodIndex];
+						if (NeighborLodIndex < DrawLodIndex) {
+							FMeshProxyLodSection* LodSectionProxy = LodSectionArray[DrawLodIndex];
 							if (LodSectionProxy != nullptr) {
 								for (FProcMeshProxySection* MatSection : LodSectionProxy->NormalPatchPtrArray[i]) {
 									if (MatSection != nullptr && MatSection->Material != nullptr) {
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "VoxelIndex.h"
+#include "FlatMap.h"
+#include <map>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+typedef std::shared_ptr<std::vector<uint8_t>> TZoneDeltaDataPtr;
+
+// Per zone history of edits made on server, used to send client only changed voxels instead of whole zone.
+// Each zone VStamp has own entry: serialized changed region (TVoxelData::serializeRegion) or nullptr
+// if voxels are not changed. Oldest entries are dropped when log is over size limit.
+class TZoneDeltaLog {
+
+private:
+
+	struct TZoneLog {
+		std::map<uint32_t, TZoneDeltaDataPtr> entry_map;
+		size_t data_size = 0;
+
+		// zone VStamp at the time of last instanced objects change
+		uint32_t objects_vstamp = 0;
+		bool bObjectsChanged = false;
+	};
+
+	std::mutex mutex;
+	TFlatMap<TVoxelIndex, TZoneLog> zone_map;
+
+	// insertion order of entries for eviction
+	std::deque<std::pair<TVoxelIndex, uint32_t>> order;
+
+	size_t total_size = 0;
+	size_t max_total_size;
+	size_t max_zone_size;
+
+	static constexpr size_t ENTRY_OVERHEAD = 64;
+
+	static size_t clcEntrySize(const TZoneDeltaDataPtr& data) {
+		return ENTRY_OVERHEAD + (data ? data->size() : 0);
+	}
+
+	void eraseEntry(const TVoxelIndex& zone_index, uint32_t vstamp) {
+		TZoneLog* log = zone_map.find(zone_index);
+		if (!log) {
+			return;
+		}
+
+		auto it = log->entry_map.find(vstamp);
+		if (it != log->entry_map.end()) {
+			const size_t s = clcEntrySize(it->second);
+			log->data_size -= s;
+			total_size -= s;
+			log->entry_map.erase(it);
+		}
+
+		if (log->entry_map.empty() && !log->bObjectsChanged) {
+			zone_map.erase(zone_index);
+		}
+	}
+
+	// order also keeps stale items of entries trimmed by zone limit, so its length is limited too
+	void evict() {
+		while ((total_size > max_total_size || order.size() > max_total_size / ENTRY_OVERHEAD) && !order.empty()) {
+			const auto front = order.front();
+			order.pop_front();
+			eraseEntry(front.first, front.second);
+		}
+	}
+
+public:
+
+	TZoneDeltaLog(size_t total_size_limit, size_t zone_size_limit) : max_total_size(total_size_limit), max_zone_size(zone_size_limit) {
+
+	}
+
+	// data is region changed by edit which made vstamp, nullptr if voxels are not changed
+	void add(const TVoxelIndex& zone_index, uint32_t vstamp, TZoneDeltaDataPtr data) {
+		const std::lock_guard<std::mutex> lock(mutex);
+		TZoneLog& log = zone_map.findOrAdd(zone_index);
+
+		auto it = log.entry_map.find(vstamp);
+		if (it != log.entry_map.end()) {
+			const size_t s = clcEntrySize(it->second);
+			log.data_size -= s;
+			total_size -= s;
+			log.entry_map.erase(it);
+		}
+
+		const size_t s = clcEntrySize(data);
+		log.entry_map.emplace(vstamp, std::move(data));
+		log.data_size += s;
+		total_size += s;
+		order.emplace_back(zone_index, vstamp);
+
+		// zone history is useless if it is larger than zone itself
+		while (log.data_size > max_zone_size && log.entry_map.size() > 1) {
+			auto first = log.entry_map.begin();
+			const size_t fs = clcEntrySize(first->second);
+			log.data_size -= fs;
+			total_size -= fs;
+			log.entry_map.erase(first);
+		}
+
+		evict();
+	}
+
+	// objects are changed while zone has vstamp
+	void markObjectsChanged(const TVoxelIndex& zone_index, uint32_t vstamp) {
+		const std::lock_guard<std::mutex> lock(mutex);
+		TZoneLog& log = zone_map.findOrAdd(zone_index);
+		log.objects_vstamp = log.bObjectsChanged ? std::max(log.objects_vstamp, vstamp) : vstamp;
+		log.bObjectsChanged = true;
+	}
+
+	// regions of edits from_vstamp + 1 .. to_vstamp in order.
+	// false if history is incomplete or larger than max_size, whole zone should be sent then
+	bool get(const TVoxelIndex& zone_index, uint32_t from_vstamp, uint32_t to_vstamp, size_t max_size, std::vector<TZoneDeltaDataPtr>& out, bool& bObjectsChanged) {
+		out.clear();
+		bObjectsChanged = false;
+
+		if (to_vstamp < from_vstamp) {
+			return false;
+		}
+
+		const std::lock_guard<std::mutex> lock(mutex);
+		const TZoneLog* log = zone_map.find(zone_index);
+
+		if (to_vstamp == from_vstamp) {
+			bObjectsChanged = log && log->bObjectsChanged && log->objects_vstamp >= from_vstamp;
+			return true;
+		}
+
+		if (!log) {
+			return false;
+		}
+
+		size_t size = 0;
+		uint32_t expected = from_vstamp + 1;
+		for (auto it = log->entry_map.find(expected); it != log->entry_map.end() && it->first <= to_vstamp; ++it) {
+			if (it->first != expected) {
+				return false;
+			}
+
+			if (it->second) {
+				size += it->second->size();
+				if (size > max_size) {
+					return false;
+				}
+
+				out.push_back(it->second);
+			}
+
+			expected++;
+		}
+
+		if (expected != to_vstamp + 1) {
+			return false;
+		}
+
+		bObjectsChanged = log->bObjectsChanged && log->objects_vstamp >= from_vstamp;
+		return true;
+	}
+
+	size_t size() {
+		const std::lock_guard<std::mutex> lock(mutex);
+		return total_size;
+	}
+
+	void clear() {
+		const std::lock_guard<std::mutex> lock(mutex);
+		zone_map.clear();
+		order.clear();
+		total_size = 0;
+	}
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "VoxelIndex.h"
+#include "FlatMap.h"
+#include <list>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+typedef std::shared_ptr<std::vector<uint8_t>> TZonePayloadPtr;
+
+// Encoded zone data ready to send to clients, least recently used items are evicted when cache is over size limit.
+// Item is valid only for zone VStamp it was made for. Objects change without VStamp bump, so invalidate also
+// increments zone generation: item made from data read before invalidate is rejected by put.
+class TZonePayloadCache {
+
+private:
+
+	struct TItem {
+		TVoxelIndex zone_index;
+		uint32_t vstamp;
+		TZonePayloadPtr payload;
+	};
+
+	std::mutex mutex;
+	std::list<TItem> item_list;
+	TFlatMap<TVoxelIndex, std::list<TItem>::iterator> item_map;
+
+	// only invalidated zones have entry, others are generation 0
+	TFlatMap<TVoxelIndex, uint64_t> generation_map;
+
+	size_t total_size = 0;
+	size_t max_size;
+
+	uint64_t hit_count = 0;
+	uint64_t miss_count = 0;
+
+	void eraseItem(std::list<TItem>::iterator it) {
+		total_size -= it->payload->size();
+		item_map.erase(it->zone_index);
+		item_list.erase(it);
+	}
+
+public:
+
+	TZonePayloadCache(size_t size_limit) : max_size(size_limit) {
+
+	}
+
+	TZonePayloadPtr find(const TVoxelIndex& zone_index, uint32_t vstamp) {
+		const std::lock_guard<std::mutex> lock(mutex);
+		auto* it = item_map.find(zone_index);
+		if (!it || (*it)->vstamp != vstamp) {
+			miss_count++;
+			return nullptr;
+		}
+
+		hit_count++;
+		item_list.splice(item_list.begin(), item_list, *it);
+		return (*it)->payload;
+	}
+
+	// read before zone data is encoded, then pass to put
+	uint64_t generation(const TVoxelIndex& zone_index) {
+		const std::lock_guard<std::mutex> lock(mutex);
+		const uint64_t* gen = generation_map.find(zone_index);
+		return gen ? *gen : 0;
+	}
+
+	void put(const TVoxelIndex& zone_index, uint32_t vstamp, uint64_t gen, TZonePayloadPtr payload) {
+		if (!payload || payload->size() > max_size) {
+			return;
+		}
+
+		const std::lock_guard<std::mutex> lock(mutex);
+		const uint64_t* current_gen = generation_map.find(zone_index);
+		if ((current_gen ? *current_gen : 0) != gen) {
+			return;
+		}
+
+		auto* it = item_map.find(zone_index);
+		if (it) {
+			eraseItem(*it);
+		}
+
+		total_size += payload->size();
+		item_list.push_front(TItem{ zone_index, vstamp, std::move(payload) });
+		item_map.insert(zone_index, item_list.begin());
+
+		while (total_size > max_size) {
+			eraseItem(std::prev(item_list.end()));
+		}
+	}
+
+	void invalidate(const TVoxelIndex& zone_index) {
+		const std::lock_guard<std::mutex> lock(mutex);
+		generation_map.findOrAdd(zone_index)++;
+		auto* it = item_map.find(zone_index);
+		if (it) {
+			eraseItem(*it);
+		}
+	}
+
+	void clear() {
+		const std::lock_guard<std::mutex> lock(mutex);
+		item_map.clear();
+		item_list.clear();
+		total_size = 0;
+	}
+
+	size_t size() {
+		const std::lock_guard<std::mutex> lock(mutex);
+		return total_size;
+	}
+
+	double hitRate() {
+		const std::lock_guard<std::mutex> lock(mutex);
+		const uint64_t total = hit_count + miss_count;
+		return (total > 0) ? (double)hit_count / total : 0;
+	}
+};
@@ -8,7 +8,6 @@
 
 // memory statistics
 
-std::atomic<int> md_counter{ 0 };
 std::atomic<int> cd_counter{ 0 };
 std::atomic<int> zone_counter{ 0 };
 
@@ -345,17 +345,12 @@ TChunkDataPtr UTerrainGeneratorComponent::GetChunkData(int X, int Y) {
     TVoxelIndex Index(X, Y, 0);
     TChunkDataPtr ChunkData = nullptr;
 
-    if (ChunkDataCollection.find(Index) == ChunkDataCollection.end()) {
+    const TChunkDataPtr* Ptr = ChunkDataCollection.find(Index);
+    if (Ptr == nullptr) {
         ChunkData = GenerateChunkData(Index);
-
-#ifdef __cpp_lib_atomic_shared_ptr                      
-        ChunkDataCollection[Index] = ChunkData; // TODO linux
-#else
-        auto& Ptr = ChunkDataCollection[Index];
-        std::atomic_store(&Ptr, ChunkData);
-#endif
+        ChunkDataCollection.insert(Index, ChunkData);
     } else {
-        ChunkData = ChunkDataCollection[Index];
+        ChunkData = *Ptr;
     }
 
     return ChunkData;
@@ -524,6 +519,7 @@ void UTerrainGeneratorComponent::GenerateLandscapeZoneSlight(const TGenerateVdTe
     };
 
     Octree.Start();
+    VoxelData->compact();
     VoxelData->setCacheToValid();
 
     const int LOD = Itm.GenerationLOD;
@@ -683,6 +679,7 @@ void UTerrainGeneratorComponent::GenerateZoneVolumeWithFunction(const TGenerateV
         VoxelData->setBaseMatId(BaseMaterialId);
     }
 
+    VoxelData->compact();
     VoxelData->setCacheToValid();
 }
 
@@ -759,6 +756,7 @@ void UTerrainGeneratorComponent::GenerateZoneVolume(const TGenerateVdTempItm& It
         VoxelData->deinitializeMaterial(BaseMaterialId);
     }
 
+    VoxelData->compact();
     VoxelData->setCacheToValid();
 }
 
@@ -987,12 +985,12 @@ void UTerrainGeneratorComponent::OnBatchGenerationFinished() {
 
 void UTerrainGeneratorComponent::Clean() {
     const std::lock_guard<std::mutex> lock(ChunkDataMapMutex);
-    //TODO linux ChunkDataCollection.clear(); 
+    ChunkDataCollection.clear();
 }
 
 void UTerrainGeneratorComponent::Clean(const TVoxelIndex& Index) {
     const std::lock_guard<std::mutex> lock(ChunkDataMapMutex);
-    //TOOD linux ChunkDataCollection.erase(Index);
+    ChunkDataCollection.erase(Index);
 }
 
 //======================================================================================================================================================================
@@ -4,22 +4,54 @@
 #include "TerrainZoneComponent.h"
 #include "Core/TerrainData.hpp"
 #include "TerrainClientComponent.h"
+#include "Async/Async.h"
 
 
 bool IsGameShutdown();
 
 void AppendDataToBuffer(TDataPtr Data, FBufferArchive& Buffer) {
-	for (int I = 0; I < Data->size(); I++) {
-		uint8 Byte = Data->at(I);
-		Buffer << Byte;
+	Buffer.Append(Data->data(), Data->size());
+}
+
+// objects of zone which is loaded to memory
+TDataPtr SerializeZoneObjects(TVoxelDataInfoPtr VdInfoPtr) {
+	UTerrainZoneComponent* Zone = VdInfoPtr->GetZone();
+	if (Zone) {
+		return Zone->SerializeAndResetObjectData();
+	}
+
+	auto InstanceObjectMapPtr = VdInfoPtr->GetOrCreateInstanceObjectMap();
+	if (InstanceObjectMapPtr) {
+		return UTerrainZoneComponent::SerializeInstancedMesh(*InstanceObjectMapPtr);
 	}
+
+	return nullptr;
 }
 
 void ASandboxTerrainController::NetworkSerializeZone(FBufferArchive& Buffer, const TVoxelIndex& Index) {
+	// stored zone is encoded once and sent to all clients until it is changed, without zone lock
+	TDataPtr CachedPayload = TerrainData->FindZonePayload(Index, TerrainData->GetZoneVStamp(Index).VStamp);
+	if (CachedPayload) {
+		AppendDataToBuffer(CachedPayload, Buffer);
+		return;
+	}
+
 	TVoxelDataInfoPtr VdInfoPtr = TerrainData->GetVoxelDataInfo(Index);
 	// TODO: shared lock Vd
 	VdInfoPtr->Lock();
 
+	// other server worker could make it while this one was waiting for lock
+	CachedPayload = TerrainData->FindZonePayload(Index, TerrainData->GetZoneVStamp(Index).VStamp);
+	if (CachedPayload) {
+		AppendDataToBuffer(CachedPayload, Buffer);
+		VdInfoPtr->Unlock();
+		return;
+	}
+
+	const int32 PayloadStart = Buffer.Num();
+	const uint64 PayloadGeneration = TerrainData->GetZonePayloadGeneration(Index);
+	const bool bIsStored = VdInfoPtr->DataState == TVoxelDataState::READY_TO_LOAD || VdInfoPtr->DataState == TVoxelDataState::LOADED;
+
 	int32 State = (int32)VdInfoPtr->DataState;
 	Buffer << State;
 
@@ -49,28 +81,10 @@ void ASandboxTerrainController::NetworkSerializeZone(FBufferArchive& Buffer, con
 
 	} else if (VdInfoPtr->DataState == TVoxelDataState::LOADED || VdInfoPtr->DataState == TVoxelDataState::GENERATED) {
 		DataVd = SerializeVd(VdInfoPtr->Vd);
-
-		UTerrainZoneComponent* Zone = VdInfoPtr->GetZone();
-		if (Zone) {
-			DataObj = Zone->SerializeAndResetObjectData();
-		} else {
-			auto InstanceObjectMapPtr = VdInfoPtr->GetOrCreateInstanceObjectMap();
-			if (InstanceObjectMapPtr) {
-				DataObj = UTerrainZoneComponent::SerializeInstancedMesh(*InstanceObjectMapPtr);
-			}
-		}
+		DataObj = SerializeZoneObjects(VdInfoPtr);
 	} else if (VdInfoPtr->DataState == TVoxelDataState::UNGENERATED) {
 		// send only objects
-
-		UTerrainZoneComponent* Zone = VdInfoPtr->GetZone();
-		if (Zone) {
-			DataObj = Zone->SerializeAndResetObjectData();
-		} else {
-			auto InstanceObjectMapPtr = VdInfoPtr->GetOrCreateInstanceObjectMap();
-			if (InstanceObjectMapPtr) {
-				DataObj = UTerrainZoneComponent::SerializeInstancedMesh(*InstanceObjectMapPtr);
-			}
-		}
+		DataObj = SerializeZoneObjects(VdInfoPtr);
 	}
 
 	int32 Size = (DataVd == nullptr) ? 0 : DataVd->size();
@@ -88,80 +102,281 @@ void ASandboxTerrainController::NetworkSerializeZone(FBufferArchive& Buffer, con
 	if (Size2 > 0) {
 		AppendDataToBuffer(DataObj, Buffer);
 	}
+
+	if (bIsStored) {
+		TerrainData->PutZonePayload(Index, VStamp, PayloadGeneration, std::make_shared<TData>(Buffer.GetData() + PayloadStart, Buffer.GetData() + Buffer.Num()));
+	}
 	
 	VdInfoPtr->Unlock();
 }
 
-TDataPtr Decompress(TDataPtr CompressedDataPtr);
+// changed regions of voxel data since client BaseVStamp, then objects if they are changed (size -1 if not).
+// false if server has no complete edit history, whole zone should be sent
+bool ASandboxTerrainController::NetworkSerializeZoneDelta(FBufferArchive& Buffer, const TVoxelIndex& Index, int32 BaseVStamp) {
+	TVoxelDataInfoPtr VdInfoPtr = TerrainData->GetVoxelDataInfo(Index);
+	TVdInfoLockGuard Lock(VdInfoPtr);
 
-// spawn received zone on client
-void ASandboxTerrainController::NetworkSpawnClientZone(const TVoxelIndex& Index, FArrayReader& RawVdData) {
-	FVector Pos = GetZonePos(Index);
+	int32 VStamp = TerrainData->GetZoneVStamp(Index).VStamp;
+
+	std::vector<TDataPtr> RegionList;
+	bool bObjectsChanged = false;
+	if (!TerrainData->GetZoneDelta(Index, BaseVStamp, VStamp, RegionList, bObjectsChanged)) {
+		return false;
+	}
+
+	TDataPtr DataObj = nullptr;
+	if (bObjectsChanged) {
+		if (VdInfoPtr->DataState != TVoxelDataState::LOADED && VdInfoPtr->DataState != TVoxelDataState::GENERATED && VdInfoPtr->DataState != TVoxelDataState::UNGENERATED) {
+			return false;
+		}
+
+		DataObj = SerializeZoneObjects(VdInfoPtr);
+	}
+
+	Buffer << BaseVStamp;
+	Buffer << VStamp;
+
+	int32 RegionCount = RegionList.size();
+	Buffer << RegionCount;
+
+	for (const TDataPtr& RegionData : RegionList) {
+		int32 Size = RegionData->size();
+		Buffer << Size;
+		AppendDataToBuffer(RegionData, Buffer);
+	}
+
+	int32 SizeObj = bObjectsChanged ? ((DataObj == nullptr) ? 0 : DataObj->size()) : -1;
+	Buffer << SizeObj;
+	if (SizeObj > 0) {
+		AppendDataToBuffer(DataObj, Buffer);
+	}
+
+	return true;
+}
+
+// -1 if client has no voxel data to apply delta
+int32 ASandboxTerrainController::NetworkClientZoneBaseVStamp(const TVoxelIndex& Index) {
+	TVoxelDataInfoPtr VdInfoPtr = TerrainData->GetVoxelDataInfo(Index);
+	TVdInfoLockGuard Lock(VdInfoPtr);
 
-	//FMemoryReader BinaryData = FMemoryReader(RawVdData, true);
-	//BinaryData.Seek(RawVdData.Tell());
+	if (VdInfoPtr->Vd && (VdInfoPtr->DataState == TVoxelDataState::LOADED || VdInfoPtr->DataState == TVoxelDataState::GENERATED)) {
+		return TerrainData->GetZoneVStamp(Index).VStamp;
+	}
+
+	return -1;
+}
 
-	FArrayReader& BinaryData = RawVdData;
+bool deserializeVoxelDataRegion(TVoxelData* vd, const uint8* data, size_t size, bool enableLOD);
 
-	int32 State;
-	BinaryData << State;
+void ASandboxTerrainController::NetworkApplyClientZoneDelta(const TVoxelIndex& Index, FArchive& Data) {
+	int32 BaseVStamp;
+	Data << BaseVStamp;
 
 	int32 VStamp;
-	BinaryData << VStamp;
+	Data << VStamp;
 
-	UE_LOG(LogVt, Warning, TEXT("NetworkSpawnClientZone: %d %d %d VStamp = %d"), Index.X, Index.Y, Index.Z, VStamp);
+	int32 RegionCount;
+	Data << RegionCount;
 
-	//UE_LOG(LogVt, Warning, TEXT("NetworkSpawnClientZone: %d %d %d remote state = %d"), Index.X, Index.Y, Index.Z, State);
+	UE_LOG(LogVt, Log, TEXT("NetworkApplyClientZoneDelta: %d %d %d VStamp = %d -> %d, regions = %d"), Index.X, Index.Y, Index.Z, BaseVStamp, VStamp, RegionCount);
 
-	TVoxelDataState ServerVdState = (TVoxelDataState)State;
-	if (ServerVdState == TVoxelDataState::READY_TO_LOAD || ServerVdState == TVoxelDataState::LOADED) {
+	// whole message is read and checked before zone is touched: every block must fit into rest of message
+	bool bValid = RegionCount >= 0 && RegionCount <= (Data.TotalSize() - Data.Tell()) / (int64)sizeof(int32);
+
+	TArray<TData> RegionDataArray;
+	for (int32 I = 0; bValid && I < RegionCount; I++) {
 		int32 Size;
-		BinaryData << Size;
+		Data << Size;
+		if (Size < 0 || Size > Data.TotalSize() - Data.Tell()) {
+			bValid = false;
+			break;
+		}
 
-		//UE_LOG(LogVt, Warning, TEXT("NetworkSpawnClientZone: BinaryData %d "), Size);
+		TData& RegionData = RegionDataArray.AddDefaulted_GetRef();
+		RegionData.resize(Size);
+		Data.Serialize(RegionData.data(), Size);
+	}
 
-		if(Size > 0) {
-			TVoxelDataInfoPtr VdInfoPtr = TerrainData->GetVoxelDataInfo(Index);
-			VdInfoPtr->Lock();
+	int32 SizeObj = -1;
+	TData ObjData;
+	if (bValid) {
+		Data << SizeObj;
+		if (SizeObj > Data.TotalSize() - Data.Tell()) {
+			bValid = false;
+		} else if (SizeObj > 0) {
+			ObjData.resize(SizeObj);
+			Data.Serialize(ObjData.data(), SizeObj);
+		}
+	}
 
-			TerrainData->SetZoneVStamp(Index, VStamp);
+	if (!bValid || Data.IsError()) {
+		UE_LOG(LogVt, Warning, TEXT("Client: invalid delta message %d %d %d"), Index.X, Index.Y, Index.Z);
+		TerrainClientComponent->RequestVoxelData(Index, true);
+		return;
+	}
+
+	TVoxelDataInfoPtr VdInfoPtr = TerrainData->GetVoxelDataInfo(Index);
+	TVdInfoLockGuard Lock(VdInfoPtr);
+
+	TVoxelData* Vd = VdInfoPtr->Vd;
+	if (Vd == nullptr || TerrainData->GetZoneVStamp(Index).VStamp != BaseVStamp) {
+		// local zone is changed or unloaded after request
+		UE_LOG(LogVt, Warning, TEXT("Client: delta %d %d %d doesn't match local zone"), Index.X, Index.Y, Index.Z);
+		TerrainClientComponent->RequestVoxelData(Index, true);
+		return;
+	}
+
+	// previous edit mesh is valid base only if voxel data is not changed after it
+	TMeshDataPtr BaseMeshDataPtr = TerrainData->GetEditMesh(Index);
+	if (BaseMeshDataPtr && BaseMeshDataPtr->SourceRevision != Vd->getRevision()) {
+		BaseMeshDataPtr = nullptr;
+	}
+
+	Vd->resetDirtyRegion();
+
+	for (const TData& RegionData : RegionDataArray) {
+		if (!deserializeVoxelDataRegion(Vd, RegionData.data(), RegionData.size(), USBT_ENABLE_LOD)) {
+			UE_LOG(LogVt, Warning, TEXT("Client: invalid delta %d %d %d"), Index.X, Index.Y, Index.Z);
+			TerrainClientComponent->RequestVoxelData(Index, true);
+			return;
+		}
+	}
+
+	const bool bObjectsChanged = SizeObj >= 0;
+	TInstanceMeshTypeMap ZoneInstanceMeshMap;
+	if (SizeObj > 0) {
+		DeserializeInstancedMeshes(ObjData, ZoneInstanceMeshMap);
+	}
+
+	TerrainData->SetZoneVStamp(Index, VStamp);
+
+	TMeshDataPtr MeshDataPtr = nullptr;
+	TVoxelIndex Lower, Upper;
+	if (Vd->getDirtyRegion(Lower, Upper)) {
+		VdInfoPtr->SetChanged();
+		Vd->setCacheToValid();
+		MeshDataPtr = GenerateEditMesh(Vd, BaseMeshDataPtr);
+		TerrainData->SetEditMesh(Index, MeshDataPtr);
+		VdInfoPtr->ResetLastMeshRegenerationTime();
+
+		if (MeshDataPtr) {
+			MeshDataPtr->VStamp = VStamp;
+		}
+	}
+
+	if (MeshDataPtr || bObjectsChanged) {
+		const FVector Pos = GetZonePos(Index);
+
+		TFunction<void()> Function = [=, this]() {
+			if (!IsGameShutdown()) {
+				UTerrainZoneComponent* Zone = GetZoneByVectorIndex(Index);
+				if (Zone == nullptr) {
+					Zone = AddTerrainZone(Pos);
+				}
 
-			TDataPtr DataPtr = TDataPtr(new TData);
-			for (int I = 0; I < Size; I++) {
-				uint8 Byte;
-				BinaryData << Byte;
-				DataPtr->push_back(Byte);
+				if (Zone) {
+					if (MeshDataPtr) {
+						Zone->ApplyTerrainMesh(MeshDataPtr);
+					}
+
+					if (bObjectsChanged) {
+						Zone->ReplaceAll(ZoneInstanceMeshMap);
+					}
+				}
 			}
+		};
+
+		InvokeSafe(Function);
+	}
+
+	TerrainData->RemoveSyncItem(Index);
+}
+
+TDataPtr Decompress(TDataPtr CompressedDataPtr);
+
+// first stage of received zone: read message and decompress voxel data, no zone data is touched
+bool ASandboxTerrainController::NetworkDecompressClientZone(const TVoxelIndex& Index, FArchive& Data, TClientZonePayload& Payload) {
+	Data << Payload.State;
+	Data << Payload.VStamp;
 
+	UE_LOG(LogVt, Warning, TEXT("NetworkDecompressClientZone: %d %d %d VStamp = %d"), Index.X, Index.Y, Index.Z, Payload.VStamp);
+
+	int32 SizeVd;
+	Data << SizeVd;
+	if (SizeVd < 0 || SizeVd > Data.TotalSize() - Data.Tell()) {
+		return false;
+	}
+
+	if (SizeVd > 0) {
+		TData VdData(SizeVd);
+		Data.Serialize(VdData.data(), SizeVd);
+		Payload.VdData = DecompressData(VdData.data(), VdData.size(), USBT_MAP_FORMAT_VERSION);
+		if (!Payload.VdData) {
+			return false;
+		}
+	}
+
+	int32 SizeObj;
+	Data << SizeObj;
+	if (SizeObj < 0 || SizeObj > Data.TotalSize() - Data.Tell()) {
+		return false;
+	}
+
+	if (SizeObj > 0) {
+		Payload.ObjData.resize(SizeObj);
+		Data.Serialize(Payload.ObjData.data(), SizeObj);
+	}
+
+	return !Data.IsError();
+}
+
+// spawn received zone on client
+void ASandboxTerrainController::NetworkSpawnClientZone(const TVoxelIndex& Index, TClientZonePayload& Payload) {
+	FVector Pos = GetZonePos(Index);
+
+	const int32 VStamp = Payload.VStamp;
+
+	//UE_LOG(LogVt, Warning, TEXT("NetworkSpawnClientZone: %d %d %d remote state = %d"), Index.X, Index.Y, Index.Z, State);
+
+	TVoxelDataState ServerVdState = (TVoxelDataState)Payload.State;
+	if (ServerVdState == TVoxelDataState::READY_TO_LOAD || ServerVdState == TVoxelDataState::LOADED) {
+		if(Payload.VdData) {
+			// deserialization and meshing use only local data, zone is locked just to publish result
 			TVoxelData* Vd = NewVoxelData();
 			Vd->setOrigin(GetZonePos(Index));
-			DeserializeVd(DataPtr, Vd);
-
-			VdInfoPtr->Vd = Vd;
-			VdInfoPtr->DataState = TVoxelDataState::GENERATED;
-			VdInfoPtr->SetChanged();
+			if (!deserializeVoxelData(Vd, *Payload.VdData)) {
+				UE_LOG(LogVt, Error, TEXT("NetworkSpawnClientZone: broken vd %d %d %d"), Index.X, Index.Y, Index.Z);
+				delete Vd;
+				return;
+			}
 
 			TMeshDataPtr MeshDataPtr = nullptr;
-			if (VdInfoPtr->Vd->getDensityFillState() == TVoxelDataFillState::MIXED) {
+			if (Vd->getDensityFillState() == TVoxelDataFillState::MIXED) {
 				MeshDataPtr = GenerateMesh(Vd);
-				TerrainData->PutMeshDataToCache(Index, MeshDataPtr);
 				//ExecGameThreadAddZoneAndApplyMesh(Index, MeshDataPtr, 0, true);
 			}
 
-			int32 SizeObj;
-			BinaryData << SizeObj;
 			TInstanceMeshTypeMap ZoneInstanceMeshMap;
-			//UE_LOG(LogVt, Warning, TEXT("Client: obj %d %d %d -> %d"), Index.X, Index.Y, Index.Z, SizeObj);
-
-			if (SizeObj > 0) {
-				TData ObjData;
-				for (int I = 0; I < SizeObj; I++) {
-					uint8 Byte;
-					BinaryData << Byte;
-					ObjData.push_back(Byte);
-				}
+			if (Payload.ObjData.size() > 0) {
+				DeserializeInstancedMeshes(Payload.ObjData, ZoneInstanceMeshMap);
+			}
+
+			TVoxelDataInfoPtr VdInfoPtr = TerrainData->GetVoxelDataInfo(Index);
+			VdInfoPtr->Lock();
+
+			TerrainData->SetZoneVStamp(Index, VStamp);
+
+			// zone received again, e.g. full resend after edit. old data is used only under zone lock
+			if (VdInfoPtr->Vd != nullptr) {
+				delete VdInfoPtr->Vd;
+			}
+
+			VdInfoPtr->Vd = Vd;
+			VdInfoPtr->DataState = TVoxelDataState::GENERATED;
+			VdInfoPtr->SetChanged();
 
-				DeserializeInstancedMeshes(ObjData, ZoneInstanceMeshMap);
+			if (MeshDataPtr) {
+				TerrainData->PutMeshDataToCache(Index, MeshDataPtr);
 			}
 
 			TFunction<void()> Function = [=, this]() {
@@ -183,33 +398,16 @@ void ASandboxTerrainController::NetworkSpawnClientZone(const TVoxelIndex& Index,
 		}
 	} if (ServerVdState == TVoxelDataState::GENERATED || ServerVdState == TVoxelDataState::UNGENERATED) {
 
-		int32 SizeVd;
-		BinaryData << SizeVd;
-
-		//UE_LOG(LogVt, Warning, TEXT("Client: TEST1 vd %d %d %d -> %d"), Index.X, Index.Y, Index.Z, SizeVd);
-
-		if (SizeVd == 0) {
+		if (!Payload.VdData) {
 
 			//DrawDebugBox(GetWorld(), Pos, FVector(USBT_ZONE_SIZE / 2), FColor(255, 0, 0, 100), true);
 
 			TVoxelDataInfoPtr VdInfoPtr = TerrainData->GetVoxelDataInfo(Index);
 			VdInfoPtr->Lock();
 
-			int32 SizeObj;
-			BinaryData << SizeObj;
 			TInstanceMeshTypeMap ZoneInstanceMeshMap;
-
-			//UE_LOG(LogVt, Warning, TEXT("Client: TEST2 obj %d %d %d -> %d"), Index.X, Index.Y, Index.Z, SizeObj);
-
-			if (SizeObj > 0) {
-				TData ObjData;
-				for (int I = 0; I < SizeObj; I++) {
-					uint8 Byte;
-					BinaryData << Byte;
-					ObjData.push_back(Byte);
-				}
-
-				DeserializeInstancedMeshes(ObjData, ZoneInstanceMeshMap);
+			if (Payload.ObjData.size() > 0) {
+				DeserializeInstancedMeshes(Payload.ObjData, ZoneInstanceMeshMap);
 			}
 
 			FVector ZonePos = GetZonePos(Index);
@@ -292,6 +490,60 @@ TArray<std::tuple<TVoxelIndex, TZoneModificationData>> ASandboxTerrainController
 	return Result;
 }
 
+bool ASandboxTerrainController::NetworkSerializeMapDelta(FBufferArchive& Buffer, int32 ClientMapVStamp) {
+	int32 MapVStamp = 0;
+	std::vector<TMapVersionLog::TEntry> EntryList;
+	if (!TerrainData->GetMapDelta(ClientMapVStamp, MapVStamp, EntryList)) {
+		return false;
+	}
+
+	std::vector<uint8> Data;
+	TMapVersionLog::encode(EntryList, Data);
+
+	uint32 Size = Data.size();
+	Buffer << ClientMapVStamp;
+	Buffer << MapVStamp;
+	Buffer << Size;
+	Buffer.Append(Data.data(), Data.size());
+
+	return true;
+}
+
+// modified zones near center go first, so client can start building terrain before whole map is received
+TArray<TVoxelIndex> ASandboxTerrainController::NetworkServerPushList(const TVoxelIndex& Center, uint32 Radius) {
+	TArray<TVoxelIndex> Result;
+
+	auto Vm = TerrainData->CloneVStampMap();
+
+	TMap<TVoxelIndex, TArray<TVoxelIndex>> ColumnMap;
+	for (const auto& Itm : Vm) {
+		const TVoxelIndex& Index = Itm.Key;
+		ColumnMap.FindOrAdd(TVoxelIndex(Index.X, Index.Y, 0)).Add(Index);
+	}
+
+	for (const auto& ChunkIndex : ReverseSpiralWalkthrough(Radius)) {
+		TArray<TVoxelIndex>* Column = ColumnMap.Find(TVoxelIndex(Center.X + ChunkIndex.X, Center.Y + ChunkIndex.Y, 0));
+		if (Column) {
+			Column->Sort([&](const TVoxelIndex& A, const TVoxelIndex& B) { return FMath::Abs(A.Z - Center.Z) < FMath::Abs(B.Z - Center.Z); });
+			Result.Append(*Column);
+		}
+	}
+
+	return Result;
+}
+
+int32 ASandboxTerrainController::NetworkServerZonePriority(const TVoxelIndex& Index, const TVoxelIndex& ClientIndex) {
+	const TVoxelIndex D(Index.X - ClientIndex.X, Index.Y - ClientIndex.Y, Index.Z - ClientIndex.Z);
+	int32 Priority = FMath::Max3(FMath::Abs(D.X), FMath::Abs(D.Y), FMath::Abs(D.Z));
+
+	const double EditTime = TerrainData->GetZoneEditTime(Index);
+	if (EditTime > 0 && FPlatformTime::Seconds() - EditTime < USBT_NET_RECENT_EDIT_TIME) {
+		Priority -= USBT_NET_RECENT_EDIT_BONUS;
+	}
+
+	return Priority;
+}
+
 void ASandboxTerrainController::OnReceiveServerMapInfo(const TMap<TVoxelIndex, TZoneModificationData>& ServerDataMap) {
 	UE_LOG(LogVt, Warning, TEXT("Client: OnReceiveServerMapInfo -> %d items"), ServerDataMap.Num());
 
@@ -326,28 +578,72 @@ void ASandboxTerrainController::OnReceiveServerMapInfo(const TMap<TVoxelIndex, T
 
 	//TerrainData->SwapVStampMap(ServerDataMap);
 
-	for (const auto& Index : OutOfsyncZones) {
-		UE_LOG(LogVt, Warning, TEXT("Client: RequestVoxelData %d %d %d "), Index.X, Index.Y, Index.Z);
-		TerrainClientComponent->RequestVoxelData(Index);
+	if (bInitialLoad) {
+		// player position is available on game thread only
+		TArray<TVoxelIndex> ZoneList = OutOfsyncZones.Array();
+		AsyncTask(ENamedThreads::GameThread, [=, this] {
+			if (!IsGameShutdown()) {
+				NetworkClientBeginInitialLoad(GetLocalPlayerZoneIndex(), ZoneList);
+			}
+		});
+
+		return;
 	}
 
-	if (bInitialLoad) {
-		//FIXME
-		TVoxelIndex Index(0, 0, 0);
-		BeginClientTerrainLoad(Index);
+	UE_LOG(LogVt, Log, TEXT("Client: request %d zones"), OutOfsyncZones.Num());
+	TerrainClientComponent->RequestVoxelDataBatch(OutOfsyncZones.Array());
+}
+
+void ASandboxTerrainController::NetworkClientBeginInitialLoad(const TVoxelIndex& Center, const TArray<TVoxelIndex>& ZoneList) {
+	// server pushes zones of active area in spiral order with flow control, request only the rest
+	TerrainClientComponent->RequestPush(Center, ActiveAreaSize);
+
+	TArray<TVoxelIndex> RequestList;
+	for (const auto& Index : ZoneList) {
+		if (FMath::Max(FMath::Abs(Index.X - Center.X), FMath::Abs(Index.Y - Center.Y)) > (int32)ActiveAreaSize) {
+			RequestList.Add(Index);
+		}
 	}
+
+	UE_LOG(LogVt, Log, TEXT("Client: initial load at %d %d %d, request %d zones"), Center.X, Center.Y, Center.Z, RequestList.Num());
+	TerrainClientComponent->RequestVoxelDataBatch(RequestList);
+
+	BeginClientTerrainLoad(Center);
+}
+
+// pawn location or camera if pawn is not spawned yet, game thread only
+TVoxelIndex ASandboxTerrainController::GetLocalPlayerZoneIndex() {
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (!PlayerController) {
+		return TVoxelIndex(0, 0, 0);
+	}
+
+	if (PlayerController->GetPawn()) {
+		return GetZoneIndex(PlayerController->GetPawn()->GetActorLocation());
+	}
+
+	FVector Location;
+	FRotator Rotation;
+	PlayerController->GetPlayerViewPoint(Location, Rotation);
+	return GetZoneIndex(Location);
 }
 
 void ASandboxTerrainController::PingServer() {
+	TerrainClientComponent->SendPosition(GetLocalPlayerZoneIndex());
+
 	TerrainClientComponent->RequestMapInfoIfStaled();
 
 	const auto IndexSet = TerrainData->StaledSyncItems(1);
 	if (IndexSet.size() > 0) {
 		UE_LOG(LogVt, Warning, TEXT("Client: staled sync items: %d"), IndexSet.size());
 
+		TArray<TVoxelIndex> RequestList;
+		RequestList.Reserve(IndexSet.size());
 		for (const auto& Index : IndexSet) {
-			TerrainClientComponent->RequestVoxelData(Index);
+			RequestList.Add(Index);
 		}
+
+		TerrainClientComponent->RequestVoxelDataBatch(RequestList);
 	}
 
 }
\ No newline at end of file
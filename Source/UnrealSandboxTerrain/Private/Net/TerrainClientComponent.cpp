@@ -8,6 +8,10 @@
 #include "IPAddressAsyncResolve.h"
 #include "Sockets.h"
 #include "SocketSubsystem.h"
+#include "Core/NetChannel.hpp"
+#include "Core/MapVersionLog.hpp"
+#include "Core/ThreadPool.hpp"
+#include "Serialization/MemoryReader.h"
 
 
 UTerrainClientComponent::UTerrainClientComponent(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer) {
@@ -57,6 +61,10 @@ void UTerrainClientComponent::Init() {
 		UdpSocket->SetSendBufferSize(BufferSize, BufferSize);
 		UdpSocket->SetReceiveBufferSize(BufferSize, BufferSize);
 
+		Channel = NewChannel(RemoteAddr.ToSharedRef());
+		DecodeState = std::make_shared<TDecodeState>();
+		RcvBuffer.SetNumUninitialized(USBT_NET_MAX_DATAGRAM_SIZE);
+
 		ClientLoopTask = UE::Tasks::Launch(TEXT("vd_client"), [=, this] { RcvThreadLoop(); });
 
 		if (GetTerrainController()->bAutoConnect) {
@@ -81,6 +89,10 @@ void UTerrainClientComponent::HandleRcvData(FArrayReader& Data) {
 
 	if (OpCode == Net_Opcode_ResponseVd) {
 		HandleResponseVd(Data);
+	} else if (OpCode == Net_Opcode_ResponseVdDelta) {
+		HandleResponseVdDelta(Data);
+	} else if (OpCode == Net_Opcode_ResponseMapDelta) {
+		HandleResponseMapDelta(Data);
 	} else if (OpCode == Net_Opcode_ResponseMapInfo) {
 		UE_LOG(LogVt, Log, TEXT("Client: ResponseMapInfo"));
 
@@ -112,6 +124,42 @@ void UTerrainClientComponent::HandleRcvData(FArrayReader& Data) {
 	}
 }
 
+void UTerrainClientComponent::HandleResponseMapDelta(FArrayReader& Data) {
+	int32 BaseMapVStamp = 0;
+	int32 MapVStamp = 0;
+	uint32 Size = 0;
+
+	Data << BaseMapVStamp;
+	Data << MapVStamp;
+	Data << Size;
+
+	if (BaseMapVStamp != StoredVStamp || Size > (uint32)(Data.TotalSize() - Data.Tell())) {
+		// answer to older request, next ping requests it again
+		UE_LOG(LogVt, Warning, TEXT("Client: skip map delta %d -> %d, local MapVStamp %d"), BaseMapVStamp, MapVStamp, StoredVStamp);
+		return;
+	}
+
+	std::vector<TMapVersionLog::TEntry> EntryList;
+	if (!TMapVersionLog::decode(Data.GetData() + Data.Tell(), Size, EntryList)) {
+		UE_LOG(LogVt, Warning, TEXT("Client: invalid map delta"));
+		return;
+	}
+
+	UE_LOG(LogVt, Log, TEXT("Client: map delta %d -> %d, %d zones"), BaseMapVStamp, MapVStamp, EntryList.size());
+
+	TMap<TVoxelIndex, TZoneModificationData> ServerMap;
+	ServerMap.Reserve(EntryList.size());
+	for (const auto& Entry : EntryList) {
+		TZoneModificationData MData;
+		MData.VStamp = Entry.vstamp;
+		ServerMap.Add(Entry.zone_index, MData);
+	}
+
+	StoredVStamp = MapVStamp;
+
+	GetTerrainController()->OnReceiveServerMapInfo(ServerMap);
+}
+
 void UTerrainClientComponent::HandleResponseVd(FArrayReader& Data) {
 	TVoxelIndex VoxelIndex(0, 0, 0);
 
@@ -121,12 +169,152 @@ void UTerrainClientComponent::HandleResponseVd(FArrayReader& Data) {
 
 	UE_LOG(LogVt, Log, TEXT("Client: HandleResponseVd %d %d %d"), VoxelIndex.X, VoxelIndex.Y, VoxelIndex.Z);
 
-	GetTerrainController()->NetworkSpawnClientZone(VoxelIndex, Data);
+	QueueDecode(Net_Opcode_ResponseVd, VoxelIndex, Data);
+}
+
+void UTerrainClientComponent::HandleResponseVdDelta(FArrayReader& Data) {
+	TVoxelIndex VoxelIndex(0, 0, 0);
+
+	Data << VoxelIndex.X;
+	Data << VoxelIndex.Y;
+	Data << VoxelIndex.Z;
+
+	UE_LOG(LogVt, Log, TEXT("Client: HandleResponseVdDelta %d %d %d"), VoxelIndex.X, VoxelIndex.Y, VoxelIndex.Z);
+
+	QueueDecode(Net_Opcode_ResponseVdDelta, VoxelIndex, Data);
+}
+
+void UTerrainClientComponent::QueueDecode(uint32 OpCode, const TVoxelIndex& Index, FArrayReader& Data) {
+	const int64 Pos = Data.Tell();
+	auto Payload = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>(Data.GetData() + Pos, Data.Num() - Pos);
+
+	const std::lock_guard<std::mutex> Lock(DecodeState->Mutex);
+	DecodeState->Queue.push_back(TDecodeItem{ OpCode, Index, Payload });
+}
+
+bool UTerrainClientComponent::IsDecodeQueueFull() {
+	const std::lock_guard<std::mutex> Lock(DecodeState->Mutex);
+	return DecodeState->Queue.size() >= USBT_NET_DECODE_QUEUE_SIZE;
+}
+
+void UTerrainClientComponent::DispatchDecode() {
+	ASandboxTerrainController* Controller = GetTerrainController();
+	std::shared_ptr<TDecodeState> State = DecodeState;
+
+	const std::lock_guard<std::mutex> Lock(State->Mutex);
+	for (auto It = State->Queue.begin(); It != State->Queue.end() && State->ZoneSet.Num() < USBT_NET_DECODE_TASKS;) {
+		if (State->ZoneSet.Contains(It->Index)) {
+			++It;
+			continue;
+		}
+
+		const TDecodeItem Item = *It;
+		It = State->Queue.erase(It);
+		State->ZoneSet.Add(Item.Index);
+
+		auto ReleaseZone = [=]() {
+			const std::lock_guard<std::mutex> Lock(State->Mutex);
+			State->ZoneSet.Remove(Item.Index);
+		};
+
+		// delta is applied by one task, it has no compressed data
+		if (Item.OpCode == Net_Opcode_ResponseVdDelta) {
+			Controller->AddAsyncTask([=]() {
+				if (!Controller->bIsWorkFinished) {
+					FMemoryReader Reader(*Item.Payload);
+					Controller->NetworkApplyClientZoneDelta(Item.Index, Reader);
+				}
+
+				ReleaseZone();
+			}, TTaskPriority::NEAR_STREAMING);
+
+			continue;
+		}
+
+		// decompress, then deserialize and mesh on terrain thread pool, zone component is applied by conveyor
+		Controller->AddAsyncTask([=]() {
+			auto Payload = std::make_shared<TClientZonePayload>();
+			FMemoryReader Reader(*Item.Payload);
+			if (Controller->bIsWorkFinished || !Controller->NetworkDecompressClientZone(Item.Index, Reader, *Payload)) {
+				ReleaseZone();
+				return;
+			}
+
+			Controller->AddAsyncTask([=]() {
+				if (!Controller->bIsWorkFinished) {
+					Controller->NetworkSpawnClientZone(Item.Index, *Payload);
+				}
+
+				ReleaseZone();
+			}, TTaskPriority::NEAR_STREAMING);
+		}, TTaskPriority::NEAR_STREAMING);
+	}
+}
+
+void UTerrainClientComponent::RequestVoxelData(const TVoxelIndex& ZoneIndex, bool bFull) {
+	TVoxelIndex Index = ZoneIndex;
+	int32 BaseVStamp = bFull ? -1 : GetTerrainController()->NetworkClientZoneBaseVStamp(ZoneIndex);
+	uint32 OpCode = (BaseVStamp < 0) ? Net_Opcode_RequestVd : Net_Opcode_RequestVdDelta;
+	static uint32 OpCodeExt = 0;
+
+	FBufferArchive SendBuffer;
+	SendBuffer << OpCode;
+	SendBuffer << OpCodeExt;
+	SendBuffer << Index.X;
+	SendBuffer << Index.Y;
+	SendBuffer << Index.Z;
+
+	if (OpCode == Net_Opcode_RequestVdDelta) {
+		SendBuffer << BaseVStamp;
+	}
+
+	SendMessage(SendBuffer);
+}
+
+void UTerrainClientComponent::RequestVoxelDataBatch(const TArray<TVoxelIndex>& IndexList) {
+	static uint32 OpCode = Net_Opcode_RequestVdBatch;
+	static uint32 OpCodeExt = 0;
+
+	for (int32 Start = 0; Start < IndexList.Num(); Start += USBT_NET_BATCH_SIZE) {
+		uint32 Count = FMath::Min(IndexList.Num() - Start, USBT_NET_BATCH_SIZE);
+
+		FBufferArchive SendBuffer;
+		SendBuffer << OpCode;
+		SendBuffer << OpCodeExt;
+		SendBuffer << Count;
+
+		for (uint32 I = 0; I < Count; I++) {
+			TVoxelIndex Index = IndexList[Start + I];
+			int32 BaseVStamp = GetTerrainController()->NetworkClientZoneBaseVStamp(Index);
+			SendBuffer << Index.X;
+			SendBuffer << Index.Y;
+			SendBuffer << Index.Z;
+			SendBuffer << BaseVStamp;
+		}
+
+		SendMessage(SendBuffer);
+	}
+}
+
+void UTerrainClientComponent::RequestPush(const TVoxelIndex& Center, uint32 Radius) {
+	TVoxelIndex Index = Center;
+	static uint32 OpCode = Net_Opcode_RequestPush;
+	static uint32 OpCodeExt = 0;
+
+	FBufferArchive SendBuffer;
+	SendBuffer << OpCode;
+	SendBuffer << OpCodeExt;
+	SendBuffer << Index.X;
+	SendBuffer << Index.Y;
+	SendBuffer << Index.Z;
+	SendBuffer << Radius;
+
+	SendMessage(SendBuffer);
 }
 
-void UTerrainClientComponent::RequestVoxelData(const TVoxelIndex& ZoneIndex) {
+void UTerrainClientComponent::SendPosition(const TVoxelIndex& ZoneIndex) {
 	TVoxelIndex Index = ZoneIndex;
-	static uint32 OpCode = Net_Opcode_RequestVd;
+	static uint32 OpCode = Net_Opcode_ClientPosition;
 	static uint32 OpCodeExt = 0;
 
 	FBufferArchive SendBuffer;
@@ -136,7 +324,7 @@ void UTerrainClientComponent::RequestVoxelData(const TVoxelIndex& ZoneIndex) {
 	SendBuffer << Index.Y;
 	SendBuffer << Index.Z;
 
-	UdpSend(SendBuffer, *RemoteAddr);
+	SendMessage(SendBuffer);
 }
 
 void UTerrainClientComponent::RequestMapInfo() {
@@ -147,7 +335,7 @@ void UTerrainClientComponent::RequestMapInfo() {
 	SendBuffer << OpCode;
 	SendBuffer << OpCodeExt;
 
-	UdpSend(SendBuffer, *RemoteAddr);
+	SendMessage(SendBuffer);
 }
 
 void UTerrainClientComponent::RequestMapInfoIfStaled() {
@@ -159,7 +347,11 @@ void UTerrainClientComponent::RequestMapInfoIfStaled() {
 	SendBuffer << OpCodeExt;
 	SendBuffer << StoredVStamp;
 
-	UdpSend(SendBuffer, *RemoteAddr);
+	SendMessage(SendBuffer);
+}
+
+void UTerrainClientComponent::SendMessage(const FBufferArchive& SendBuffer) {
+	Channel->send(SendBuffer.GetData(), SendBuffer.Num(), FPlatformTime::Seconds());
 }
 
 void UTerrainClientComponent::RcvThreadLoop() {
@@ -167,19 +359,40 @@ void UTerrainClientComponent::RcvThreadLoop() {
 	while (!GetTerrainController()->bIsWorkFinished) {
 		TSharedRef<FInternetAddr> Sender = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
 		uint32 Size;
-		while (UdpSocket->HasPendingData(Size)) {
-			uint32 MaxReadBufferSize = 2 * 1024 * 1024;
-
-			FArrayReader Data;
-			Data.SetNumZeroed(MaxReadBufferSize);
-
+		// socket buffer is not read while decode is behind, server retransmits then
+		while (!IsDecodeQueueFull() && UdpSocket->HasPendingData(Size)) {
 			int32 Read = 0;
-			if (UdpSocket->RecvFrom(Data.GetData(), Data.Num(), Read, *Sender)) {
+			if (UdpSocket->RecvFrom(RcvBuffer.GetData(), RcvBuffer.Num(), Read, *Sender)) {
 				//UE_LOG(LogVt, Log, TEXT("Client: udp rcv %d"), Read);
-				Data.SetNum(Read);
-				HandleRcvData(Data);
+
+				if (TNetChannel::isChannelDatagram(RcvBuffer.GetData(), Read)) {
+					std::vector<TNetChannel::TMessage> MessageList;
+					Channel->receive(RcvBuffer.GetData(), Read, FPlatformTime::Seconds(), MessageList);
+
+					for (const TNetChannel::TMessage& Message : MessageList) {
+						FArrayReader MessageData;
+						MessageData.Append(Message.data(), Message.size());
+						HandleRcvData(MessageData);
+					}
+				} else {
+					FArrayReader Data;
+					Data.Append(RcvBuffer.GetData(), Read);
+					HandleRcvData(Data);
+				}
 			}
 		}
+
+		DispatchDecode();
+
+		// retransmit requests and send delayed ack
+		Channel->tick(FPlatformTime::Seconds());
+
+		if (Channel->isBroken()) {
+			UE_LOG(LogVt, Warning, TEXT("Client: server doesn't respond, reset channel"));
+			Channel->reset(FPlatformTime::Seconds());
+		}
+
+		FPlatformProcess::Sleep(0.001f);
 	}
 	
 	UE_LOG(LogVt, Log, TEXT("Client: finish rcv loop"));
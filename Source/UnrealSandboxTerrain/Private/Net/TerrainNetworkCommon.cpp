@@ -3,6 +3,7 @@
 #include "TerrainNetworkCommon.h"
 #include "SandboxTerrainController.h"
 #include "NetworkMessage.h"
+#include "Core/NetChannel.hpp"
 
 
 UTerrainNetworkworkComponent::UTerrainNetworkworkComponent(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer) {
@@ -33,6 +34,16 @@ int32 UTerrainNetworkworkComponent::UdpSend(FBufferArchive SendBuffer, const FIn
 	return BytesSent;
 }
 
+int32 UTerrainNetworkworkComponent::UdpSend(const uint8* Data, int32 Size, const FInternetAddr& Addr) {
+	int32 BytesSent = 0;
+	UdpSocket->SendTo(Data, Size, BytesSent, Addr);
+	return BytesSent;
+}
+
+std::shared_ptr<TNetChannel> UTerrainNetworkworkComponent::NewChannel(TSharedRef<FInternetAddr> Addr) {
+	return std::make_shared<TNetChannel>([=, this](const uint8* Data, size_t Size) { UdpSend(Data, (int32)Size, *Addr); }, FPlatformTime::Seconds(), USBT_NET_SEND_WINDOW, USBT_NET_FRAGMENT_SIZE);
+}
+
 
 ASandboxTerrainController* UTerrainNetworkworkComponent::GetTerrainController() {
 	return (ASandboxTerrainController*)GetAttachmentRootActor();
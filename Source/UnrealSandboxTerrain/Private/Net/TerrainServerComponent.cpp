@@ -3,6 +3,8 @@
 #include "TerrainServerComponent.h"
 #include "SandboxTerrainController.h"
 #include "NetworkMessage.h"
+#include "Core/NetChannel.hpp"
+#include "Core/RequestQueue.hpp"
 
 
 UTerrainServerComponent::UTerrainServerComponent(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer) {
@@ -28,6 +30,14 @@ void UTerrainServerComponent::BeginPlay() {
 		UDPReceiver = new FUdpSocketReceiver(UdpSocket, ThreadWaitTime, TEXT("UDP RECEIVER"));
 		UDPReceiver->OnDataReceived().BindUObject(this, &UTerrainServerComponent::UdpRecv);
 		UDPReceiver->Start();
+
+		RequestQueue = std::make_shared<TFairRequestQueue<FIPv4Endpoint, TServerRequest>>(USBT_NET_REQUEST_QUEUE_SIZE, USBT_NET_CLIENT_QUEUE_SIZE);
+		for (int32 I = 0; I < USBT_NET_SERVER_WORKERS; I++) {
+			WorkerTaskList.Add(UE::Tasks::Launch(TEXT("vd_server_worker"), [=, this] { WorkerThreadLoop(); }));
+		}
+
+		bChannelLoop = true;
+		ChannelLoopTask = UE::Tasks::Launch(TEXT("vd_server_channel"), [=, this] { ChannelThreadLoop(); });
 	} else {
 		UE_LOG(LogVt, Warning, TEXT("Server: Failed to start udp server"));
 	}
@@ -35,9 +45,181 @@ void UTerrainServerComponent::BeginPlay() {
 
 void UTerrainServerComponent::UdpRecv(const FArrayReaderPtr& ArrayReaderPtr, const FIPv4Endpoint& EndPoint) {
 	FArrayReader& Data = *ArrayReaderPtr.Get();
+
+	if (TNetChannel::isChannelDatagram(Data.GetData(), Data.Num())) {
+		std::vector<TNetChannel::TMessage> MessageList;
+		GetOrCreateChannel(EndPoint)->receive(Data.GetData(), Data.Num(), FPlatformTime::Seconds(), MessageList);
+
+		for (const TNetChannel::TMessage& Message : MessageList) {
+			FArrayReader MessageData;
+			MessageData.Append(Message.data(), Message.size());
+			HandleRcvData(EndPoint, MessageData);
+		}
+
+		return;
+	}
+
 	HandleRcvData(EndPoint, Data);
 }
 
+std::shared_ptr<TNetChannel> UTerrainServerComponent::GetOrCreateChannel(const FIPv4Endpoint& EndPoint) {
+	const std::lock_guard<std::mutex> Lock(ChannelMapMutex);
+
+	std::shared_ptr<TNetChannel>* ChannelPtr = ChannelMap.Find(EndPoint);
+	if (ChannelPtr) {
+		return *ChannelPtr;
+	}
+
+	UE_LOG(LogVt, Log, TEXT("Server: new channel %s"), *EndPoint.ToString());
+	std::shared_ptr<TNetChannel> Channel = NewChannel(EndPoint.ToInternetAddr());
+
+	// zone bursts should not starve gameplay replication on the same link
+	const uint32 Rate = GetTerrainController()->ServerClientRate;
+	if (Rate > 0) {
+		Channel->setRate(Rate * 1024.0, USBT_NET_CLIENT_BURST, FPlatformTime::Seconds());
+	}
+
+	return ChannelMap.Add(EndPoint, Channel);
+}
+
+void UTerrainServerComponent::SendMessage(const FIPv4Endpoint& EndPoint, const FBufferArchive& SendBuffer) {
+	GetOrCreateChannel(EndPoint)->send(SendBuffer.GetData(), SendBuffer.Num(), FPlatformTime::Seconds());
+}
+
+// retransmit and delayed ack of all channels, drop channels of gone clients
+void UTerrainServerComponent::ChannelThreadLoop() {
+	while (bChannelLoop) {
+		const double Now = FPlatformTime::Seconds();
+
+		{
+			const std::lock_guard<std::mutex> Lock(ChannelMapMutex);
+			for (auto It = ChannelMap.CreateIterator(); It; ++It) {
+				const std::shared_ptr<TNetChannel>& Channel = It.Value();
+				Channel->tick(Now);
+
+				if (Channel->isBroken() || Now - Channel->getLastReceiveTime() > USBT_NET_CHANNEL_TIMEOUT) {
+					UE_LOG(LogVt, Log, TEXT("Server: drop channel %s"), *It.Key().ToString());
+					PushMap.Remove(It.Key());
+					PositionMap.Remove(It.Key());
+					RequestQueue->removeClient(It.Key());
+					It.RemoveCurrent();
+				}
+			}
+		}
+
+		QueuePushZones();
+
+		if (Now - LastStatTime > USBT_NET_STAT_INTERVAL) {
+			LastStatTime = Now;
+			LogChannelStat();
+		}
+
+		FPlatformProcess::Sleep(0.002f);
+	}
+}
+
+void UTerrainServerComponent::StartPush(const FIPv4Endpoint& EndPoint, const TVoxelIndex& Center, uint32 Radius) {
+	TArray<TVoxelIndex> ZoneList = GetTerrainController()->NetworkServerPushList(Center, Radius);
+	UE_LOG(LogVt, Log, TEXT("Server: push %d zones to %s"), ZoneList.Num(), *EndPoint.ToString());
+
+	GetOrCreateChannel(EndPoint);
+
+	const std::lock_guard<std::mutex> Lock(ChannelMapMutex);
+	TPushState& State = PushMap.FindOrAdd(EndPoint);
+	State.ZoneList = MoveTemp(ZoneList);
+	State.Next = 0;
+
+	PositionMap.Add(EndPoint, Center);
+}
+
+int32 UTerrainServerComponent::GetRequestPriority(const FIPv4Endpoint& EndPoint, const TVoxelIndex& Index) {
+	const TVoxelIndex* Position = PositionMap.Find(EndPoint);
+	return Position ? GetTerrainController()->NetworkServerZonePriority(Index, *Position) : 0;
+}
+
+void UTerrainServerComponent::LogChannelStat() {
+	const std::lock_guard<std::mutex> Lock(ChannelMapMutex);
+	for (const auto& Itm : ChannelMap) {
+		const std::shared_ptr<TNetChannel>& Channel = Itm.Value;
+		UE_LOG(LogVt, Log, TEXT("Server: client %s -> %.1f KB/s, sent %llu KB, retransmits %llu, rto %.3f"), *Itm.Key.ToString(), Channel->getSendRate() / 1024, Channel->getSentBytes() / 1024, Channel->getRetransmitCount(), Channel->getRto());
+	}
+}
+
+void UTerrainServerComponent::QueuePushZones() {
+	const std::lock_guard<std::mutex> Lock(ChannelMapMutex);
+	for (auto It = PushMap.CreateIterator(); It; ++It) {
+		TPushState& State = It.Value();
+		std::shared_ptr<TNetChannel>* ChannelPtr = ChannelMap.Find(It.Key());
+		if (!ChannelPtr) {
+			It.RemoveCurrent();
+			continue;
+		}
+
+		// state is kept while its zones are queued, restarted push counts them in window
+		if (State.Next >= State.ZoneList.Num()) {
+			if (State.InQueue <= 0) {
+				It.RemoveCurrent();
+			}
+
+			continue;
+		}
+
+		// zones waiting for worker are not in channel yet
+		int32 Budget = USBT_NET_PUSH_WINDOW - (*ChannelPtr)->getPendingMessageCount() - State.InQueue;
+		while (Budget > 0 && State.Next < State.ZoneList.Num()) {
+			TServerRequest Request;
+			Request.Index = State.ZoneList[State.Next];
+			Request.bPush = true;
+			const TRequestPushResult Result = RequestQueue->push(It.Key(), Request, GetRequestPriority(It.Key(), Request.Index));
+			if (Result == TRequestPushResult::REJECTED) {
+				break;
+			}
+
+			// merged zone is already counted by earlier push
+			State.Next++;
+			if (Result == TRequestPushResult::ADDED) {
+				State.InQueue++;
+				Budget--;
+			}
+		}
+	}
+}
+
+void UTerrainServerComponent::QueueRequest(const FIPv4Endpoint& EndPoint, const TServerRequest& Request) {
+	int32 Priority;
+	{
+		const std::lock_guard<std::mutex> Lock(ChannelMapMutex);
+		Priority = GetRequestPriority(EndPoint, Request.Index);
+	}
+
+	if (RequestQueue->push(EndPoint, Request, Priority) == TRequestPushResult::REJECTED) {
+		// client requests it again as staled sync item
+		UE_LOG(LogVt, Warning, TEXT("Server: request queue is full, drop %d %d %d from %s"), Request.Index.X, Request.Index.Y, Request.Index.Z, *EndPoint.ToString());
+	}
+}
+
+// zone serialization can load data from disk, so it is done by workers, not by udp receiver or channel thread
+void UTerrainServerComponent::WorkerThreadLoop() {
+	FIPv4Endpoint EndPoint;
+	TServerRequest Request;
+
+	while (RequestQueue->pop(EndPoint, Request)) {
+		if (Request.BaseVStamp < 0) {
+			SendVdByIndex(EndPoint, Request.Index);
+		} else {
+			SendVdDeltaByIndex(EndPoint, Request.Index, Request.BaseVStamp);
+		}
+
+		if (Request.bPush) {
+			const std::lock_guard<std::mutex> Lock(ChannelMapMutex);
+			TPushState* State = PushMap.Find(EndPoint);
+			if (State) {
+				State->InQueue--;
+			}
+		}
+	}
+}
+
 void UTerrainServerComponent::EndPlay(const EEndPlayReason::Type EndPlayReason) {
 	Super::EndPlay(EndPlayReason);
 
@@ -48,6 +230,21 @@ void UTerrainServerComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 		UDPReceiver = nullptr;
 	}
 
+	if (bChannelLoop) {
+		bChannelLoop = false;
+		ChannelLoopTask.Wait();
+	}
+
+	if (RequestQueue) {
+		RequestQueue->stop();
+		UE::Tasks::Wait(WorkerTaskList);
+		WorkerTaskList.Empty();
+	}
+
+	ChannelMap.Empty();
+	PushMap.Empty();
+	PositionMap.Empty();
+
 	if (UdpSocket) {
 		UdpSocket->Close();
 		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(UdpSocket);
@@ -81,12 +278,33 @@ bool UTerrainServerComponent::SendVdByIndex(const FIPv4Endpoint& EndPoint, const
 	GetTerrainController()->NetworkSerializeZone(SendBuffer, Index);
 	//return FNFSMessageHeader::WrapAndSendPayload(SendBuffer, SimpleAbstractSocket);
 
-	int32 Sent = UdpSend(SendBuffer, EndPoint);
+	// zone is usually larger than one datagram
+	SendMessage(EndPoint, SendBuffer);
+
+	return true;
+}
+
+bool UTerrainServerComponent::SendVdDeltaByIndex(const FIPv4Endpoint& EndPoint, const TVoxelIndex& ZoneIndex, int32 BaseVStamp) {
+	TVoxelIndex Index = ZoneIndex;
+	static uint32 OpCode = Net_Opcode_ResponseVdDelta;
+	static uint32 OpCodeExt = Net_Opcode_None;
+	FBufferArchive SendBuffer;
+
+	SendBuffer << OpCode;
+	SendBuffer << OpCodeExt;
+	SendBuffer << Index.X;
+	SendBuffer << Index.Y;
+	SendBuffer << Index.Z;
 
-	if (Sent < 1) {
-		UE_LOG(LogVt, Warning, TEXT("Server: %d / %d bytes sent"), SendBuffer.Num(), Sent);
+	if (!GetTerrainController()->NetworkSerializeZoneDelta(SendBuffer, Index, BaseVStamp)) {
+		UE_LOG(LogVt, Log, TEXT("Server: no delta %d %d %d from VStamp %d, send whole zone"), ZoneIndex.X, ZoneIndex.Y, ZoneIndex.Z, BaseVStamp);
+		return SendVdByIndex(EndPoint, ZoneIndex);
 	}
 
+	UE_LOG(LogVt, Log, TEXT("Server: SendVdDeltaByIndex %d %d %d -> %d bytes"), ZoneIndex.X, ZoneIndex.Y, ZoneIndex.Z, SendBuffer.Num());
+
+	SendMessage(EndPoint, SendBuffer);
+
 	return true;
 }
 
@@ -114,7 +332,26 @@ bool UTerrainServerComponent::SendMapInfo(const FIPv4Endpoint& EndPoint, TArray<
 		//UE_LOG(LogVt, Log, TEXT("Server: change counter %d %d %d - %d"), ElemIndex.X, ElemIndex.Y, ElemIndex.Z, ElemData.VStamp);
 	}
 
-	UdpSend(SendBuffer, EndPoint);
+	SendMessage(EndPoint, SendBuffer);
+
+	return true;
+}
+
+bool UTerrainServerComponent::SendMapDelta(const FIPv4Endpoint& EndPoint, int32 ClientMapVStamp) {
+	static uint32 OpCode = Net_Opcode_ResponseMapDelta;
+	static uint32 OpCodeExt = Net_Opcode_None;
+
+	FBufferArchive SendBuffer;
+	SendBuffer << OpCode;
+	SendBuffer << OpCodeExt;
+
+	if (!GetTerrainController()->NetworkSerializeMapDelta(SendBuffer, ClientMapVStamp)) {
+		return false;
+	}
+
+	UE_LOG(LogVt, Log, TEXT("Server: map delta from %d -> %d bytes"), ClientMapVStamp, SendBuffer.Num());
+
+	SendMessage(EndPoint, SendBuffer);
 
 	return true;
 }
@@ -132,9 +369,34 @@ void UTerrainServerComponent::HandleRcvData(const FIPv4Endpoint& EndPoint, FArra
 	//UE_LOG(LogVt, Log, TEXT("Server: %s   OpCode -> %d, OpCodeExt -> %d"), *Str, OpCode, OpCodeExt);
 
 	if (OpCode == Net_Opcode_RequestVd) {
-		TVoxelIndex Index = DeserializeVoxelIndex(Data);
+		TServerRequest Request;
+		Request.Index = DeserializeVoxelIndex(Data);
 		//UE_LOG(LogVt, Log, TEXT("Server: Client %s requests vd at %d %d %d"), *RemoteAddressString, Index.X, Index.Y, Index.Z);
-		SendVdByIndex(EndPoint, Index);
+		QueueRequest(EndPoint, Request);
+	} else if (OpCode == Net_Opcode_RequestVdDelta) {
+		TServerRequest Request;
+		Request.Index = DeserializeVoxelIndex(Data);
+		Data << Request.BaseVStamp;
+		QueueRequest(EndPoint, Request);
+	} else if (OpCode == Net_Opcode_RequestVdBatch) {
+		uint32 Count;
+		Data << Count;
+
+		for (uint32 I = 0; I < Count && !Data.AtEnd(); I++) {
+			TServerRequest Request;
+			Request.Index = DeserializeVoxelIndex(Data);
+			Data << Request.BaseVStamp;
+			QueueRequest(EndPoint, Request);
+		}
+	} else if (OpCode == Net_Opcode_ClientPosition) {
+		TVoxelIndex Index = DeserializeVoxelIndex(Data);
+		const std::lock_guard<std::mutex> Lock(ChannelMapMutex);
+		PositionMap.Add(EndPoint, Index);
+	} else if (OpCode == Net_Opcode_RequestPush) {
+		TVoxelIndex Center = DeserializeVoxelIndex(Data);
+		uint32 Radius;
+		Data << Radius;
+		StartPush(EndPoint, Center, Radius);
 	} else if (OpCode == Net_Opcode_RequestMapInfo) {
 		if (OpCodeExt == 1) {
 			uint32 ServerMapVStamp = GetTerrainController()->GetMapVStamp();
@@ -145,9 +407,11 @@ void UTerrainServerComponent::HandleRcvData(const FIPv4Endpoint& EndPoint, FArra
 			if (ServerMapVStamp != ClientMapVStamp) {
 				UE_LOG(LogVt, Log, TEXT("Server: remote host: %s, ServerMapVStamp = %d, ClientMapVStamp = %d "), *RemoteAddressStr, ServerMapVStamp, ClientMapVStamp);
 
-				//UE_LOG(LogVt, Log, TEXT("Server: Client %s requests map info"), *RemoteAddressString);
-				TArray<std::tuple<TVoxelIndex, TZoneModificationData>> Area = GetTerrainController()->NetworkServerMapInfo();
-				SendMapInfo(EndPoint, Area);
+				// whole map only if server change log does not reach client version
+				if (!SendMapDelta(EndPoint, ClientMapVStamp)) {
+					TArray<std::tuple<TVoxelIndex, TZoneModificationData>> Area = GetTerrainController()->NetworkServerMapInfo();
+					SendMapInfo(EndPoint, Area);
+				}
 			}
 
 		} else {
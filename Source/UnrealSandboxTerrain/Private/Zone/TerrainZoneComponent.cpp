@@ -61,7 +61,10 @@ void UTerrainZoneComponent::ApplyTerrainMesh(TMeshDataPtr MeshDataPtr, bool bIgn
 		}
 	}
 		
-	MainTerrainMesh->SetMeshData(MeshDataPtr);
+	// collision only mesh has no render sections: no scene proxy data and materials
+	if (!MeshDataPtr->bCollisionOnly) {
+		MainTerrainMesh->SetMeshData(MeshDataPtr);
+	}
 
 	if (!bIgnoreCollision) {
 		MainTerrainMesh->SetCollisionMeshData(MeshDataPtr);
@@ -181,6 +184,18 @@ void UTerrainZoneComponent::SpawnAll(const TInstanceMeshTypeMap& InstanceMeshMap
 	}
 }
 
+void UTerrainZoneComponent::ReplaceAll(const TInstanceMeshTypeMap& InstanceMeshMap) {
+	const std::lock_guard<std::mutex> lock(InstancedMeshMutex);
+	for (auto& Elem : InstancedMeshMap) {
+		Elem.Value->ClearInstances();
+	}
+
+	for (const auto& Elem : InstanceMeshMap) {
+		const TInstanceMeshArray& InstMeshTransArray = Elem.Value;
+		SpawnInstancedMesh(InstMeshTransArray.MeshType, InstMeshTransArray);
+	}
+}
+
 void SetCollisionTree(UTerrainInstancedStaticMesh* InstancedStaticMeshComponent) {
 	InstancedStaticMeshComponent->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 	InstancedStaticMeshComponent->SetCollisionResponseToChannel(ECollisionChannel::ECC_GameTraceChannel12, ECollisionResponse::ECR_Block);
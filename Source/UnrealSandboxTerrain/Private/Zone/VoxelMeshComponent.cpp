@@ -48,6 +48,7 @@ void UVoxelMeshComponent::SetMeshData(TMeshDataPtr NewMeshDataPtr) {
 	LocalMaterials.Empty();
 	LocalMaterials.Reserve(10);
 	MeshSectionLodArray.SetNum(LOD_ARRAY_SIZE);
+	LodMask = NewMeshDataPtr ? NewMeshDataPtr->LodMask : USBT_LOD_MASK_ALL;
 
 	if (NewMeshDataPtr) {
 		auto LodIndex = 0;
@@ -106,8 +107,8 @@ FBoxSphereBounds UVoxelMeshComponent::CalcBounds(const FTransform& LocalToWorld)
 void UVoxelMeshComponent::AddCollisionSection(struct FTriMeshCollisionData* CollisionData, const FProcMeshSection& MeshSection, const int32 MatId, const int32 VertexBase) {
 
 	// Copy vert data
-	for (int32 VertIdx = 0; VertIdx < MeshSection.ProcVertexBuffer.Num(); VertIdx++) {
-		TMeshVertex Vertex = MeshSection.ProcVertexBuffer[VertIdx];
+	for (int32 VertIdx = 0; VertIdx < MeshSection.GetVertexNum(); VertIdx++) {
+		const TMeshVertex& Vertex = MeshSection.GetVertex(VertIdx);
 
 #if ENGINE_MAJOR_VERSION == 5
 		CollisionData->Vertices.Add((FVector3f)Vertex.Pos);
@@ -145,6 +146,10 @@ bool UVoxelMeshComponent::GetPhysicsTriMeshData(struct FTriMeshCollisionData* Co
 	}
 
 	const TMeshLodSection& CollisionSection = CollisionLodSection;
+	if (bCollisionOnly) {
+		AddCollisionSection(CollisionData, CollisionSection.WholeMesh, 0, VertexBase);
+	}
+
 	for (const auto& Elem : CollisionSection.RegularMeshContainer.MaterialSectionMap) {
 		int32 MatId = (int32)Elem.Key;
 		const TMeshMaterialSection& MaterialSection = Elem.Value;
@@ -193,6 +198,10 @@ void UVoxelMeshComponent::UpdateLocalBounds() {
 
 
 bool UVoxelMeshComponent::ContainsPhysicsTriMeshData(bool InUseAllTriData) const {
+	if (bCollisionOnly) {
+		return CollisionLodSection.WholeMesh.ProcIndexBuffer.Num() > 0;
+	}
+
 	if (CollisionLodSection.RegularMeshContainer.MaterialSectionMap.Num() == 0) {
 		return false;
 	}
@@ -292,7 +301,15 @@ UBodySetup* UVoxelMeshComponent::GetBodySetup() {
 }
 
 void UVoxelMeshComponent::SetCollisionMeshData(TMeshDataPtr MeshDataPtr) {
-	CollisionLodSection = MeshSectionLodArray[0];
+	bCollisionOnly = MeshDataPtr && MeshDataPtr->bCollisionOnly;
+	if (bCollisionOnly) {
+		// mesh data isn't copied to render sections, whole mesh is taken directly
+		CollisionLodSection = TMeshLodSection();
+		CollisionLodSection.WholeMesh = *MeshDataPtr->CollisionMeshPtr;
+	} else {
+		CollisionLodSection = MeshSectionLodArray[MeshDataPtr ? MeshDataPtr->CollisionLod : 0];
+	}
+
 	//UpdateLocalBounds();
 	UpdateCollision();
 }
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <functional>
+#include <stdint.h>
+
+// Open addressing hash map: linear probing, backward shift deletion (no tombstones).
+// Keys and values are stored in one flat array. Capacity is power of two, max load factor is 3/4.
+// Hash value is mixed by multiplication, slot is taken from high bits.
+template <typename K, typename V, typename H = std::hash<K>>
+class TFlatMap {
+
+private:
+
+	std::vector<std::pair<K, V>> slot_array;
+	std::vector<uint8_t> used_array;
+	size_t count = 0;
+	size_t mask = 0;
+	int shift = 64;
+
+	size_t clcHomeSlot(const K& key) const {
+		return (size_t)(((uint64_t)H()(key) * 0x9E3779B97F4A7C15ull) >> shift);
+	}
+
+	// slot of key or first empty slot in probe sequence
+	size_t findSlot(const K& key) const {
+		size_t i = clcHomeSlot(key);
+		while (used_array[i] && !(slot_array[i].first == key)) {
+			i = (i + 1) & mask;
+		}
+
+		return i;
+	}
+
+	void rehash(size_t capacity) {
+		std::vector<std::pair<K, V>> old_slot_array;
+		std::vector<uint8_t> old_used_array;
+		old_slot_array.swap(slot_array);
+		old_used_array.swap(used_array);
+
+		int bits = 0;
+		while (((size_t)1 << bits) < capacity) {
+			bits++;
+		}
+
+		slot_array.resize((size_t)1 << bits);
+		used_array.assign((size_t)1 << bits, 0);
+		mask = ((size_t)1 << bits) - 1;
+		shift = 64 - bits;
+
+		for (size_t i = 0; i < old_used_array.size(); i++) {
+			if (old_used_array[i]) {
+				const size_t s = findSlot(old_slot_array[i].first);
+				slot_array[s] = std::move(old_slot_array[i]);
+				used_array[s] = 1;
+			}
+		}
+	}
+
+	void eraseSlot(size_t i) {
+		// shift following items of the same cluster back if hole is inside their probe sequence
+		size_t j = i;
+		while (true) {
+			j = (j + 1) & mask;
+			if (!used_array[j]) {
+				break;
+			}
+
+			const size_t k = clcHomeSlot(slot_array[j].first);
+			const bool bStay = (i < j) ? (i < k && k <= j) : (i < k || k <= j);
+			if (!bStay) {
+				slot_array[i] = std::move(slot_array[j]);
+				i = j;
+			}
+		}
+
+		slot_array[i] = std::pair<K, V>();
+		used_array[i] = 0;
+		count--;
+	}
+
+public:
+
+	template <typename P, typename T>
+	class TIterator {
+
+	private:
+		P* map;
+		size_t i;
+
+		void skipEmpty() {
+			while (i < map->used_array.size() && !map->used_array[i]) {
+				i++;
+			}
+		}
+
+	public:
+		TIterator(P* m, size_t idx) : map(m), i(idx) {
+			skipEmpty();
+		}
+
+		T& operator*() const {
+			return map->slot_array[i];
+		}
+
+		T* operator->() const {
+			return &map->slot_array[i];
+		}
+
+		TIterator& operator++() {
+			i++;
+			skipEmpty();
+			return *this;
+		}
+
+		bool operator==(const TIterator& other) const {
+			return i == other.i;
+		}
+
+		bool operator!=(const TIterator& other) const {
+			return i != other.i;
+		}
+	};
+
+	typedef TIterator<TFlatMap, std::pair<K, V>> iterator;
+	typedef TIterator<const TFlatMap, const std::pair<K, V>> const_iterator;
+
+	iterator begin() {
+		return iterator(this, 0);
+	}
+
+	iterator end() {
+		return iterator(this, used_array.size());
+	}
+
+	const_iterator begin() const {
+		return const_iterator(this, 0);
+	}
+
+	const_iterator end() const {
+		return const_iterator(this, used_array.size());
+	}
+
+	size_t size() const {
+		return count;
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	void reserve(size_t num) {
+		if (num * 4 > used_array.size() * 3) {
+			rehash(num * 4 / 3 + 1);
+		}
+	}
+
+	V* find(const K& key) {
+		if (count == 0) {
+			return nullptr;
+		}
+
+		const size_t i = findSlot(key);
+		return used_array[i] ? &slot_array[i].second : nullptr;
+	}
+
+	const V* find(const K& key) const {
+		return const_cast<TFlatMap*>(this)->find(key);
+	}
+
+	bool contains(const K& key) const {
+		return find(key) != nullptr;
+	}
+
+	// returns reference to existing or new default value
+	V& findOrAdd(const K& key) {
+		reserve(count + 1);
+
+		const size_t i = findSlot(key);
+		if (!used_array[i]) {
+			slot_array[i].first = key;
+			used_array[i] = 1;
+			count++;
+		}
+
+		return slot_array[i].second;
+	}
+
+	V& operator[](const K& key) {
+		return findOrAdd(key);
+	}
+
+	// returns false if key already exists, value is not changed
+	bool insert(const K& key, const V& val) {
+		reserve(count + 1);
+
+		const size_t i = findSlot(key);
+		if (used_array[i]) {
+			return false;
+		}
+
+		slot_array[i] = std::pair<K, V>(key, val);
+		used_array[i] = 1;
+		count++;
+		return true;
+	}
+
+	bool erase(const K& key) {
+		if (count == 0) {
+			return false;
+		}
+
+		const size_t i = findSlot(key);
+		if (!used_array[i]) {
+			return false;
+		}
+
+		eraseSlot(i);
+		return true;
+	}
+
+	void clear() {
+		slot_array.clear();
+		used_array.clear();
+		count = 0;
+		mask = 0;
+		shift = 64;
+	}
+};
+
+// Set on top of TFlatMap, iterates over keys
+template <typename K, typename H = std::hash<K>>
+class TFlatSet {
+
+private:
+
+	struct TEmpty { };
+
+	TFlatMap<K, TEmpty, H> map;
+
+public:
+
+	class const_iterator {
+
+	private:
+		typename TFlatMap<K, TEmpty, H>::const_iterator it;
+
+	public:
+		const_iterator(typename TFlatMap<K, TEmpty, H>::const_iterator i) : it(i) { }
+
+		const K& operator*() const {
+			return it->first;
+		}
+
+		const K* operator->() const {
+			return &it->first;
+		}
+
+		const_iterator& operator++() {
+			++it;
+			return *this;
+		}
+
+		bool operator==(const const_iterator& other) const {
+			return it == other.it;
+		}
+
+		bool operator!=(const const_iterator& other) const {
+			return it != other.it;
+		}
+	};
+
+	const_iterator begin() const {
+		return const_iterator(map.begin());
+	}
+
+	const_iterator end() const {
+		return const_iterator(map.end());
+	}
+
+	size_t size() const {
+		return map.size();
+	}
+
+	bool empty() const {
+		return map.empty();
+	}
+
+	void reserve(size_t num) {
+		map.reserve(num);
+	}
+
+	bool contains(const K& key) const {
+		return map.contains(key);
+	}
+
+	bool insert(const K& key) {
+		return map.insert(key, TEmpty());
+	}
+
+	bool erase(const K& key) {
+		return map.erase(key);
+	}
+
+	void clear() {
+		map.clear();
+	}
+};
@@ -2,6 +2,8 @@
 
 #include "EngineMinimal.h"
 #include "serialization.hpp"
+#include <algorithm>
+#include <cmath>
 
 /**
 *	Struct used to specify a tangent vector for a vertex
@@ -52,7 +54,55 @@ inline TMeshVertex operator / (const TMeshVertex& m, float k) {
 	return TMeshVertex{ m.Pos / k, m.Normal / k, -1 };
 }
 
+/** Stored vertex of compact mesh format: position quantized against section box, octahedral normal */
+struct TMeshVertexCompact {
+	uint16 Pos[3];
+	int16 Normal[2];
+	int16 MatIdx;
+};
+
+inline int16 QuantizeSnorm16(double V) {
+	return (int16)std::round(std::clamp(V, -1.0, 1.0) * 32767.0);
+}
+
+inline void EncodeOctNormal(const FVector& N, int16 Out[2]) {
+	const double L = std::abs(N.X) + std::abs(N.Y) + std::abs(N.Z);
+	if (L <= 0) {
+		Out[0] = 0;
+		Out[1] = 0;
+		return;
+	}
+
+	double X = N.X / L;
+	double Y = N.Y / L;
+	if (N.Z < 0) {
+		const double TX = (1 - std::abs(Y)) * (X >= 0 ? 1 : -1);
+		const double TY = (1 - std::abs(X)) * (Y >= 0 ? 1 : -1);
+		X = TX;
+		Y = TY;
+	}
+
+	Out[0] = QuantizeSnorm16(X);
+	Out[1] = QuantizeSnorm16(Y);
+}
+
+inline FVector DecodeOctNormal(const int16 In[2]) {
+	double X = In[0] / 32767.0;
+	double Y = In[1] / 32767.0;
+	const double Z = 1 - std::abs(X) - std::abs(Y);
+	if (Z < 0) {
+		const double TX = (1 - std::abs(Y)) * (X >= 0 ? 1 : -1);
+		const double TY = (1 - std::abs(X)) * (Y >= 0 ? 1 : -1);
+		X = TX;
+		Y = TY;
+	}
+
+	return FVector(X, Y, Z).GetSafeNormal();
+}
+
+
 
+typedef std::shared_ptr<const TArray<TMeshVertex>> TMeshVertexPoolPtr;
 
 /** One section of the procedural mesh. Each material has its own section. */
 class FProcMeshSection {
@@ -68,12 +118,28 @@ public:
 	/** Local bounding box of section */
 	FBox SectionLocalBox;
 
+	/** Source voxel cell (linear index) of each triangle. Optional, not serialized, used by partial remesh */
+	TArray<int32> ProcTriangleCellBuffer;
+
+	/** Source LOD0 grid edge of each vertex. Optional, not serialized, used by partial remesh */
+	TArray<uint64> ProcVertexEdgeBuffer;
+
+	/** Shared vertex pool of LOD. If set, ProcVertexBuffer is empty and local vertexes are taken from pool */
+	TMeshVertexPoolPtr VertexPoolPtr;
+
+	/** Pool index of each local vertex, used with VertexPoolPtr only */
+	TArray<uint32> ProcPoolIndexBuffer;
+
 	FProcMeshSection() : SectionLocalBox(EForceInit::ForceInitToZero)	{ }
 
 	/** Reset this section, clear all mesh info. */
 	void Reset() {
 		ProcVertexBuffer.Empty();
 		ProcIndexBuffer.Empty();
+		ProcTriangleCellBuffer.Empty();
+		ProcVertexEdgeBuffer.Empty();
+		VertexPoolPtr = nullptr;
+		ProcPoolIndexBuffer.Empty();
 		SectionLocalBox.Init();
 	}
 
@@ -81,9 +147,21 @@ public:
 		Reset();
 		ProcVertexBuffer = A.ProcVertexBuffer;
 		ProcIndexBuffer = A.ProcIndexBuffer;
+		ProcTriangleCellBuffer = A.ProcTriangleCellBuffer;
+		ProcVertexEdgeBuffer = A.ProcVertexEdgeBuffer;
+		VertexPoolPtr = A.VertexPoolPtr;
+		ProcPoolIndexBuffer = A.ProcPoolIndexBuffer;
 		SectionLocalBox = A.SectionLocalBox;
 	}
 
+	int32 GetVertexNum() const {
+		return VertexPoolPtr ? ProcPoolIndexBuffer.Num() : ProcVertexBuffer.Num();
+	}
+
+	const TMeshVertex& GetVertex(int32 Idx) const {
+		return VertexPoolPtr ? (*VertexPoolPtr)[ProcPoolIndexBuffer[Idx]] : ProcVertexBuffer[Idx];
+	}
+
 	void AddVertex(const TMeshVertex& Vertex) {
 		ProcVertexBuffer.Add(Vertex);
 		SectionLocalBox += Vertex.Pos;
@@ -102,7 +180,7 @@ public:
 	void SerializeMesh(usbt::TFastUnsafeSerializer& Serializer) const {
 		// vertexes
 		TMeshParamData D;
-		D.VertexNum = ProcVertexBuffer.Num();
+		D.VertexNum = GetVertexNum();
 		D.MaxX = SectionLocalBox.Max.X;
 		D.MaxY = SectionLocalBox.Max.Y;
 		D.MaxZ = SectionLocalBox.Max.Z;
@@ -110,32 +188,199 @@ public:
 		D.MinY = SectionLocalBox.Min.Y;
 		D.MinZ = SectionLocalBox.Min.Z;
 		Serializer << D;
-		for (auto& Vertex : ProcVertexBuffer) {	Serializer << Vertex; }
+		for (int32 Idx = 0; Idx < D.VertexNum; Idx++) { Serializer << GetVertex(Idx); }
 
 		// indexes
 		Serializer << ProcIndexBuffer.Num();
 		for (int32 Index : ProcIndexBuffer) { Serializer << Index; }
 	}
 
-	void DeserializeMeshFast(usbt::TFastUnsafeDeserializer& Deserializer) {
+	// every read is checked against End, false if data is broken
+	bool DeserializeMeshFast(usbt::TFastUnsafeDeserializer& Deserializer, const uint8* End) {
+		if (Deserializer.available(End) < sizeof(TMeshParamData)) {
+			return false;
+		}
+
 		int32 VertexNum;
 		Deserializer.readObj(VertexNum);
 
 		float Min[3];
 		float Max[3];
 
-		Deserializer.read(&Min[0], 3);
+		// same order as TMeshParamData
 		Deserializer.read(&Max[0], 3);
+		Deserializer.read(&Min[0], 3);
+
+		if (VertexNum < 0 || (size_t)VertexNum > Deserializer.available(End) / sizeof(TMeshVertex)) {
+			return false;
+		}
 
+		VertexPoolPtr = nullptr;
+		ProcPoolIndexBuffer.Empty();
 		ProcVertexBuffer.SetNum(VertexNum);
 		Deserializer.read(ProcVertexBuffer.GetData(), VertexNum);
 
 		int32 IndexNum;
+		if (Deserializer.available(End) < sizeof(IndexNum)) {
+			return false;
+		}
+
 		Deserializer.readObj(IndexNum);
+		if (IndexNum < 0 || (size_t)IndexNum > Deserializer.available(End) / sizeof(uint32)) {
+			return false;
+		}
+
 		ProcIndexBuffer.SetNum(IndexNum);
 		Deserializer.read(ProcIndexBuffer.GetData(), IndexNum);
+		if (!IsValidIndexBuffer(VertexNum)) {
+			return false;
+		}
+
+		FBox Box(FVector(Min[0], Min[1], Min[2]), FVector(Max[0], Max[1], Max[2]));
+		SectionLocalBox = Box;
+		return true;
+	}
+
+	// compact format: 16-bit positions against section box, octahedral normals, 16-bit indexes if possible
+	void SerializeMeshCompact(usbt::TFastUnsafeSerializer& Serializer) const {
+		TMeshParamData D;
+		D.VertexNum = GetVertexNum();
+		D.MaxX = SectionLocalBox.Max.X;
+		D.MaxY = SectionLocalBox.Max.Y;
+		D.MaxZ = SectionLocalBox.Max.Z;
+		D.MinX = SectionLocalBox.Min.X;
+		D.MinY = SectionLocalBox.Min.Y;
+		D.MinZ = SectionLocalBox.Min.Z;
+		Serializer << D;
+
+		// quantize against stored (float) box, exactly as it is restored
+		const double Min[3] = { D.MinX, D.MinY, D.MinZ };
+		const double Max[3] = { D.MaxX, D.MaxY, D.MaxZ };
+		double Scale[3];
+		for (int I = 0; I < 3; I++) {
+			Scale[I] = (Max[I] > Min[I]) ? 65535.0 / (Max[I] - Min[I]) : 0;
+		}
+
+		std::vector<TMeshVertexCompact> VertexArray(D.VertexNum);
+		for (int32 Idx = 0; Idx < D.VertexNum; Idx++) {
+			const TMeshVertex& Vertex = GetVertex(Idx);
+			TMeshVertexCompact& Compact = VertexArray[Idx];
+			const double P[3] = { Vertex.Pos.X, Vertex.Pos.Y, Vertex.Pos.Z };
+			for (int I = 0; I < 3; I++) {
+				Compact.Pos[I] = (uint16)std::clamp(std::round((P[I] - Min[I]) * Scale[I]), 0.0, 65535.0);
+			}
+
+			EncodeOctNormal(Vertex.Normal, Compact.Normal);
+			Compact.MatIdx = (int16)Vertex.MatIdx;
+		}
+
+		Serializer.write(VertexArray.data(), VertexArray.size());
+
+		const int32 IndexNum = ProcIndexBuffer.Num();
+		const uint8 IndexSize = (D.VertexNum <= 0x10000) ? sizeof(uint16) : sizeof(uint32);
+		Serializer << IndexNum;
+		Serializer << IndexSize;
+		if (IndexSize == sizeof(uint16)) {
+			std::vector<uint16> IndexArray(IndexNum);
+			for (int32 Idx = 0; Idx < IndexNum; Idx++) {
+				IndexArray[Idx] = (uint16)ProcIndexBuffer[Idx];
+			}
+
+			Serializer.write(IndexArray.data(), IndexArray.size());
+		} else {
+			Serializer.write(ProcIndexBuffer.GetData(), IndexNum);
+		}
+	}
+
+	// every read is checked against End, false if data is broken
+	bool DeserializeMeshCompact(usbt::TFastUnsafeDeserializer& Deserializer, const uint8* End) {
+		if (Deserializer.available(End) < sizeof(TMeshParamData)) {
+			return false;
+		}
+
+		int32 VertexNum;
+		Deserializer.readObj(VertexNum);
+
+		float Min[3];
+		float Max[3];
+
+		// same order as TMeshParamData
+		Deserializer.read(&Max[0], 3);
+		Deserializer.read(&Min[0], 3);
+
+		double Step[3];
+		for (int I = 0; I < 3; I++) {
+			Step[I] = ((double)Max[I] - Min[I]) / 65535.0;
+		}
+
+		if (VertexNum < 0 || (size_t)VertexNum > Deserializer.available(End) / sizeof(TMeshVertexCompact)) {
+			return false;
+		}
+
+		VertexPoolPtr = nullptr;
+		ProcPoolIndexBuffer.Empty();
+		ProcVertexBuffer.SetNum(VertexNum);
+		const uint8* Src = Deserializer.current();
+		for (int32 Idx = 0; Idx < VertexNum; Idx++) {
+			TMeshVertexCompact Compact;
+			memcpy(&Compact, Src + Idx * sizeof(TMeshVertexCompact), sizeof(TMeshVertexCompact));
+
+			TMeshVertex& Vertex = ProcVertexBuffer[Idx];
+			Vertex.Pos = FVector(Min[0] + Compact.Pos[0] * Step[0], Min[1] + Compact.Pos[1] * Step[1], Min[2] + Compact.Pos[2] * Step[2]);
+			Vertex.Normal = DecodeOctNormal(Compact.Normal);
+			Vertex.MatIdx = Compact.MatIdx;
+		}
+
+		Deserializer.skip(VertexNum * sizeof(TMeshVertexCompact));
+
+		int32 IndexNum;
+		uint8 IndexSize;
+		if (Deserializer.available(End) < sizeof(IndexNum) + sizeof(IndexSize)) {
+			return false;
+		}
+
+		Deserializer.readObj(IndexNum);
+		Deserializer.readObj(IndexSize);
+		if ((IndexSize != sizeof(uint16) && IndexSize != sizeof(uint32)) || IndexNum < 0 || (size_t)IndexNum > Deserializer.available(End) / IndexSize) {
+			return false;
+		}
+
+		ProcIndexBuffer.SetNum(IndexNum);
+		if (IndexSize == sizeof(uint16)) {
+			const uint8* IndexSrc = Deserializer.current();
+			for (int32 Idx = 0; Idx < IndexNum; Idx++) {
+				uint16 Index;
+				memcpy(&Index, IndexSrc + Idx * sizeof(uint16), sizeof(uint16));
+				ProcIndexBuffer[Idx] = Index;
+			}
+
+			Deserializer.skip(IndexNum * sizeof(uint16));
+		} else {
+			Deserializer.read(ProcIndexBuffer.GetData(), IndexNum);
+		}
+
+		if (!IsValidIndexBuffer(VertexNum)) {
+			return false;
+		}
 
 		FBox Box(FVector(Min[0], Min[1], Min[2]), FVector(Max[0], Max[1], Max[2]));
 		SectionLocalBox = Box;
+		return true;
+	}
+
+private:
+
+	bool IsValidIndexBuffer(int32 VertexNum) const {
+		if (ProcIndexBuffer.Num() % 3 != 0) {
+			return false;
+		}
+
+		for (uint32 Index : ProcIndexBuffer) {
+			if (Index >= (uint32)VertexNum) {
+				return false;
+			}
+		}
+
+		return true;
 	}
 };
\ No newline at end of file
@@ -12,6 +12,9 @@ struct TSpawnZoneParam {
 
 	TVoxelIndex Index;
 
+	// LODs to mesh new zone with, bit per LOD. missed LODs are extracted on demand
+	uint32 LodMask = 0xffffffff;
+
 };
 
 UENUM(BlueprintType)
@@ -37,6 +37,8 @@ class ASandboxTerrainNetProxy;
 
 class TThreadPool;
 class TConveyour;
+enum class TTaskPriority : uint8;
+enum class TConveyorTaskClass : uint8;
 
 struct TFileItmKey;
 
@@ -44,6 +46,15 @@ typedef TMap<uint64, TInstanceMeshArray> TInstanceMeshTypeMap;
 typedef std::shared_ptr<TMeshData> TMeshDataPtr;
 
 
+// compression of voxel and mesh data blobs
+UENUM(BlueprintType)
+enum class ESandboxTerrainDataCodec : uint8 {
+	None = 0	UMETA(DisplayName = "None"),
+	Zlib = 1	UMETA(DisplayName = "Zlib"),
+	LZ4 = 2		UMETA(DisplayName = "LZ4 (fast)"),
+	Oodle = 3	UMETA(DisplayName = "Oodle (dense)"),
+};
+
 USTRUCT()
 struct FMapInfo {
 	GENERATED_BODY()
@@ -88,6 +99,16 @@ struct FTerrainDebugInfo {
 
 	UPROPERTY()
 	int CountZones = 0;
+
+	// per conveyor task class, latency in ms
+	UPROPERTY()
+	TArray<int> ConveyorClassSize;
+
+	UPROPERTY()
+	TArray<float> ConveyorClassLatency;
+
+	UPROPERTY()
+	TArray<float> ConveyorClassMaxLatency;
 };
 
 USTRUCT()
@@ -220,6 +241,7 @@ enum class TZoneFlag : uint32 {
 	NoMesh = 1,
 	NoVoxelData = 2,
 	InternalSolid = 3,
+	CollisionOnlyMesh = 4,
 };
 
 typedef struct TKvFileZoneData {
@@ -231,6 +253,14 @@ struct TZoneModificationData {
 	uint32 VStamp = 0;
 };
 
+// received zone after decompression, see NetworkDecompressClientZone
+struct TClientZonePayload {
+	int32 State = 0;
+	int32 VStamp = 0;
+	TDataPtr VdData = nullptr; // decompressed voxel data
+	TData ObjData;
+};
+
 struct TInstantMeshData {
 	float X;
 	float Y;
@@ -264,7 +294,7 @@ namespace std {
 	template <>
 	struct hash<TFileItmKey> {
 		std::size_t operator()(const TFileItmKey& Key) const {
-			return hash<short>()(Key.Index.X) ^ hash<short>()(Key.Index.Y) ^ hash<short>()(Key.Index.Z) ^ hash<short>()(Key.Type);
+			return (std::size_t)(ClcVoxelIndexHash(Key.Index) ^ ((uint64)Key.Type * 0x9E3779B97F4A7C15ull));
 		}
 	};
 }
@@ -314,6 +344,18 @@ public:
 
 	UPROPERTY(EditAnywhere, Category = "UnrealSandbox Terrain General")
 	double ConveyorMaxTime = 0.05;
+
+	// 0 - one thread per CPU core
+	UPROPERTY(EditAnywhere, Category = "UnrealSandbox Terrain General")
+	int32 ThreadPoolSize = 0;
+
+	// codec of saved voxel and mesh data. maps saved before format version 1 are always zlib
+	UPROPERTY(EditAnywhere, Category = "UnrealSandbox Terrain General")
+	ESandboxTerrainDataCodec DataCodec = ESandboxTerrainDataCodec::LZ4;
+
+	// new maps store meshes with 16-bit quantized positions, octahedral normals and 16-bit indexes
+	UPROPERTY(EditAnywhere, Category = "UnrealSandbox Terrain General")
+	bool bCompactMeshData = true;
               
 	//========================================================================================
 	// LOD
@@ -322,6 +364,11 @@ public:
 	UPROPERTY(EditAnywhere, Category = "UnrealSandbox Terrain LOD")
 	float LodRatio = .5f;
 
+	// number of LODs new zone is meshed with, around LOD expected at zone distance from player. other LODs are meshed when zone shows them first time
+	// 0 - all LODs
+	UPROPERTY(EditAnywhere, Category = "UnrealSandbox Terrain LOD")
+	int32 LodGenerationRange = 3;
+
     //========================================================================================
     // Dynamic area streaming
     //========================================================================================
@@ -378,6 +425,10 @@ public:
     UPROPERTY(EditAnywhere, Category = "UnrealSandbox Terrain Network")
     uint32 ServerPort;
 
+	// send rate limit of each client, KB/s. 0 - not limited
+	UPROPERTY(EditAnywhere, Category = "UnrealSandbox Terrain Network")
+	uint32 ServerClientRate = 1024;
+
 	//========================================================================================
 
 	UPROPERTY()
@@ -465,7 +516,10 @@ public:
 	// async tasks
 	//===============================================================================
 
-	void AddAsyncTask(std::function<void()> Function);
+	void AddAsyncTask(std::function<void()> Function, TTaskPriority Priority);
+
+	// called by zone scene proxy (render thread) if selected LOD is not meshed
+	void RequestZoneLod(const TVoxelIndex& ZoneIndex, int32 LodIndex);
 
 	//========================================================================================
 	// network
@@ -475,7 +529,24 @@ public:
 
 	void NetworkSerializeZone(FBufferArchive& Buffer, const TVoxelIndex& VoxelIndex);
 
-	void NetworkSpawnClientZone(const TVoxelIndex& Index, FArrayReader& RawVdData);
+	bool NetworkDecompressClientZone(const TVoxelIndex& Index, FArchive& Data, TClientZonePayload& Payload);
+
+	void NetworkSpawnClientZone(const TVoxelIndex& Index, TClientZonePayload& Payload);
+
+	bool NetworkSerializeZoneDelta(FBufferArchive& Buffer, const TVoxelIndex& Index, int32 BaseVStamp);
+
+	void NetworkApplyClientZoneDelta(const TVoxelIndex& Index, FArchive& Data);
+
+	int32 NetworkClientZoneBaseVStamp(const TVoxelIndex& Index);
+
+	TArray<TVoxelIndex> NetworkServerPushList(const TVoxelIndex& Center, uint32 Radius);
+
+	void NetworkClientBeginInitialLoad(const TVoxelIndex& Center, const TArray<TVoxelIndex>& ZoneList);
+
+	TVoxelIndex GetLocalPlayerZoneIndex();
+
+	// lower is sent first: distance to client zone, recently edited zones are closer
+	int32 NetworkServerZonePriority(const TVoxelIndex& Index, const TVoxelIndex& ClientIndex);
 
 	float ClcGroundLevel(const FVector& V);
 
@@ -572,9 +643,14 @@ private:
 	
 	void SpawnInitialZone();
 
-	TDataPtr SerializeVd(TVoxelData* Vd) const;
+	TDataPtr CompressData(TDataPtr Data, uint32 FormatVersion) const;
+
+	TDataPtr DecompressData(const uint8* Data, size_t Size, uint32 FormatVersion) const;
+
+	// network always uses current format, terrain file - format of map
+	TDataPtr SerializeVd(TVoxelData* Vd, uint32 FormatVersion = USBT_MAP_FORMAT_VERSION) const;
 
-	void DeserializeVd(TDataPtr Data, TVoxelData* Vd) const;
+	bool DeserializeVd(TDataPtr Data, TVoxelData* Vd, uint32 FormatVersion = USBT_MAP_FORMAT_VERSION) const;
 
 	void DeserializeInstancedMeshes(std::vector<uint8>& Data, TInstanceMeshTypeMap& ZoneInstMeshMap) const;
 
@@ -584,7 +660,7 @@ private:
 
 	TConveyour* Conveyor;
 
-	void AddTaskToConveyor(std::function<void()> Function);
+	void AddTaskToConveyor(std::function<void()> Function, TConveyorTaskClass TaskClass);
 
 	void ExecGameThreadZoneApplyMesh(const TVoxelIndex& Index, UTerrainZoneComponent* Zone, TMeshDataPtr MeshDataPtr);
 
@@ -678,6 +754,9 @@ private:
 
 	TArray<std::tuple<TVoxelIndex, TZoneModificationData>> NetworkServerMapInfo();
 
+	// false if server has no history since client map version
+	bool NetworkSerializeMapDelta(FBufferArchive& Buffer, int32 ClientMapVStamp);
+
 	void OnReceiveServerMapInfo(const TMap<TVoxelIndex, TZoneModificationData>& ServerDataMap);
 
 	FTimerHandle TimerPingServer;
@@ -740,7 +819,17 @@ protected:
 	// voxel data storage
 	//===============================================================================
 
-	std::shared_ptr<TMeshData> GenerateMesh(TVoxelData* Vd);
+	bool IsCollisionOnlyMeshing() const;
+
+	bool IsZoneDeltaLogEnabled() const;
+
+	std::shared_ptr<TMeshData> GenerateMesh(TVoxelData* Vd, uint32 LodMask = USBT_LOD_MASK_ALL);
+
+	uint32 ClcZoneLodMask(const TVoxelIndex& ZoneIndex, const TVoxelIndex& ViewerIndex) const;
+
+	void GenerateZoneLod(const TVoxelIndex& ZoneIndex, uint32 LodMask);
+
+	std::shared_ptr<TMeshData> GenerateEditMesh(TVoxelData* Vd, std::shared_ptr<TMeshData> BaseMeshDataPtr);
 
 	//===============================================================================
 	// NewVoxelData
@@ -5,6 +5,8 @@
 #include "EngineMinimal.h"
 #include "TerrainNetworkCommon.h"
 #include "Tasks/Task.h"
+#include <mutex>
+#include <deque>
 #include "TerrainClientComponent.generated.h"
 
 
@@ -29,7 +31,17 @@ public:
 
 public:
 
-	void RequestVoxelData(const TVoxelIndex& Index);
+	// changes only if client has voxel data of zone, unless bFull
+	void RequestVoxelData(const TVoxelIndex& Index, bool bFull = false);
+
+	// one message per USBT_NET_BATCH_SIZE zones
+	void RequestVoxelDataBatch(const TArray<TVoxelIndex>& IndexList);
+
+	// server sends changed zones around center in spiral order
+	void RequestPush(const TVoxelIndex& Center, uint32 Radius);
+
+	// server sends zones nearest to player first
+	void SendPosition(const TVoxelIndex& Index);
 
 	void RequestMapInfo();
 
@@ -43,13 +55,48 @@ private:
 
 	TSharedPtr<FInternetAddr> RemoteAddr;
 
+	std::shared_ptr<TNetChannel> Channel;
+
 	UE::Tasks::FTask ClientLoopTask;
 
 	void HandleRcvData(FArrayReader& Data);
 
 	void HandleResponseVd(FArrayReader& Data);
 
+	void HandleResponseVdDelta(FArrayReader& Data);
+
+	void HandleResponseMapDelta(FArrayReader& Data);
+
+	// received zone message waiting for decode
+	struct TDecodeItem {
+		uint32 OpCode;
+		TVoxelIndex Index;
+		TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> Payload;
+	};
+
+	struct TDecodeState {
+		std::mutex Mutex;
+		std::deque<TDecodeItem> Queue;
+		TSet<TVoxelIndex> ZoneSet; // zones which are being decoded
+	};
+
+	// shared with decode tasks, they can finish after component is destroyed
+	std::shared_ptr<TDecodeState> DecodeState;
+
+	void QueueDecode(uint32 OpCode, const TVoxelIndex& Index, FArrayReader& Data);
+
+	// start decode tasks, messages of one zone are decoded in order they are received.
+	// zone message is decompressed by one task, then deserialized and meshed by other
+	void DispatchDecode();
+
+	bool IsDecodeQueueFull();
+
+	void SendMessage(const FBufferArchive& SendBuffer);
+
 	void RcvThreadLoop();
 
+	// reused by receive thread for every datagram
+	TArray<uint8> RcvBuffer;
+
 	int32 StoredVStamp = 0;
 };
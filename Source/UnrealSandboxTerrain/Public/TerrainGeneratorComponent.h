@@ -8,6 +8,7 @@
 #include "TerrainChunk.h"
 #include "TerrainRegion.h"
 #include "SandboxTerrainCommon.h"
+#include "FlatMap.h"
 #include <unordered_map>
 #include <vector>
 #include <mutex>
@@ -330,11 +331,7 @@ private:
 
 	std::mutex ChunkDataMapMutex;
 
-#ifdef __cpp_lib_atomic_shared_ptr                      
-	std::unordered_map<TVoxelIndex, std::atomic<TChunkDataPtr>> ChunkDataCollection;
-#else
-	std::unordered_map<TVoxelIndex, TChunkDataPtr> ChunkDataCollection;
-#endif
+	TFlatMap<TVoxelIndex, TChunkDataPtr> ChunkDataCollection;
 
 	TChunkDataPtr GetChunkData(int X, int Y);
 
@@ -9,6 +9,7 @@
 #include "Networking.h"
 #include "Net/UnrealNetwork.h"
 #include "VoxelIndex.h"
+#include <memory>
 #include "TerrainNetworkCommon.generated.h"
 
 
@@ -16,14 +17,39 @@
 
 #define Net_Opcode_RequestVd			10
 #define Net_Opcode_RequestMapInfo		11
+#define Net_Opcode_RequestVdDelta		12	// zone changes since client VStamp, server answers ResponseVd if history is not available
+#define Net_Opcode_RequestVdBatch		13	// list of zones with client VStamps, each one is answered as RequestVd or RequestVdDelta
+#define Net_Opcode_RequestPush			14	// server sends changed zones around client position without further requests
+#define Net_Opcode_ClientPosition		15	// zone of client player, server sends nearest zones first
 
 #define Net_Opcode_ResponseVd			100
 #define Net_Opcode_ResponseMapInfo		101
+#define Net_Opcode_ResponseVdDelta		102
+#define Net_Opcode_ResponseMapDelta		103	// zones changed since client map version
+
+// opcodes 200, 201 are datagrams of reliable channel which carries messages above, see TNetChannel
+
+#define USBT_NET_FRAGMENT_SIZE			1200	// message bytes per datagram, below usual path MTU
+#define USBT_NET_SEND_WINDOW			128		// fragments in flight per remote host
+#define USBT_NET_CHANNEL_TIMEOUT		60		// seconds without datagrams before server drops client channel
+#define USBT_NET_BATCH_SIZE				64		// zones per batch request
+#define USBT_NET_PUSH_WINDOW			8		// pushed zones not yet acknowledged by client
+#define USBT_NET_SERVER_WORKERS			4		// server threads which serialize and send zones
+#define USBT_NET_REQUEST_QUEUE_SIZE		8192	// queued zone requests of all clients
+#define USBT_NET_CLIENT_QUEUE_SIZE		1024	// queued zone requests of one client
+#define USBT_NET_DECODE_QUEUE_SIZE		256		// received zones waiting for decode on client, socket is not read while queue is full
+#define USBT_NET_DECODE_TASKS			8		// zones decoded by client in parallel
+#define USBT_NET_CLIENT_BURST			(64 * 1024)	// bytes client channel can send at once, see ServerClientRate
+#define USBT_NET_RECENT_EDIT_TIME		30		// seconds, recently edited zones are sent before others at the same distance
+#define USBT_NET_RECENT_EDIT_BONUS		4		// zones of distance
+#define USBT_NET_STAT_INTERVAL			10		// seconds between client channel statistics in log
+#define USBT_NET_MAX_DATAGRAM_SIZE		65536	// receive buffer, not less than max UDP payload
 
 
 
 
 class ASandboxTerrainController;
+class TNetChannel;
 
 /**
 *
@@ -45,6 +71,10 @@ protected:
 
 	int32 UdpSend(FBufferArchive SendBuffer, const FInternetAddr& Addr);
 
+	int32 UdpSend(const uint8* Data, int32 Size, const FInternetAddr& Addr);
+
+	std::shared_ptr<TNetChannel> NewChannel(TSharedRef<FInternetAddr> Addr);
+
 };
 
 
@@ -5,9 +5,11 @@
 #include "EngineMinimal.h"
 #include "TerrainNetworkCommon.h"
 #include "SandboxTerrainCommon.h"
+#include "Tasks/Task.h"
 //#include "Interfaces/IPv4/IPv4Endpoint.h"
 //#include "Common/TcpListener.h"
-//#include <mutex>
+#include <mutex>
+#include <atomic>
 #include "TerrainServerComponent.generated.h"
 
 
@@ -15,6 +17,9 @@
 class ASandboxTerrainController;
 struct TZoneModificationData;
 
+template <typename C, typename R>
+class TFairRequestQueue;
+
 
 /**
 *
@@ -40,8 +45,68 @@ private:
 
 	bool SendVdByIndex(const FIPv4Endpoint& EndPoint, const TVoxelIndex& VoxelIndex);
 
+	bool SendVdDeltaByIndex(const FIPv4Endpoint& EndPoint, const TVoxelIndex& VoxelIndex, int32 BaseVStamp);
+
 	bool SendMapInfo(const FIPv4Endpoint& EndPoint, TArray<std::tuple<TVoxelIndex, TZoneModificationData>> Area);
 
+	bool SendMapDelta(const FIPv4Endpoint& EndPoint, int32 ClientMapVStamp);
+
+	void SendMessage(const FIPv4Endpoint& EndPoint, const FBufferArchive& SendBuffer);
+
+	std::shared_ptr<TNetChannel> GetOrCreateChannel(const FIPv4Endpoint& EndPoint);
+
+	void ChannelThreadLoop();
+
+	void StartPush(const FIPv4Endpoint& EndPoint, const TVoxelIndex& Center, uint32 Radius);
+
+	// queue pushed zones which fit client window
+	void QueuePushZones();
+
+	struct TServerRequest {
+		TVoxelIndex Index;
+		int32 BaseVStamp = -1; // whole zone if < 0
+		bool bPush = false;
+
+		bool operator==(const TServerRequest& Other) const {
+			return Index == Other.Index && BaseVStamp == Other.BaseVStamp && bPush == Other.bPush;
+		}
+	};
+
+	void QueueRequest(const FIPv4Endpoint& EndPoint, const TServerRequest& Request);
+
+	// ChannelMapMutex should be locked
+	int32 GetRequestPriority(const FIPv4Endpoint& EndPoint, const TVoxelIndex& Index);
+
+	void LogChannelStat();
+
+	double LastStatTime = 0;
+
+	void WorkerThreadLoop();
+
+	std::shared_ptr<TFairRequestQueue<FIPv4Endpoint, TServerRequest>> RequestQueue;
+
+	TArray<UE::Tasks::FTask> WorkerTaskList;
+
+	std::mutex ChannelMapMutex;
+
+	TMap<FIPv4Endpoint, std::shared_ptr<TNetChannel>> ChannelMap;
+
+	struct TPushState {
+		TArray<TVoxelIndex> ZoneList;
+		int32 Next = 0;
+		int32 InQueue = 0;
+	};
+
+	// guarded by ChannelMapMutex
+	TMap<FIPv4Endpoint, TPushState> PushMap;
+
+	// last known zone of client player, guarded by ChannelMapMutex
+	TMap<FIPv4Endpoint, TVoxelIndex> PositionMap;
+
+	UE::Tasks::FTask ChannelLoopTask;
+
+	std::atomic<bool> bChannelLoop{ false };
+
 	//std::mutex Mutex;
 
 	//TMap<uint32, FSocket*> ClientMap;
@@ -72,6 +72,9 @@ public:
 
 	void SpawnAll(const TInstanceMeshTypeMap& InstanceMeshMap);
 
+	// remove all instances, then spawn
+	void ReplaceAll(const TInstanceMeshTypeMap& InstanceMeshMap);
+
 	void SpawnInstancedMesh(const FTerrainInstancedMeshType& MeshType, const TInstanceMeshArray& InstMeshTransArray);
 
     TDataPtr SerializeAndResetObjectData();
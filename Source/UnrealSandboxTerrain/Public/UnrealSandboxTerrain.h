@@ -5,6 +5,7 @@
 #include "Modules/ModuleManager.h"
 
 #define LOD_ARRAY_SIZE				6	//7
+#define USBT_LOD_MASK_ALL			((1u << LOD_ARRAY_SIZE) - 1)
 #define USBT_ZONE_SIZE				1000.f
 //#define USBT_ZONE_DIMENSION			65
 
@@ -12,6 +13,25 @@
 
 #define USBT_ENABLE_LOD true
 
+// terrain file format. 0 - zlib archive blobs, 1 - blobs with codec byte, 2 - compact (quantized) mesh blobs
+#define USBT_MAP_FORMAT_VERSION		2
+
+#define USBT_MAP_FORMAT_CODEC			1
+#define USBT_MAP_FORMAT_COMPACT_MESH	2
+
+// edit history kept by server to send clients changed voxels only, see TZoneDeltaLog
+#define USBT_NET_DELTA_LOG_SIZE		(64 * 1024 * 1024)
+#define USBT_NET_DELTA_ZONE_SIZE	(64 * 1024)
+
+// encoded stored zones kept by server for network requests, see TZonePayloadCache
+#define USBT_NET_ZONE_CACHE_SIZE	(128 * 1024 * 1024)
+
+// recently edited zones which keep last edit mesh as base of partial remesh, see TEditMeshCache
+#define USBT_EDIT_MESH_CACHE_SIZE	64
+
+// zone changes kept by server to send clients map info changes only, see TMapVersionLog
+#define USBT_NET_MAP_LOG_SIZE		(256 * 1024)
+
 DECLARE_LOG_CATEGORY_EXTERN(LogVt, Log, All);
 
 
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+
+#define VD_BRICK_SHIFT		3
+#define VD_BRICK_SIZE		(1 << VD_BRICK_SHIFT)
+#define VD_BRICK_MASK		(VD_BRICK_SIZE - 1)
+#define VD_BRICK_VOLUME		(VD_BRICK_SIZE * VD_BRICK_SIZE * VD_BRICK_SIZE)
+
+// Voxel volume split to 8x8x8 bricks.
+// Each brick is uniform (one value, nothing allocated) or dense (VD_BRICK_VOLUME values, z is the fastest axis).
+// dense_mask has one bit per brick: set if brick is dense.
+template <typename T>
+class TVoxelBrickArray {
+
+private:
+	int voxel_num = 0;
+	int brick_num = 0;
+	int dense_count = 0;
+
+	std::vector<T> uniform_data;
+	std::vector<std::unique_ptr<T[]>> dense_data;
+	std::vector<uint64_t> dense_mask;
+
+	static int clcLocalIndex(int x, int y, int z) {
+		return ((x & VD_BRICK_MASK) << (VD_BRICK_SHIFT * 2)) | ((y & VD_BRICK_MASK) << VD_BRICK_SHIFT) | (z & VD_BRICK_MASK);
+	}
+
+	T* makeDense(int b) {
+		T* data = new T[VD_BRICK_VOLUME];
+		std::fill(data, data + VD_BRICK_VOLUME, uniform_data[b]);
+		dense_data[b].reset(data);
+		dense_mask[b >> 6] |= (1ull << (b & 63));
+		dense_count++;
+		return data;
+	}
+
+	void makeUniform(int b, T val) {
+		uniform_data[b] = val;
+		dense_data[b].reset();
+		dense_mask[b >> 6] &= ~(1ull << (b & 63));
+		dense_count--;
+	}
+
+public:
+
+	void init(int num, T val) {
+		voxel_num = num;
+		brick_num = (num + VD_BRICK_MASK) >> VD_BRICK_SHIFT;
+		dense_count = 0;
+
+		const int total = brick_num * brick_num * brick_num;
+		uniform_data.assign(total, val);
+		dense_data.clear();
+		dense_data.resize(total);
+		dense_mask.assign((total + 63) >> 6, 0);
+	}
+
+	void clear() {
+		voxel_num = 0;
+		brick_num = 0;
+		dense_count = 0;
+		uniform_data = std::vector<T>();
+		dense_data = std::vector<std::unique_ptr<T[]>>();
+		dense_mask = std::vector<uint64_t>();
+	}
+
+	bool isInitialized() const {
+		return brick_num > 0;
+	}
+
+	int brickNum() const {
+		return brick_num;
+	}
+
+	int denseBrickCount() const {
+		return dense_count;
+	}
+
+	int clcBrickIndex(int x, int y, int z) const {
+		return ((x >> VD_BRICK_SHIFT) * brick_num + (y >> VD_BRICK_SHIFT)) * brick_num + (z >> VD_BRICK_SHIFT);
+	}
+
+	bool isDenseBrick(int b) const {
+		return (dense_mask[b >> 6] >> (b & 63)) & 1;
+	}
+
+	T getUniformValue(int b) const {
+		return uniform_data[b];
+	}
+
+	const T* getBrickData(int b) const {
+		return dense_data[b].get();
+	}
+
+	T get(int x, int y, int z) const {
+		const int b = clcBrickIndex(x, y, z);
+		const T* data = dense_data[b].get();
+		return data ? data[clcLocalIndex(x, y, z)] : uniform_data[b];
+	}
+
+	// returns true if value was changed
+	bool set(int x, int y, int z, T val) {
+		const int b = clcBrickIndex(x, y, z);
+		T* data = dense_data[b].get();
+		if (!data) {
+			if (uniform_data[b] == val) {
+				return false;
+			}
+
+			data = makeDense(b);
+		}
+
+		T& ref = data[clcLocalIndex(x, y, z)];
+		if (ref == val) {
+			return false;
+		}
+
+		ref = val;
+		return true;
+	}
+
+	void compact() {
+		compact(0, 0, 0, voxel_num - 1, voxel_num - 1, voxel_num - 1);
+	}
+
+	// turn dense bricks which contain only one value back to uniform, only bricks intersecting voxel box are checked
+	// border bricks are partially outside of volume, only voxels inside are checked
+	void compact(int lx, int ly, int lz, int ux, int uy, int uz) {
+		for (int bx = lx >> VD_BRICK_SHIFT; bx <= (ux >> VD_BRICK_SHIFT) && bx < brick_num; bx++) {
+			for (int by = ly >> VD_BRICK_SHIFT; by <= (uy >> VD_BRICK_SHIFT) && by < brick_num; by++) {
+				for (int bz = lz >> VD_BRICK_SHIFT; bz <= (uz >> VD_BRICK_SHIFT) && bz < brick_num; bz++) {
+					const int b = (bx * brick_num + by) * brick_num + bz;
+					const T* data = dense_data[b].get();
+					if (!data) {
+						continue;
+					}
+
+					const int x0 = bx << VD_BRICK_SHIFT;
+					const int y0 = by << VD_BRICK_SHIFT;
+					const int z0 = bz << VD_BRICK_SHIFT;
+					const int x1 = std::min(x0 + VD_BRICK_SIZE, voxel_num);
+					const int y1 = std::min(y0 + VD_BRICK_SIZE, voxel_num);
+					const int z1 = std::min(z0 + VD_BRICK_SIZE, voxel_num);
+
+					const T val = data[0];
+					bool is_uniform = true;
+					for (int x = x0; x < x1 && is_uniform; x++) {
+						for (int y = y0; y < y1 && is_uniform; y++) {
+							const T* row = data + clcLocalIndex(x, y, 0);
+							is_uniform = std::find_if(row, row + (z1 - z0), [val](T v) { return v != val; }) == row + (z1 - z0);
+						}
+					}
+
+					if (is_uniform) {
+						makeUniform(b, val);
+					}
+				}
+			}
+		}
+	}
+
+	// dense linear layout: x * n * n + y * n + z. src can be unaligned (view into serialized data), it is read by memcpy only
+	void copyFrom(int num, const void* src) {
+		init(num, T());
+
+		const uint8_t* src_bytes = static_cast<const uint8_t*>(src);
+		auto readSegment = [=](int x, int y, int z0, int len, T* dst) {
+			const uint8_t* ptr = src_bytes + (((size_t)x * num + y) * num + z0) * sizeof(T);
+			if (len == VD_BRICK_SIZE) {
+				memcpy(dst, ptr, VD_BRICK_SIZE * sizeof(T)); // constant size, inlined
+			} else {
+				memcpy(dst, ptr, len * sizeof(T));
+			}
+		};
+
+		T segment[VD_BRICK_SIZE];
+
+		for (int bx = 0; bx < brick_num; bx++) {
+			for (int by = 0; by < brick_num; by++) {
+				for (int bz = 0; bz < brick_num; bz++) {
+					const int b = (bx * brick_num + by) * brick_num + bz;
+					const int x0 = bx << VD_BRICK_SHIFT;
+					const int y0 = by << VD_BRICK_SHIFT;
+					const int z0 = bz << VD_BRICK_SHIFT;
+					const int x1 = std::min(x0 + VD_BRICK_SIZE, num);
+					const int y1 = std::min(y0 + VD_BRICK_SIZE, num);
+					const int len = std::min(VD_BRICK_SIZE, num - z0);
+
+					readSegment(x0, y0, z0, 1, segment);
+					const T val = segment[0];
+					uniform_data[b] = val;
+
+					T* data = nullptr;
+					for (int x = x0; x < x1; x++) {
+						for (int y = y0; y < y1; y++) {
+							readSegment(x, y, z0, len, segment);
+							if (!data) {
+								if (std::find_if(segment, segment + len, [val](T v) { return v != val; }) == segment + len) {
+									continue;
+								}
+
+								data = makeDense(b);
+							}
+
+							memcpy(data + clcLocalIndex(x, y, z0), segment, len * sizeof(T));
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// copy whole z-row (voxel_num values) to contiguous buffer
+	void copyRow(int x, int y, T* dst) const {
+		const int n = voxel_num;
+		for (int z0 = 0; z0 < n; z0 += VD_BRICK_SIZE) {
+			const int len = std::min(VD_BRICK_SIZE, n - z0);
+			const int b = clcBrickIndex(x, y, z0);
+			const T* data = dense_data[b].get();
+			if (data) {
+				memcpy(dst + z0, data + clcLocalIndex(x, y, 0), len * sizeof(T));
+			} else {
+				std::fill(dst + z0, dst + z0 + len, uniform_data[b]);
+			}
+		}
+	}
+
+	void copyTo(T* dst) const {
+		const int n = voxel_num;
+		for (int x = 0; x < n; x++) {
+			for (int y = 0; y < n; y++) {
+				copyRow(x, y, dst + (x * n + y) * n);
+			}
+		}
+	}
+
+	size_t getAllocatedSize() const {
+		return uniform_data.capacity() * sizeof(T) + dense_data.capacity() * sizeof(std::unique_ptr<T[]>) + dense_mask.capacity() * sizeof(uint64_t) + (size_t)dense_count * VD_BRICK_VOLUME * sizeof(T);
+	}
+};
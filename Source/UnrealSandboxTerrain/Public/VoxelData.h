@@ -4,6 +4,7 @@
 
 #include "UnrealSandboxTerrain.h"
 #include "VoxelIndex.h"
+#include "VoxelBrickArray.h"
 #include <list>
 #include <array>
 #include <memory>
@@ -55,6 +56,9 @@ public:
 
 	void copy(const int* cache_data, const int len);
 
+	// replace items of cells inside box [lower, upper] by new items. items are sorted by index
+	void replaceBox(int n, const TVoxelIndex& lower, const TVoxelIndex& upper, const std::vector<TSubstanceCacheItem>& items);
+
 	int32 size() const;
 
 	const TSubstanceCacheItem& operator[](std::size_t idx) const;
@@ -72,6 +76,11 @@ typedef struct TVoxelDataHeader {
 	TMaterialId base_fill_mat;
 } TVoxelDataHeader;
 
+// encoded volume in serialized data, values of header state fields besides TVoxelDataFillState.
+// MIXED state means raw volume (old layout)
+#define VD_VOLUME_DENSITY_RLE		3	// runs along z rows
+#define VD_VOLUME_MATERIAL_PALETTE	4	// used material ids and bit packed indexes
+
 
 
 class TVoxelData;
@@ -88,6 +97,7 @@ namespace vd {
 		unsigned long caseCode(const int8(&corner)[8]);
 		int clcLinearIndex(int n, int x, int y, int z);
 		int clcLinearIndex(int n, const TVoxelIndex& vi);
+		bool clcCellBox(int n, int step, const TVoxelIndex& lower, const TVoxelIndex& upper, TVoxelIndex& cell_lower, TVoxelIndex& cell_upper);
 		size_t getCacheSize(const TVoxelData* vd, int lod);
 		const TSubstanceCacheItem& getCacheItmByNumber(const TVoxelData* vd, int lod, int number);
 
@@ -111,12 +121,19 @@ private:
 
 	int voxel_num;
 	float volume_size;
-	TDensityVal* density_data;
-	TMaterialId* material_data;
+	TVoxelBrickArray<TDensityVal> density_data;
+	TVoxelBrickArray<TMaterialId> material_data;
 	std::vector<FVector> normal_data;
 
 	volatile int cache_state = -1;
 
+	// changed voxels since resetDirtyRegion. empty if dirty_lower.X > dirty_upper.X
+	TVoxelIndex dirty_lower;
+	TVoxelIndex dirty_upper;
+
+	// unique id of voxel data content, changed on every voxel change
+	uint64 revision = 0;
+
 	FVector origin = FVector(0.0f, 0.0f, 0.0f);
 	FVector lower = FVector(0.0f, 0.0f, 0.0f);
 	FVector upper = FVector(0.0f, 0.0f, 0.0f);
@@ -125,6 +142,11 @@ private:
 
 	bool performCellSubstanceCaching(int x, int y, int z, int lod, int step);
 
+	void performSubstanceCacheSweep(int lod_num);
+
+	void markDirty(int x, int y, int z);
+	void markDirtyAll();
+
 public:
 
 	TVoxelData();
@@ -139,6 +161,9 @@ public:
 	void initializeDensity();
 	void initializeMaterial();
 
+	void compact();
+	size_t getResidentSize() const;
+
 	TMaterialId getBaseMatId();
 	void setBaseMatId(TMaterialId base_mat_id);
 
@@ -151,6 +176,7 @@ public:
 
 	void forEach(std::function<void(int x, int y, int z)> func);
 	void forEachWithCache(std::function<void(int x, int y, int z)> func, bool enableLOD);
+	void forEachInBoxWithCache(const TVoxelIndex& lower, const TVoxelIndex& upper, std::function<void(int x, int y, int z)> func, bool enableLOD);
 	void forEachCacheItem(const int lod, std::function<void(const TSubstanceCacheItem& itm)> func) const;
 
 	void setDensity(int x, int y, int z, float density);
@@ -176,6 +202,7 @@ public:
 	FVector voxelIndexToVector(TVoxelIndex Idx) const;
 	FVector voxelIndexToVector(int x, int y, int z) const;
 	void vectorToVoxelIndex(const FVector& v, int& x, int& y, int& z) const;
+	bool clcVoxelBox(const FBox& box, TVoxelIndex& lower, TVoxelIndex& upper) const;
 
 	void setOrigin(const FVector& o);
 	const FVector& getOrigin() const;
@@ -198,10 +225,23 @@ public:
 	void setCacheToValid();
 	void makeSubstanceCache();
 	void clearSubstanceCache();
+	void updateSubstanceCache(const TVoxelIndex& lower, const TVoxelIndex& upper, int lod_num);
+
+	void resetDirtyRegion();
+	bool getDirtyRegion(TVoxelIndex& lower, TVoxelIndex& upper) const;
+	uint64 getRevision() const;
 
 	unsigned long getCaseCode(int x, int y, int z, int step) const;
 
 	std::shared_ptr<std::vector<uint8>> serialize();
 
+	// voxels of box [lower, upper] only, same volume encoding as serialize
+	std::shared_ptr<std::vector<uint8>> serializeRegion(const TVoxelIndex& lower, const TVoxelIndex& upper) const;
+
 	friend bool deserializeVoxelData(TVoxelData* vd, std::vector<uint8>& data);
+
+	friend bool deserializeVoxelData(TVoxelData* vd, const uint8* data, size_t size);
+
+	// overwrite voxels of serialized region, substance cache is updated for changed cells only
+	friend bool deserializeVoxelDataRegion(TVoxelData* vd, const uint8* data, size_t size, bool enableLOD);
 };
\ No newline at end of file
@@ -1,5 +1,9 @@
 #pragma once
 
+struct TVoxelIndex;
+
+inline uint64 ClcVoxelIndexHash(const TVoxelIndex& Index);
+
 struct TVoxelIndex {
 	int32 X = 0;
 	int32 Y = 0;
@@ -36,16 +40,39 @@ struct TVoxelIndex {
 	}
 
 	friend uint32 GetTypeHash(const TVoxelIndex& Index) {
-		return ((std::hash<int>()(Index.X) ^ (std::hash<int>()(Index.Y) << 1)) >> 1) ^ (std::hash<int>()(Index.Z) << 1);
+		return (uint32)ClcVoxelIndexHash(Index);
 	}
 };
 
+// spread low 21 bits of value: bit N goes to bit 3 * N
+inline uint64 SpreadVoxelIndexBits(uint32 Val) {
+	uint64 V = Val & 0x1fffff;
+	V = (V | V << 32) & 0x1f00000000ffffull;
+	V = (V | V << 16) & 0x1f0000ff0000ffull;
+	V = (V | V << 8) & 0x100f00f00f00f00full;
+	V = (V | V << 4) & 0x10c30c30c30c30c3ull;
+	V = (V | V << 2) & 0x1249249249249249ull;
+	return V;
+}
+
+// Morton code of index (21 bits per axis, negative values are two's complement) mixed by murmur3 finalizer.
+// Both steps are bijective: no collisions for indexes in range [-2^20, 2^20), all output bits depend on all axes
+inline uint64 ClcVoxelIndexHash(const TVoxelIndex& Index) {
+	uint64 H = SpreadVoxelIndexBits((uint32)Index.X) | (SpreadVoxelIndexBits((uint32)Index.Y) << 1) | (SpreadVoxelIndexBits((uint32)Index.Z) << 2);
+	H ^= H >> 33;
+	H *= 0xff51afd7ed558ccdull;
+	H ^= H >> 33;
+	H *= 0xc4ceb9fe1a85ec53ull;
+	H ^= H >> 33;
+	return H;
+}
+
 namespace std {
 
 	template <>
 	struct hash<TVoxelIndex> {
 		std::size_t operator()(const TVoxelIndex& Index) const {
-			return ((std::hash<int>()(Index.X) ^ (std::hash<int>()(Index.Y) << 1)) >> 1) ^ (std::hash<int>()(Index.Z) << 1);
+			return (std::size_t)ClcVoxelIndexHash(Index);
 		}
 	};
 }
@@ -76,6 +76,12 @@ private:
 	/** Array of sections of mesh */
 	TArray<TMeshLodSection> MeshSectionLodArray;
 
+	/** LODs of mesh which are extracted, see TMeshData::LodMask */
+	uint32 LodMask = USBT_LOD_MASK_ALL;
+
+	/** Collision is whole mesh without material sections, see TMeshData::bCollisionOnly */
+	bool bCollisionOnly = false;
+
 	/** Local space bounds of mesh */
 	UPROPERTY()
 	FBoxSphereBounds LocalBounds;
@@ -11,6 +11,8 @@
 #include <mutex>
 #include <functional>
 
+class TThreadPool;
+
 extern std::atomic<int> md_counter;
 extern std::atomic<int> cd_counter;
 
@@ -37,7 +39,8 @@ typedef struct TMeshMaterialTransitionSection : TMeshMaterialSection {
 	uint64 TransitionCode;
 	std::set<unsigned short> MaterialIdSet;
 
-	static uint64 GenerateTransitionCode(const std::set<unsigned short>& MaterialIdSet) {
+	template <typename T>
+	static uint64 GenerateTransitionCode(const T& MaterialIdSet) {
 		TTransitionMaterialCode TransMat;
 		for (int i = 0; i < 4; i++) { 
 			TransMat.TriangleMatId[i] = 0; //TODO incorrect material
@@ -77,6 +80,8 @@ typedef struct TMeshLodSection {
 
 	TArray<FVector> DebugPointList; // just point to draw debug. remove it after release
 
+	TMeshVertexPoolPtr VertexPoolPtr = nullptr; // vertexes of all sections if they are shared, see TVoxelDataParam::bShareVertexes
+
 	TMeshLodSection() { 
 		TransitionPatchArray.SetNum(6); 
 	}
@@ -88,8 +93,18 @@ typedef struct TMeshData {
 	TArray<TMeshLodSection> MeshSectionLodArray;
 	FProcMeshSection* CollisionMeshPtr;
 
+	// extracted LODs, bit per LOD. sections of other LODs are empty
+	uint32 LodMask = USBT_LOD_MASK_ALL;
+	int32 CollisionLod = 0;
+
+	// LOD 0 whole mesh only, without render sections. see TVoxelDataParam::bCollisionOnly
+	bool bCollisionOnly = false;
+
 	double TimeStamp = 0;
 	uint32 VStamp = 0;
+
+	// revision of voxel data mesh was generated from (runtime only)
+	uint64 SourceRevision = 0;
    
 	unsigned short BaseMaterialId = 0;
 
@@ -103,6 +118,15 @@ typedef struct TMeshData {
 		md_counter--;
 	}
 
+	bool HasLod(int32 Lod) const {
+		return (LodMask >> Lod) & 1;
+	}
+
+	void SetCollisionLod(int32 Lod) {
+		CollisionLod = Lod;
+		CollisionMeshPtr = &MeshSectionLodArray[Lod].WholeMesh;
+	}
+
 } TMeshData;
 
 typedef std::shared_ptr<TMeshData> TMeshDataPtr;
@@ -113,10 +137,25 @@ typedef struct TVoxelDataParam {
 
 	int collisionLOD = 0;
 
+	// LODs to extract with bGenerateLOD, bit per LOD. collision LOD is extracted always
+	uint32 lodMask = USBT_LOD_MASK_ALL;
+
 	float ZCutLevel = 0;
 
 	bool bZCut = false;
 
 	bool bForceNoCache = false;
 
+	// keep source cell of triangles and source edge of vertexes. required as base mesh of partial remesh
+	bool bKeepCellInfo = false;
+
+	// extract LODs as parallel tasks of this pool, nullptr - one by one on calling thread
+	TThreadPool* threadPool = nullptr;
+
+	// one vertex pool per LOD for all material sections and collision mesh. ignored with bKeepCellInfo
+	bool bShareVertexes = false;
+
+	// extract LOD 0 whole mesh only: no material sections, transition patches and other LODs. dedicated server needs collision only
+	bool bCollisionOnly = false;
+
 } TVoxelDataParam;
@@ -25,7 +25,7 @@ namespace usbt {
 		template <typename T>
 		void read(T* buffer, size_t size) {
 			size_t len = sizeof(T) * size;
-			memcpy(buffer, dataPtr + pos, len);
+			memcpy((void*)buffer, dataPtr + pos, len);
 			pos += len;
 		}
 
@@ -33,6 +33,16 @@ namespace usbt {
 			pos += bytes;
 		}
 
+		// view of not yet read data, no alignment
+		const uint8_t* current() const {
+			return dataPtr + pos;
+		}
+
+		// bytes left before end of data, untrusted data should be checked before read
+		size_t available(const uint8_t* end) const {
+			return (current() < end) ? (size_t)(end - current()) : 0;
+		}
+
 		template <typename T>
 		friend TFastUnsafeDeserializer& operator >> (TFastUnsafeDeserializer& in, T& obj) {
 			in.readObj(obj);
@@ -0,0 +1,121 @@
+// Zone storage map benchmark: concurrent get-or-create lookups by zone index,
+// single exclusive lock (old TTerrainData::GetVoxelDataInfo) vs TShardedMap.
+//
+// usage: usbt_map_benchmark [threads=16] [seconds=1]
+
+#include "CoreMinimal.h"
+#include "VoxelIndex.h"
+#include "ShardedMap.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// area of zones around players: 2 * 20 + 1 zones wide, 11 zones deep
+#define USBT_BENCH_AREA_RADIUS	20
+#define USBT_BENCH_AREA_DEPTH	5
+
+typedef std::shared_ptr<int> TValuePtr;
+
+class TSingleLockMap {
+
+private:
+	std::shared_timed_mutex Mutex;
+	std::unordered_map<TVoxelIndex, TValuePtr> Map;
+
+public:
+	TValuePtr FindOrAdd(const TVoxelIndex& Index) {
+		std::unique_lock<std::shared_timed_mutex> Lock(Mutex);
+		if (Map.find(Index) != Map.end()) {
+			return Map[Index];
+		} else {
+			TValuePtr NewVal = std::make_shared<int>(0);
+			Map.insert({ Index, NewVal });
+			return NewVal;
+		}
+	}
+};
+
+class TShardedLockMap {
+
+private:
+	TShardedMap<TVoxelIndex, TValuePtr> Map;
+
+public:
+	TValuePtr FindOrAdd(const TVoxelIndex& Index) {
+		return Map.findOrAdd(Index, [] { return std::make_shared<int>(0); });
+	}
+};
+
+template <typename M>
+static double Run(const char* Name, int ThreadNum, double Seconds) {
+	M Map;
+
+	const int R = USBT_BENCH_AREA_RADIUS;
+	const int D = USBT_BENCH_AREA_DEPTH;
+	for (int X = -R; X <= R; X++) {
+		for (int Y = -R; Y <= R; Y++) {
+			for (int Z = -D; Z <= D; Z++) {
+				Map.FindOrAdd(TVoxelIndex(X, Y, Z));
+			}
+		}
+	}
+
+	std::atomic<bool> bStop{ false };
+	std::atomic<uint64> Total{ 0 };
+	std::atomic<int> Sink{ 0 };
+	std::vector<std::thread> ThreadList;
+
+	for (int T = 0; T < ThreadNum; T++) {
+		ThreadList.emplace_back([&, T]() {
+			std::minstd_rand Rnd(T + 1);
+			std::uniform_int_distribution<int> DistXY(-R, R);
+			std::uniform_int_distribution<int> DistZ(-D, D);
+
+			uint64 Count = 0;
+			int Sum = 0;
+			while (!bStop.load(std::memory_order_relaxed)) {
+				for (int I = 0; I < 256; I++) {
+					TValuePtr Ptr = Map.FindOrAdd(TVoxelIndex(DistXY(Rnd), DistXY(Rnd), DistZ(Rnd)));
+					Sum += *Ptr;
+				}
+
+				Count += 256;
+			}
+
+			Total += Count;
+			Sink += Sum;
+		});
+	}
+
+	std::this_thread::sleep_for(std::chrono::duration<double>(Seconds));
+	bStop = true;
+
+	for (auto& Thread : ThreadList) {
+		Thread.join();
+	}
+
+	const double Rate = Total / Seconds;
+	printf("%-14s %14.0f lookups/s\n", Name, Rate);
+	return Rate;
+}
+
+int main(int argc, char** argv) {
+	const int ThreadNum = (argc > 1) ? atoi(argv[1]) : 16;
+	const double Seconds = (argc > 2) ? atof(argv[2]) : 1.;
+
+	printf("threads: %d, hw threads: %d\n", ThreadNum, (int)std::thread::hardware_concurrency());
+
+	const double Single = Run<TSingleLockMap>("single lock", ThreadNum, Seconds);
+	const double Sharded = Run<TShardedLockMap>("sharded", ThreadNum, Seconds);
+	printf("%-14s %14.2fx\n", "speedup", Sharded / Single);
+
+	return 0;
+}
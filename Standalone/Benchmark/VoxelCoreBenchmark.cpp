@@ -0,0 +1,288 @@
+// Voxel core benchmark: generates, meshes, serializes, compresses and deserializes N zones
+// and reports throughput of each stage.
+//
+// usage: usbt_benchmark [zones=64] [threads=1] [seed=0] [compact_mesh=1]
+// threads=0 - one thread per CPU core, --help prints arguments
+
+#include "VoxelData.h"
+#include "VoxelMeshData.h"
+#include "SandboxVoxelCore.h"
+#include "MeshDataSerialization.h"
+#include "perlin.hpp"
+#include "ThreadPool.hpp"
+
+#include <zlib.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <cerrno>
+
+#define USBT_BENCH_GROUND_LEVEL_OFFSET	205.f
+#define USBT_BENCH_GRASS_MATERIAL_ID	2
+#define USBT_BENCH_DIRT_MATERIAL_ID		1
+
+
+typedef std::chrono::steady_clock TClock;
+
+static double ElapsedSec(TClock::time_point Start) {
+	return std::chrono::duration<double>(TClock::now() - Start).count();
+}
+
+struct TZoneStat {
+	double GenerateTime = 0;
+	double CacheTime = 0;
+	double MeshTime = 0;
+	double MeshLod0Time = 0;
+	double SerializeTime = 0;
+	double CompressTime = 0;
+	double DeserializeTime = 0;
+
+	uint64 Voxels = 0;
+	uint64 ResidentBytes = 0;
+	uint64 Triangles = 0;
+	uint64 TrianglesLod0 = 0;
+	uint64 RawBytes = 0;
+	uint64 CompressedBytes = 0;
+
+	void operator += (const TZoneStat& S) {
+		GenerateTime += S.GenerateTime;
+		CacheTime += S.CacheTime;
+		MeshTime += S.MeshTime;
+		MeshLod0Time += S.MeshLod0Time;
+		SerializeTime += S.SerializeTime;
+		CompressTime += S.CompressTime;
+		DeserializeTime += S.DeserializeTime;
+		Voxels += S.Voxels;
+		ResidentBytes += S.ResidentBytes;
+		Triangles += S.Triangles;
+		TrianglesLod0 += S.TrianglesLod0;
+		RawBytes += S.RawBytes;
+		CompressedBytes += S.CompressedBytes;
+	}
+};
+
+// same landscape function as UTerrainGeneratorComponent::GroundLevelFunction
+static float GroundLevel(TPerlinNoise& Pn, const FVector& V) {
+	static const float Scale1 = 0.001f;
+	static const float Scale2 = 0.0004f;
+	static const float Scale3 = 0.00009f;
+	static const float HeightScaleCoeff = 100.f;
+
+	const float NoiseSmall = Pn.noise(V.X * Scale1, V.Y * Scale1, 0) * 0.5f;
+	const float NoiseMedium = Pn.noise(V.X * Scale2, V.Y * Scale2, 0) * 5.f;
+	const float NoiseBig = Pn.noise(V.X * Scale3, V.Y * Scale3, 0) * 10.f;
+	const float HeightLevel = NoiseSmall + NoiseMedium + NoiseBig;
+
+	return (HeightLevel * HeightScaleCoeff) + USBT_BENCH_GROUND_LEVEL_OFFSET;
+}
+
+static float ClcDensityByGroundLevel(const FVector& V, const float GroundLevel) {
+	const float D = V.Z - GroundLevel;
+
+	if (D > 500) {
+		return 0.f;
+	}
+
+	if (D < -500) {
+		return 1.f;
+	}
+
+	float Density = 1 - (1 / (1 + exp(-D / 20)));
+	TRIM_FLOAT_VAL(Density);
+	return Density;
+}
+
+static TVoxelDataPtr GenerateZone(TPerlinNoise& Pn, const TVoxelIndex& ZoneIndex) {
+	const int Num = (1 << (LOD_ARRAY_SIZE - 1)) + 1;
+	TVoxelDataPtr Vd = std::make_shared<TVoxelData>(Num, USBT_ZONE_SIZE);
+	Vd->setOrigin(FVector(ZoneIndex.X, ZoneIndex.Y, ZoneIndex.Z) * USBT_ZONE_SIZE);
+
+	Vd->initializeDensity();
+	Vd->initializeMaterial();
+
+	for (int X = 0; X < Num; X++) {
+		for (int Y = 0; Y < Num; Y++) {
+			const FVector ColumnPos = Vd->voxelIndexToVector(X, Y, 0) + Vd->getOrigin();
+			const float Level = GroundLevel(Pn, ColumnPos);
+
+			for (int Z = 0; Z < Num; Z++) {
+				const TVoxelIndex Index(X, Y, Z);
+				const FVector WorldPos = Vd->voxelIndexToVector(X, Y, Z) + Vd->getOrigin();
+				const float Density = ClcDensityByGroundLevel(WorldPos, Level);
+				const TMaterialId MaterialId = (WorldPos.Z > Level - 50) ? USBT_BENCH_GRASS_MATERIAL_ID : USBT_BENCH_DIRT_MATERIAL_ID;
+
+				Vd->setDensityAndMaterial(Index, Density, MaterialId);
+			}
+		}
+	}
+
+	Vd->compact();
+	return Vd;
+}
+
+static uint64 CompressedSize(const std::vector<uint8>& Data) {
+	uLongf Len = compressBound(Data.size());
+	std::vector<uint8> Buffer(Len);
+	compress2(Buffer.data(), &Len, Data.data(), Data.size(), Z_DEFAULT_COMPRESSION);
+	return Len;
+}
+
+static TZoneStat BenchmarkZone(TPerlinNoise& Pn, const TVoxelIndex& ZoneIndex, bool bCompactMesh) {
+	TZoneStat Stat;
+
+	auto Start = TClock::now();
+	TVoxelDataPtr Vd = GenerateZone(Pn, ZoneIndex);
+	Stat.GenerateTime = ElapsedSec(Start);
+	Stat.Voxels = (uint64)Vd->num() * Vd->num() * Vd->num();
+	Stat.ResidentBytes = Vd->getResidentSize();
+
+	Start = TClock::now();
+	Vd->makeSubstanceCache();
+	Vd->setCacheToValid();
+	Stat.CacheTime = ElapsedSec(Start);
+
+	TVoxelDataParam Vdp;
+	Vdp.bGenerateLOD = USBT_ENABLE_LOD;
+
+	Start = TClock::now();
+	TMeshDataPtr MeshData = sandboxVoxelGenerateMesh(*Vd, Vdp);
+	Stat.MeshTime = ElapsedSec(Start);
+
+	for (int Lod = 0; Lod < MeshData->MeshSectionLodArray.Num(); Lod++) {
+		Stat.Triangles += MeshData->MeshSectionLodArray[Lod].WholeMesh.ProcIndexBuffer.Num() / 3;
+	}
+
+	// separate pass without LOD, rate of LOD0 only
+	TVoxelDataParam VdpLod0;
+	VdpLod0.bGenerateLOD = false;
+
+	Start = TClock::now();
+	TMeshDataPtr MeshDataLod0 = sandboxVoxelGenerateMesh(*Vd, VdpLod0);
+	Stat.MeshLod0Time = ElapsedSec(Start);
+	Stat.TrianglesLod0 = MeshDataLod0->MeshSectionLodArray[0].WholeMesh.ProcIndexBuffer.Num() / 3;
+
+	Start = TClock::now();
+	auto VdData = Vd->serialize();
+	auto MdData = SerializeMeshDataRaw(*MeshData, bCompactMesh);
+	Stat.SerializeTime = ElapsedSec(Start);
+	Stat.RawBytes = VdData->size() + MdData->size();
+
+	Start = TClock::now();
+	Stat.CompressedBytes = CompressedSize(*VdData) + CompressedSize(*MdData);
+	Stat.CompressTime = ElapsedSec(Start);
+
+	Start = TClock::now();
+	TVoxelData LoadedVd(Vd->num(), USBT_ZONE_SIZE);
+	deserializeVoxelData(&LoadedVd, *VdData);
+	TMeshDataPtr LoadedMeshData = DeserializeMeshDataFast(*MdData, 0, bCompactMesh);
+	Stat.DeserializeTime = ElapsedSec(Start);
+
+	return Stat;
+}
+
+static void PrintRate(const char* Name, double Count, double Time, const char* Unit) {
+	printf("%-14s %12.0f %s/s   (%.3f s)\n", Name, Time > 0 ? Count / Time : 0., Unit, Time);
+}
+
+static void PrintUsage(FILE* Out) {
+	fprintf(Out, "usage: usbt_benchmark [zones=64] [threads=1] [seed=0] [compact_mesh=1]\n");
+	fprintf(Out, "  zones         number of zones, 1 or more\n");
+	fprintf(Out, "  threads       worker threads, 0 - one thread per CPU core\n");
+	fprintf(Out, "  seed          landscape noise seed\n");
+	fprintf(Out, "  compact_mesh  0 or 1, compact mesh serialization\n");
+}
+
+// whole string must be decimal integer in range [Min, Max]
+static bool ParseIntArg(const char* Str, int Min, int Max, int& Val) {
+	char* End = nullptr;
+	errno = 0;
+	const long L = strtol(Str, &End, 10);
+	if (End == Str || *End != '\0' || errno == ERANGE || L < Min || L > Max) {
+		return false;
+	}
+
+	Val = (int)L;
+	return true;
+}
+
+int main(int argc, char** argv) {
+	if (argc > 1 && (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0)) {
+		PrintUsage(stdout);
+		return 0;
+	}
+
+	int ZoneNum = 64;
+	int ThreadNum = 1;
+	int Seed = 0;
+	int CompactMesh = 1;
+
+	const bool bValidArgs = argc <= 5 &&
+		(argc <= 1 || ParseIntArg(argv[1], 1, INT_MAX, ZoneNum)) &&
+		(argc <= 2 || ParseIntArg(argv[2], 0, 1024, ThreadNum)) &&
+		(argc <= 3 || ParseIntArg(argv[3], INT_MIN, INT_MAX, Seed)) &&
+		(argc <= 4 || ParseIntArg(argv[4], 0, 1, CompactMesh));
+
+	if (!bValidArgs) {
+		PrintUsage(stderr);
+		return 1;
+	}
+
+	const bool bCompactMesh = CompactMesh != 0;
+
+	// zones around the ground surface: square area, three zones deep
+	std::vector<TVoxelIndex> ZoneList;
+	const int R = (int)std::ceil(std::sqrt(ZoneNum / 3.)) / 2 + 1;
+	for (int X = -R; X <= R && (int)ZoneList.size() < ZoneNum; X++) {
+		for (int Y = -R; Y <= R && (int)ZoneList.size() < ZoneNum; Y++) {
+			for (int Z = -1; Z <= 1 && (int)ZoneList.size() < ZoneNum; Z++) {
+				ZoneList.push_back(TVoxelIndex(X, Y, Z));
+			}
+		}
+	}
+
+	std::vector<TZoneStat> StatList(ZoneList.size());
+
+	auto Start = TClock::now();
+	{
+		TThreadPool ThreadPool(ThreadNum);
+		std::atomic<int> Done{ 0 };
+
+		for (int I = 0; I < (int)ZoneList.size(); I++) {
+			ThreadPool.addTask([&, I]() {
+				TPerlinNoise Pn;
+				Pn.reinit(Seed);
+				StatList[I] = BenchmarkZone(Pn, ZoneList[I], bCompactMesh);
+				Done++;
+			}, TTaskPriority::NEAR_STREAMING);
+		}
+
+		while (Done < (int)ZoneList.size()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+	const double WallTime = ElapsedSec(Start);
+
+	TZoneStat Total;
+	for (const auto& Stat : StatList) {
+		Total += Stat;
+	}
+
+	const double Zones = (double)ZoneList.size();
+
+	printf("zones: %d, threads: %d, seed: %d, compact mesh: %d, wall time: %.3f s\n", (int)ZoneList.size(), ThreadNum, Seed, (int)bCompactMesh, WallTime);
+	PrintRate("generate", (double)Total.Voxels, Total.GenerateTime, "voxels");
+	PrintRate("cache", (double)Total.Voxels, Total.CacheTime, "voxels");
+	PrintRate("mesh", (double)Total.Triangles, Total.MeshTime, "triangles");
+	PrintRate("mesh lod0", (double)Total.TrianglesLod0, Total.MeshLod0Time, "triangles");
+	PrintRate("serialize", (double)Total.RawBytes, Total.SerializeTime, "bytes");
+	PrintRate("compress", (double)Total.RawBytes, Total.CompressTime, "bytes");
+	PrintRate("deserialize", (double)Total.RawBytes, Total.DeserializeTime, "bytes");
+	printf("%-14s %12.0f zones/s\n", "total", Zones / WallTime);
+	printf("%-14s %12.0f bytes/zone\n", "resident vd", Total.ResidentBytes / Zones);
+	printf("%-14s %12.0f bytes/zone\n", "raw", Total.RawBytes / Zones);
+	printf("%-14s %12.0f bytes/zone\n", "compressed", Total.CompressedBytes / Zones);
+
+	return 0;
+}
@@ -0,0 +1,365 @@
+// Minimal stand-in for the engine CoreMinimal.h.
+// Provides only the subset of UE types used by the voxel core (Private/Core) so it can be built
+// and profiled with plain CMake. Semantics follow the engine where the core depends on them.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <atomic>
+#include <utility>
+
+typedef uint8_t uint8;
+typedef int8_t int8;
+typedef uint16_t uint16;
+typedef int16_t int16;
+typedef uint32_t uint32;
+typedef int32_t int32;
+typedef uint64_t uint64;
+typedef int64_t int64;
+typedef size_t SIZE_T;
+
+// functions marked FORCEINLINE are also defined out of line in .cpp files and used across TUs
+#define FORCEINLINE
+#define FORCENOINLINE __attribute__((noinline))
+
+#define TEXT(x) x
+#define check(x) assert(x)
+
+#define UE_LOG(Category, Verbosity, Format, ...) ((void)0)
+#define DECLARE_LOG_CATEGORY_EXTERN(Category, DefaultVerbosity, CompileTimeVerbosity)
+#define DEFINE_LOG_CATEGORY(Category)
+
+typedef std::string FString;
+
+//====================================================================================
+// hash
+//====================================================================================
+
+inline uint32 HashCombine(uint32 A, uint32 C) {
+	uint32 B = 0x9e3779b9;
+	A += B;
+	A -= B; A -= C; A ^= (C >> 13);
+	B -= C; B -= A; B ^= (A << 8);
+	C -= A; C -= B; C ^= (B >> 13);
+	A -= B; A -= C; A ^= (C >> 12);
+	B -= C; B -= A; B ^= (A << 16);
+	C -= A; C -= B; C ^= (B >> 5);
+	A -= B; A -= C; A ^= (C >> 3);
+	B -= C; B -= A; B ^= (A << 10);
+	C -= A; C -= B; C ^= (B >> 15);
+	return C;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, uint32>::type GetTypeHash(T Value) {
+	return (uint32)((uint64)Value ^ ((uint64)Value >> 32));
+}
+
+inline uint32 GetTypeHash(double Value) {
+	uint64 Bits;
+	memcpy(&Bits, &Value, sizeof(Bits));
+	return (uint32)(Bits ^ (Bits >> 32));
+}
+
+inline uint32 GetTypeHash(const FString& Value) {
+	return (uint32)std::hash<std::string>()(Value);
+}
+
+//====================================================================================
+// math
+//====================================================================================
+
+struct FVector {
+	double X = 0;
+	double Y = 0;
+	double Z = 0;
+
+	static const FVector ZeroVector;
+
+	FVector() { }
+	explicit FVector(double V) : X(V), Y(V), Z(V) { }
+	FVector(double InX, double InY, double InZ) : X(InX), Y(InY), Z(InZ) { }
+
+	FVector operator + (const FVector& V) const { return FVector(X + V.X, Y + V.Y, Z + V.Z); }
+	FVector operator - (const FVector& V) const { return FVector(X - V.X, Y - V.Y, Z - V.Z); }
+	FVector operator * (const FVector& V) const { return FVector(X * V.X, Y * V.Y, Z * V.Z); }
+	FVector operator * (double Scale) const { return FVector(X * Scale, Y * Scale, Z * Scale); }
+	FVector operator / (double Scale) const { const double R = 1. / Scale; return FVector(X * R, Y * R, Z * R); }
+	FVector operator - () const { return FVector(-X, -Y, -Z); }
+
+	FVector& operator += (const FVector& V) { X += V.X; Y += V.Y; Z += V.Z; return *this; }
+	FVector& operator -= (const FVector& V) { X -= V.X; Y -= V.Y; Z -= V.Z; return *this; }
+	FVector& operator *= (double Scale) { X *= Scale; Y *= Scale; Z *= Scale; return *this; }
+	FVector& operator /= (double Scale) { const double R = 1. / Scale; X *= R; Y *= R; Z *= R; return *this; }
+
+	bool operator == (const FVector& V) const { return X == V.X && Y == V.Y && Z == V.Z; }
+	bool operator != (const FVector& V) const { return !(*this == V); }
+
+	void Set(double InX, double InY, double InZ) { X = InX; Y = InY; Z = InZ; }
+
+	double SizeSquared() const { return X * X + Y * Y + Z * Z; }
+	double Size() const { return std::sqrt(SizeSquared()); }
+	bool IsZero() const { return X == 0. && Y == 0. && Z == 0.; }
+
+	bool Normalize(double Tolerance = 1.e-8) {
+		const double SquareSum = SizeSquared();
+		if (SquareSum > Tolerance) {
+			const double Scale = 1. / std::sqrt(SquareSum);
+			X *= Scale; Y *= Scale; Z *= Scale;
+			return true;
+		}
+		return false;
+	}
+
+	FVector GetSafeNormal(double Tolerance = 1.e-8) const {
+		FVector Res(*this);
+		return Res.Normalize(Tolerance) ? Res : ZeroVector;
+	}
+
+	static double DotProduct(const FVector& A, const FVector& B) { return A.X * B.X + A.Y * B.Y + A.Z * B.Z; }
+
+	static FVector CrossProduct(const FVector& A, const FVector& B) {
+		return FVector(A.Y * B.Z - A.Z * B.Y, A.Z * B.X - A.X * B.Z, A.X * B.Y - A.Y * B.X);
+	}
+
+	static double Distance(const FVector& A, const FVector& B) { return (A - B).Size(); }
+	static double DistSquared(const FVector& A, const FVector& B) { return (A - B).SizeSquared(); }
+};
+
+inline const FVector FVector::ZeroVector(0, 0, 0);
+
+inline FVector operator * (double Scale, const FVector& V) {
+	return V * Scale;
+}
+
+inline uint32 GetTypeHash(const FVector& V) {
+	return HashCombine(GetTypeHash(V.X), HashCombine(GetTypeHash(V.Y), GetTypeHash(V.Z)));
+}
+
+enum EForceInit {
+	ForceInit,
+	ForceInitToZero
+};
+
+struct FBox {
+	FVector Min;
+	FVector Max;
+	uint8 IsValid = 0;
+
+	FBox() { }
+	explicit FBox(EForceInit) { }
+	FBox(const FVector& InMin, const FVector& InMax) : Min(InMin), Max(InMax), IsValid(1) { }
+
+	void Init() {
+		Min = Max = FVector::ZeroVector;
+		IsValid = 0;
+	}
+
+	FBox& operator += (const FVector& Other) {
+		if (IsValid) {
+			Min.X = std::min(Min.X, Other.X); Min.Y = std::min(Min.Y, Other.Y); Min.Z = std::min(Min.Z, Other.Z);
+			Max.X = std::max(Max.X, Other.X); Max.Y = std::max(Max.Y, Other.Y); Max.Z = std::max(Max.Z, Other.Z);
+		} else {
+			Min = Max = Other;
+			IsValid = 1;
+		}
+		return *this;
+	}
+
+	FBox& operator += (const FBox& Other) {
+		if (IsValid && Other.IsValid) {
+			*this += Other.Min;
+			*this += Other.Max;
+		} else if (Other.IsValid) {
+			*this = Other;
+		}
+		return *this;
+	}
+
+	FVector GetCenter() const { return (Min + Max) * 0.5; }
+	FVector GetExtent() const { return (Max - Min) * 0.5; }
+	FVector GetSize() const { return Max - Min; }
+};
+
+//====================================================================================
+// containers
+//====================================================================================
+
+template <typename T>
+class TArray {
+
+private:
+	std::vector<T> Data;
+
+public:
+	typedef typename std::vector<T>::iterator iterator;
+	typedef typename std::vector<T>::const_iterator const_iterator;
+
+	TArray() { }
+	TArray(std::initializer_list<T> List) : Data(List) { }
+
+	int32 Num() const { return (int32)Data.size(); }
+	bool IsEmpty() const { return Data.empty(); }
+	bool IsValidIndex(int32 Index) const { return Index >= 0 && Index < Num(); }
+
+	T* GetData() { return Data.data(); }
+	const T* GetData() const { return Data.data(); }
+
+	T& operator[](int32 Index) { return Data[Index]; }
+	const T& operator[](int32 Index) const { return Data[Index]; }
+
+	T& Last() { return Data.back(); }
+	const T& Last() const { return Data.back(); }
+
+	int32 Add(const T& Item) { Data.push_back(Item); return Num() - 1; }
+	int32 Add(T&& Item) { Data.push_back(std::move(Item)); return Num() - 1; }
+
+	template <typename... ArgsType>
+	int32 Emplace(ArgsType&&... Args) { Data.emplace_back(std::forward<ArgsType>(Args)...); return Num() - 1; }
+
+	int32 AddUnique(const T& Item) {
+		const int32 Index = Find(Item);
+		return Index >= 0 ? Index : Add(Item);
+	}
+
+	int32 AddZeroed(int32 Count = 1) { const int32 Index = Num(); Data.resize(Data.size() + Count); return Index; }
+
+	void Append(const TArray<T>& Other) { Data.insert(Data.end(), Other.Data.begin(), Other.Data.end()); }
+	void Append(const T* Ptr, int32 Count) { Data.insert(Data.end(), Ptr, Ptr + Count); }
+
+	void SetNum(int32 NewNum) { Data.resize(NewNum); }
+	void SetNumUninitialized(int32 NewNum) { Data.resize(NewNum); }
+	void SetNumZeroed(int32 NewNum) { Data.resize(NewNum); }
+	void Reserve(int32 Number) { Data.reserve(Number); }
+	void Shrink() { Data.shrink_to_fit(); }
+
+	void Empty(int32 Slack = 0) {
+		Data.clear();
+		if (Slack == 0) {
+			Data.shrink_to_fit();
+		} else {
+			Data.reserve(Slack);
+		}
+	}
+
+	void Reset() { Data.clear(); }
+
+	int32 Find(const T& Item) const {
+		auto It = std::find(Data.begin(), Data.end(), Item);
+		return It == Data.end() ? -1 : (int32)(It - Data.begin());
+	}
+
+	bool Contains(const T& Item) const { return Find(Item) >= 0; }
+
+	void RemoveAt(int32 Index) { Data.erase(Data.begin() + Index); }
+
+	iterator begin() { return Data.begin(); }
+	iterator end() { return Data.end(); }
+	const_iterator begin() const { return Data.begin(); }
+	const_iterator end() const { return Data.end(); }
+};
+
+template <typename KeyType, typename ValueType>
+struct TPair {
+	KeyType Key;
+	ValueType Value;
+};
+
+template <typename KeyType>
+struct TShimKeyHash {
+	size_t operator()(const KeyType& Key) const {
+		return GetTypeHash(Key);
+	}
+};
+
+// node based, so references returned by FindOrAdd stay valid while other keys are added
+template <typename KeyType, typename ValueType>
+class TMap {
+
+private:
+	typedef TPair<KeyType, ValueType> ElementType;
+	typedef std::unordered_map<KeyType, ElementType, TShimKeyHash<KeyType>> StorageType;
+
+	StorageType Storage;
+
+	template <typename ElementT, typename BaseIterator>
+	class TIteratorBase {
+
+	private:
+		BaseIterator It;
+
+	public:
+		TIteratorBase(BaseIterator InIt) : It(InIt) { }
+		ElementT& operator*() const { return It->second; }
+		ElementT* operator->() const { return &It->second; }
+		TIteratorBase& operator++() { ++It; return *this; }
+		bool operator != (const TIteratorBase& Other) const { return It != Other.It; }
+		bool operator == (const TIteratorBase& Other) const { return It == Other.It; }
+	};
+
+public:
+	typedef TIteratorBase<ElementType, typename StorageType::iterator> iterator;
+	typedef TIteratorBase<const ElementType, typename StorageType::const_iterator> const_iterator;
+
+	int32 Num() const { return (int32)Storage.size(); }
+	bool IsEmpty() const { return Storage.empty(); }
+	bool Contains(const KeyType& Key) const { return Storage.find(Key) != Storage.end(); }
+
+	ValueType& FindOrAdd(const KeyType& Key) {
+		auto It = Storage.find(Key);
+		if (It == Storage.end()) {
+			It = Storage.emplace(Key, ElementType{ Key, ValueType() }).first;
+		}
+		return It->second.Value;
+	}
+
+	ValueType& Add(const KeyType& Key, const ValueType& Value) {
+		ElementType& Element = Storage[Key];
+		Element.Key = Key;
+		Element.Value = Value;
+		return Element.Value;
+	}
+
+	ValueType& Add(const KeyType& Key) {
+		return Add(Key, ValueType());
+	}
+
+	ValueType* Find(const KeyType& Key) {
+		auto It = Storage.find(Key);
+		return It == Storage.end() ? nullptr : &It->second.Value;
+	}
+
+	const ValueType* Find(const KeyType& Key) const {
+		auto It = Storage.find(Key);
+		return It == Storage.end() ? nullptr : &It->second.Value;
+	}
+
+	ValueType& operator[](const KeyType& Key) {
+		return Storage.at(Key).Value;
+	}
+
+	const ValueType& operator[](const KeyType& Key) const {
+		return Storage.at(Key).Value;
+	}
+
+	int32 Remove(const KeyType& Key) {
+		return (int32)Storage.erase(Key);
+	}
+
+	void Empty() { Storage.clear(); }
+	void Reserve(int32 Number) { Storage.reserve(Number); }
+
+	iterator begin() { return iterator(Storage.begin()); }
+	iterator end() { return iterator(Storage.end()); }
+	const_iterator begin() const { return const_iterator(Storage.begin()); }
+	const_iterator end() const { return const_iterator(Storage.end()); }
+};
@@ -0,0 +1,5 @@
+// Minimal stand-in for the engine EngineMinimal.h, see CoreMinimal.h
+
+#pragma once
+
+#include "CoreMinimal.h"
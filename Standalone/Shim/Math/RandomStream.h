@@ -0,0 +1,64 @@
+// Minimal stand-in for the engine Math/RandomStream.h, see CoreMinimal.h
+// Same generator as the engine so seeded terrain is identical in both builds.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FRandomStream {
+
+private:
+	int32 InitialSeed = 0;
+	mutable int32 Seed = 0;
+
+	void MutateSeed() const {
+		Seed = (int32)((uint32)Seed * 196314165U + 907633515U);
+	}
+
+public:
+	FRandomStream() { }
+	FRandomStream(int32 InSeed) { Initialize(InSeed); }
+
+	void Initialize(int32 InSeed) {
+		InitialSeed = InSeed;
+		Seed = InSeed;
+	}
+
+	void Reset() const {
+		Seed = InitialSeed;
+	}
+
+	int32 GetInitialSeed() const {
+		return InitialSeed;
+	}
+
+	float GetFraction() const {
+		MutateSeed();
+		float Result;
+		const uint32 Bits = 0x3F800000U | ((uint32)Seed >> 9);
+		memcpy(&Result, &Bits, sizeof(Result));
+		return Result - 1.0f;
+	}
+
+	float FRand() const {
+		return GetFraction();
+	}
+
+	uint32 GetUnsignedInt() const {
+		MutateSeed();
+		return (uint32)Seed;
+	}
+
+	int32 RandHelper(int32 A) const {
+		return A > 0 ? std::min((int32)std::trunc(GetFraction() * (float)A), A - 1) : 0;
+	}
+
+	int32 RandRange(int32 Min, int32 Max) const {
+		const int32 Range = (Max - Min) + 1;
+		return Min + RandHelper(Range);
+	}
+
+	float FRandRange(float Min, float Max) const {
+		return Min + (Max - Min) * FRand();
+	}
+};
@@ -0,0 +1,13 @@
+// Minimal stand-in for the engine Modules/ModuleManager.h, see CoreMinimal.h
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IModuleInterface {
+
+public:
+	virtual ~IModuleInterface() { }
+	virtual void StartupModule() { }
+	virtual void ShutdownModule() { }
+};